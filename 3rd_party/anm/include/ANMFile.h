@@ -10,6 +10,9 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -40,10 +43,39 @@ struct ANMBone
 	float matrix[12];
 };
 
+/// Read-only view of contiguous elements owned by an ANMFile
+template <typename T>
+class ANMSpan
+{
+public:
+	ANMSpan()
+	    : _data(nullptr)
+	    , _size(0)
+	{
+	}
+	ANMSpan(const T* data, std::size_t size)
+	    : _data(data)
+	    , _size(size)
+	{
+	}
+
+	[[nodiscard]] const T* data() const { return _data; }
+	[[nodiscard]] std::size_t size() const { return _size; }
+	[[nodiscard]] bool empty() const { return _size == 0; }
+	[[nodiscard]] const T* begin() const { return _data; }
+	[[nodiscard]] const T* end() const { return _data + _size; }
+	[[nodiscard]] const T& operator[](std::size_t index) const { return _data[index]; }
+
+private:
+	const T* _data;
+	std::size_t _size;
+};
+
 struct ANMFrame
 {
 	uint32_t time;
-	std::vector<ANMBone> bones;
+	/// Points straight into the file contents, valid for the lifetime of the ANMFile
+	ANMSpan<ANMBone> bones;
 };
 
 /**
@@ -60,12 +92,20 @@ protected:
 	ANMHeader _header;
 	std::vector<ANMFrame> _keyframes;
 
+	/// File contents the keyframes point into, a read-only mapping or an owned copy
+	std::shared_ptr<const uint8_t> _data;
+	/// Bone blocks which are not 4 byte aligned in the contents are copied here
+	std::vector<ANMBone> _unalignedBones;
+
 	/// Error handling
 	void Fail(const std::string& msg);
 
 	/// Read file from the input source
 	virtual void ReadFile(std::istream& stream);
 
+	/// Validate the offset tables of the contents in _data and build the keyframe views
+	void ReadBuffer(std::size_t size);
+
 	/// Write file to the input source
 	virtual void WriteFile(std::ostream& stream) const;
 
@@ -74,12 +114,24 @@ public:
 
 	virtual ~ANMFile() = default;
 
-	/// Read anm file from the filesystem
+	/// Read anm file from the filesystem, the file is memory mapped
 	void Open(const std::string& file);
 
-	/// Read anm file from a buffer
+	/// Read anm file from a copy of a buffer
 	void Open(const std::vector<uint8_t>& buffer);
 
+	/// Read anm file from a buffer without copying, it must outlive this object
+	void Open(const uint8_t* buffer, std::size_t size);
+
+	/// Same as Open without exceptions, returns false and describes the failure in @error
+	bool TryOpen(const std::string& file, std::string& error);
+
+	/// Same as Open without exceptions, returns false and describes the failure in @error
+	bool TryOpen(const std::vector<uint8_t>& buffer, std::string& error);
+
+	/// Same as Open without exceptions, returns false and describes the failure in @error
+	bool TryOpen(const uint8_t* buffer, std::size_t size, std::string& error);
+
 	/// Write anm file to path on the filesystem
 	void Write(const std::string& file);
 
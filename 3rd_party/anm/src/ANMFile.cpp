@@ -60,53 +60,89 @@
 #include <cassert>
 #include <cstring>
 #include <fstream>
+#include <iterator>
+#include <stdexcept>
 #include <vector>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using namespace openblack::anm;
 
 namespace
 {
-// Adapted from https://stackoverflow.com/a/13059195/10604387
-//          and https://stackoverflow.com/a/46069245/10604387
-struct membuf: std::streambuf
+/// Map a whole file read-only, returns nullptr on failure or if the file is empty
+std::shared_ptr<const uint8_t> MapFile(const std::string& filename, std::size_t& size)
 {
-	membuf(char const* base, size_t size)
+	size = 0;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	                          FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
 	{
-		char* p(const_cast<char*>(base));
-		this->setg(p, p, p + size);
+		return nullptr;
 	}
-	std::streampos seekoff(off_type off, std::ios_base::seekdir way,
-	                       [[maybe_unused]] std::ios_base::openmode which = std::ios_base::in | std::ios_base::out) override
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
 	{
-		if (way == std::ios_base::cur)
-		{
-			gbump(static_cast<int>(off));
-		}
-		else if (way == std::ios_base::end)
-		{
-			setg(eback(), egptr() + off, egptr());
-		}
-		else if (way == std::ios_base::beg)
-		{
-			setg(eback(), eback() + off, egptr());
-		}
-		return gptr() - eback();
+		CloseHandle(file);
+		return nullptr;
 	}
-
-	std::streampos seekpos([[maybe_unused]] pos_type pos,
-	                       [[maybe_unused]] std::ios_base::openmode which = std::ios_base::in | std::ios_base::out) override
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mapping == nullptr)
 	{
-		return seekoff(pos - pos_type(off_type(0)), std::ios_base::beg, which);
+		return nullptr;
 	}
-};
-struct imemstream: virtual membuf, std::istream
-{
-	imemstream(char const* base, size_t size)
-	    : membuf(base, size)
-	    , std::istream(dynamic_cast<std::streambuf*>(this))
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (view == nullptr)
+	{
+		return nullptr;
+	}
+	size = static_cast<std::size_t>(file_size.QuadPart);
+	return std::shared_ptr<const uint8_t>(static_cast<const uint8_t*>(view),
+	                                      [](const uint8_t* p) { UnmapViewOfFile(p); });
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
 	{
+		return nullptr;
 	}
-};
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+	{
+		close(fd);
+		return nullptr;
+	}
+	auto file_size = static_cast<std::size_t>(file_stat.st_size);
+	void* view = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED)
+	{
+		return nullptr;
+	}
+	size = file_size;
+	return std::shared_ptr<const uint8_t>(static_cast<const uint8_t*>(view),
+	                                      [file_size](const uint8_t* p) { munmap(const_cast<uint8_t*>(p), file_size); });
+#endif
+}
+
+/// Copy a buffer into storage aligned for any of the file's structures
+std::shared_ptr<const uint8_t> CopyBuffer(const uint8_t* buffer, std::size_t size)
+{
+	std::shared_ptr<uint8_t> copy(new uint8_t[size], std::default_delete<uint8_t[]>());
+	std::memcpy(copy.get(), buffer, size);
+	return copy;
+}
 } // namespace
 
 /// Error handling
@@ -124,7 +160,7 @@ void ANMFile::ReadFile(std::istream& stream)
 {
 	assert(!_isLoaded);
 
-	// Total file size
+	// Pull the whole stream in one read and parse it from memory
 	std::size_t fsize = 0;
 	if (stream.seekg(0, std::ios_base::end))
 	{
@@ -137,36 +173,98 @@ void ANMFile::ReadFile(std::istream& stream)
 		Fail("File too small to be a valid ANM file.");
 	}
 
-	// First 84 bytes
-	stream.read(reinterpret_cast<char*>(&_header), sizeof(ANMHeader));
+	std::shared_ptr<uint8_t> contents(new uint8_t[fsize], std::default_delete<uint8_t[]>());
+	if (!stream.read(reinterpret_cast<char*>(contents.get()), static_cast<std::streamsize>(fsize)))
+	{
+		Fail("Could not read file.");
+	}
+	_data = std::move(contents);
 
-	_keyframes.resize(_header.frame_count);
-	for (uint32_t i = 0; i < _header.frame_count; ++i)
+	ReadBuffer(fsize);
+}
+
+void ANMFile::ReadBuffer(std::size_t size)
+{
+	assert(!_isLoaded);
+
+	if (size < sizeof(ANMHeader))
 	{
-		stream.seekg(_header.frames_base + i * sizeof(uint32_t));
+		Fail("File too small to be a valid ANM file.");
+	}
 
-		// In Keyframe offset block
-		uint32_t offset;
-		stream.read(reinterpret_cast<char*>(&offset), sizeof(offset));
+	const uint8_t* base = _data.get();
+	const auto readOffset = [this, base, size](uint64_t position) {
+		if (position + sizeof(uint32_t) > size)
+		{
+			Fail("Offset out of range at " + std::to_string(position) + ".");
+		}
+		uint32_t value;
+		std::memcpy(&value, base + position, sizeof(value));
+		return value;
+	};
 
-		// Keyframe pointer
-		stream.seekg(offset);
-		stream.read(reinterpret_cast<char*>(&offset), sizeof(offset));
+	// First 84 bytes
+	std::memcpy(&_header, base, sizeof(ANMHeader));
 
-		// Bone offset block
-		stream.seekg(offset);
-		stream.read(reinterpret_cast<char*>(&offset), sizeof(offset));
+	if (static_cast<uint64_t>(_header.frames_base) + uint64_t {_header.frame_count} * sizeof(uint32_t) > size)
+	{
+		Fail("Keyframe offset block exceeds file size.");
+	}
 
-		// Bone block
-		stream.seekg(offset);
-		uint32_t bone_count;
-		stream.read(reinterpret_cast<char*>(&bone_count), sizeof(bone_count));
+	// Resolve and validate the offset chain of every frame once. The bone blocks are then used
+	// in place, only those which are misaligned for float access need a copy. Alignment is that
+	// of the address rather than the offset, a buffer opened in place may start anywhere.
+	const auto isAligned = [](const uint8_t* bones) {
+		return reinterpret_cast<std::uintptr_t>(bones) % alignof(ANMBone) == 0;
+	};
+	std::vector<uint32_t> boneBlocks(_header.frame_count);
+	std::size_t unalignedBoneCount = 0;
+	for (uint32_t i = 0; i < _header.frame_count; ++i)
+	{
+		// Keyframe offset block -> keyframe pointer -> bone offset block -> bone block
+		uint32_t offset = readOffset(_header.frames_base + uint64_t {i} * sizeof(uint32_t));
+		offset = readOffset(offset);
+		offset = readOffset(offset);
+
+		// Bone block header of bone count and time
+		const uint32_t boneCount = readOffset(offset);
+		readOffset(uint64_t {offset} + sizeof(uint32_t));
+		const uint64_t bonesStart = uint64_t {offset} + 2 * sizeof(uint32_t);
+		if (bonesStart + uint64_t {boneCount} * sizeof(ANMBone) > size)
+		{
+			Fail("Bone block of frame " + std::to_string(i) + " exceeds file size.");
+		}
+		if (!isAligned(base + bonesStart))
+		{
+			unalignedBoneCount += boneCount;
+		}
+		boneBlocks[i] = offset;
+	}
 
-		stream.read(reinterpret_cast<char*>(&_keyframes[i].time), sizeof(_keyframes[i].time));
+	// Reserved up front so the spans into it stay valid
+	_unalignedBones.reserve(unalignedBoneCount);
+	_keyframes.resize(_header.frame_count);
+	for (uint32_t i = 0; i < _header.frame_count; ++i)
+	{
+		const uint8_t* block = base + boneBlocks[i];
+		uint32_t boneCount;
+		std::memcpy(&boneCount, block, sizeof(boneCount));
+		std::memcpy(&_keyframes[i].time, block + sizeof(uint32_t), sizeof(_keyframes[i].time));
 
-		_keyframes[i].bones.resize(bone_count);
-		stream.read(reinterpret_cast<char*>(_keyframes[i].bones.data()),
-		            _keyframes[i].bones.size() * sizeof(_keyframes[i].bones[0]));
+		const uint8_t* bones = block + 2 * sizeof(uint32_t);
+		if (isAligned(bones))
+		{
+			_keyframes[i].bones = ANMSpan<ANMBone>(reinterpret_cast<const ANMBone*>(bones), boneCount);
+		}
+		else
+		{
+			const auto first = _unalignedBones.size();
+			// Never grows past the reservation, which would move the bones of earlier spans
+			assert(first + boneCount <= _unalignedBones.capacity());
+			_unalignedBones.resize(first + boneCount);
+			std::memcpy(_unalignedBones.data() + first, bones, boneCount * sizeof(ANMBone));
+			_keyframes[i].bones = ANMSpan<ANMBone>(_unalignedBones.data() + first, boneCount);
+		}
 	}
 
 	_isLoaded = true;
@@ -184,25 +282,88 @@ void ANMFile::Open(const std::string& file)
 
 	_filename = file;
 
-	std::ifstream stream(_filename, std::ios::binary);
-
-	if (!stream.is_open())
+	std::size_t size;
+	_data = MapFile(_filename, size);
+	if (!_data)
 	{
-		Fail("Could not open file.");
+		// Empty files and files which can't be mapped go through the stream reader
+		std::ifstream stream(_filename, std::ios::binary);
+
+		if (!stream.is_open())
+		{
+			Fail("Could not open file.");
+		}
+
+		ReadFile(stream);
+		return;
 	}
 
-	ReadFile(stream);
+	ReadBuffer(size);
 }
 
 void ANMFile::Open(const std::vector<uint8_t>& buffer)
 {
 	assert(!_isLoaded);
 
-	imemstream stream(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(buffer[0]));
+	_filename = "buffer";
+
+	_data = CopyBuffer(buffer.data(), buffer.size() * sizeof(buffer[0]));
+
+	ReadBuffer(buffer.size() * sizeof(buffer[0]));
+}
+
+void ANMFile::Open(const uint8_t* buffer, std::size_t size)
+{
+	assert(!_isLoaded);
 
 	_filename = "buffer";
 
-	ReadFile(stream);
+	// Non-owning, the caller keeps the buffer alive
+	_data = std::shared_ptr<const uint8_t>(buffer, [](const uint8_t*) {});
+
+	ReadBuffer(size);
+}
+
+bool ANMFile::TryOpen(const std::string& file, std::string& error)
+{
+	try
+	{
+		Open(file);
+	}
+	catch (const std::runtime_error& exception)
+	{
+		error = exception.what();
+		return false;
+	}
+	return true;
+}
+
+bool ANMFile::TryOpen(const std::vector<uint8_t>& buffer, std::string& error)
+{
+	try
+	{
+		Open(buffer);
+	}
+	catch (const std::runtime_error& exception)
+	{
+		error = exception.what();
+		return false;
+	}
+	return true;
+}
+
+bool ANMFile::TryOpen(const uint8_t* buffer, std::size_t size, std::string& error)
+{
+	try
+	{
+		Open(buffer, size);
+	}
+	catch (const std::runtime_error& exception)
+	{
+		error = exception.what();
+		return false;
+	}
+	return true;
 }
 
 void ANMFile::Write(const std::string& file)
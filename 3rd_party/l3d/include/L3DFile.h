@@ -10,22 +10,58 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace openblack::l3d
 {
 
+/// Read-only view of contiguous elements, either in a file mapping or in owned storage
 // TODO(bwrsandman): If you read this in c++20, replace with std::span
 template <typename N>
+class View
+{
+	const N* data_;
+	std::size_t size_;
+
+public:
+	View() noexcept
+	    : data_(nullptr)
+	    , size_(0)
+	{
+	}
+	View(const N* data, std::size_t size) noexcept
+	    : data_(data)
+	    , size_(size)
+	{
+	}
+	explicit View(const std::vector<N>& original) noexcept
+	    : data_(original.data())
+	    , size_(original.size())
+	{
+	}
+
+	const N* data() const noexcept { return data_; }
+	const N& operator[](std::size_t index) const noexcept { return data_[index]; }
+	std::size_t size() const noexcept { return size_; }
+	bool empty() const noexcept { return size_ == 0; }
+	const N* begin() const noexcept { return data_; }
+	const N* end() const noexcept { return data_ + size_; }
+};
+
+/// Per submesh range of a view, follows the view if its storage moves
+template <typename N>
 class Span
 {
-	const std::vector<N>& original_;
+	const View<N>& original_;
 	const uint32_t start_;
 	const uint32_t length_;
 
 public:
-	Span(std::vector<N>& original, uint32_t start, uint32_t length)
+	Span(const View<N>& original, uint32_t start, uint32_t length)
 	    : original_(original)
 	    , start_(start)
 	    , length_(length)
@@ -34,18 +70,15 @@ public:
 
 	const N* data() const noexcept { return original_.data() + start_; }
 
-	typename std::vector<N>::const_reference operator[](typename std::vector<N>::size_type index) const noexcept
-	{
-		return original_[index + start_];
-	}
+	const N& operator[](std::size_t index) const noexcept { return original_[index + start_]; }
 
-	constexpr typename std::vector<N>::size_type size() const noexcept { return length_; }
+	constexpr std::size_t size() const noexcept { return length_; }
 
 	// First element.
-	constexpr typename std::vector<N>::const_iterator begin() const noexcept { return original_.begin() + start_; }
+	const N* begin() const noexcept { return data(); }
 
 	// One past the last element.
-	constexpr typename std::vector<N>::const_iterator end() const noexcept { return begin() + size(); }
+	const N* end() const noexcept { return begin() + size(); }
 };
 
 enum class L3DMeshFlags : uint32_t
@@ -217,6 +250,7 @@ protected:
 	std::string _filename;
 
 	L3DHeader _header;
+	// Owned storage, filled when writing or when a block can't be used in place
 	std::vector<L3DSubmeshHeader> _submeshHeaders;
 	std::vector<L3DTexture> _skins;
 	std::vector<L3DPoint> _points;
@@ -226,18 +260,34 @@ protected:
 	std::vector<L3DVertexGroup> _vertexGroups;
 	std::vector<L3DBlend> _blends;
 	std::vector<L3DBone> _bones;
+	// What the getters expose, into _data when the blocks are contiguous in the file
+	View<L3DSubmeshHeader> _submeshHeadersView;
+	View<L3DTexture> _skinsView;
+	View<L3DPoint> _pointsView;
+	View<L3DPrimitiveHeader> _primitiveHeadersView;
+	View<L3DVertex> _verticesView;
+	View<uint16_t> _indicesView;
+	View<L3DVertexGroup> _vertexGroupsView;
+	View<L3DBlend> _blendsView;
+	View<L3DBone> _bonesView;
 	std::vector<Span<L3DPrimitiveHeader>> _primitiveSpans;
 	std::vector<Span<L3DVertex>> _vertexSpans;
 	std::vector<Span<uint16_t>> _indexSpans;
 	std::vector<Span<L3DVertexGroup>> _vertexGroupSpans;
 	std::vector<Span<L3DBone>> _boneSpans;
 
+	/// File contents the views point into, a read-only mapping or an owned copy
+	std::shared_ptr<const uint8_t> _data;
+
 	/// Error handling
 	void Fail(const std::string& msg);
 
 	/// Read file from the input source
 	virtual void ReadFile(std::istream& stream);
 
+	/// Validate the contents in _data and build the views
+	void ReadBuffer(std::size_t size);
+
 	/// Write file to the input source
 	virtual void WriteFile(std::ostream& stream) const;
 
@@ -246,26 +296,38 @@ public:
 
 	virtual ~L3DFile() = default;
 
-	/// Read l3d file from the filesystem
+	/// Read l3d file from the filesystem, the file is memory mapped
 	void Open(const std::string& file);
 
-	/// Read l3d file from a buffer
+	/// Read l3d file from a copy of a buffer
 	void Open(const std::vector<uint8_t>& buffer);
 
+	/// Read l3d file from a buffer without copying, it must outlive this object
+	void Open(const uint8_t* buffer, std::size_t size);
+
+	/// Same as Open without exceptions, returns false and describes the failure in @error
+	bool TryOpen(const std::string& file, std::string& error);
+
+	/// Same as Open without exceptions, returns false and describes the failure in @error
+	bool TryOpen(const std::vector<uint8_t>& buffer, std::string& error);
+
+	/// Same as Open without exceptions, returns false and describes the failure in @error
+	bool TryOpen(const uint8_t* buffer, std::size_t size, std::string& error);
+
 	/// Write l3d file to path on the filesystem
 	void Write(const std::string& file);
 
 	[[nodiscard]] const std::string& GetFilename() const { return _filename; }
 	[[nodiscard]] const L3DHeader& GetHeader() const { return _header; }
-	[[nodiscard]] const std::vector<L3DSubmeshHeader>& GetSubmeshHeaders() const { return _submeshHeaders; }
-	[[nodiscard]] const std::vector<L3DTexture>& GetSkins() const { return _skins; }
-	[[nodiscard]] const std::vector<L3DPoint>& GetPoints() const { return _points; }
-	[[nodiscard]] const std::vector<L3DPrimitiveHeader>& GetPrimitiveHeaders() const { return _primitiveHeaders; }
-	[[nodiscard]] const std::vector<L3DVertex>& GetVertices() const { return _vertices; }
-	[[nodiscard]] const std::vector<uint16_t>& GetIndices() const { return _indices; }
-	[[nodiscard]] const std::vector<L3DVertexGroup>& GetLookUpTableData() const { return _vertexGroups; }
-	[[nodiscard]] const std::vector<L3DBlend>& GetBlends() const { return _blends; }
-	[[nodiscard]] const std::vector<L3DBone>& GetBones() const { return _bones; }
+	[[nodiscard]] View<L3DSubmeshHeader> GetSubmeshHeaders() const { return _submeshHeadersView; }
+	[[nodiscard]] View<L3DTexture> GetSkins() const { return _skinsView; }
+	[[nodiscard]] View<L3DPoint> GetPoints() const { return _pointsView; }
+	[[nodiscard]] View<L3DPrimitiveHeader> GetPrimitiveHeaders() const { return _primitiveHeadersView; }
+	[[nodiscard]] View<L3DVertex> GetVertices() const { return _verticesView; }
+	[[nodiscard]] View<uint16_t> GetIndices() const { return _indicesView; }
+	[[nodiscard]] View<L3DVertexGroup> GetLookUpTableData() const { return _vertexGroupsView; }
+	[[nodiscard]] View<L3DBlend> GetBlends() const { return _blendsView; }
+	[[nodiscard]] View<L3DBone> GetBones() const { return _bonesView; }
 	[[nodiscard]] const Span<L3DPrimitiveHeader>& GetPrimitiveSpan(uint32_t submeshIndex) const
 	{
 		return _primitiveSpans[submeshIndex];
@@ -131,53 +131,131 @@
 #include <cstring>
 #include <fstream>
 #include <limits>
+#include <stdexcept>
 #include <vector>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using namespace openblack::l3d;
 
 namespace
 {
-// Adapted from https://stackoverflow.com/a/13059195/10604387
-//          and https://stackoverflow.com/a/46069245/10604387
-struct membuf: std::streambuf
+/// Map a whole file read-only, returns nullptr on failure or if the file is empty
+std::shared_ptr<const uint8_t> MapFile(const std::string& filename, std::size_t& size)
 {
-	membuf(char const* base, size_t size)
+	size = 0;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	                          FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
 	{
-		char* p(const_cast<char*>(base));
-		this->setg(p, p, p + size);
+		return nullptr;
 	}
-	std::streampos seekoff(off_type off, std::ios_base::seekdir way,
-	                       [[maybe_unused]] std::ios_base::openmode which = std::ios_base::in | std::ios_base::out) override
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
 	{
-		if (way == std::ios_base::cur)
-		{
-			gbump(static_cast<int>(off));
-		}
-		else if (way == std::ios_base::end)
-		{
-			setg(eback(), egptr() + off, egptr());
-		}
-		else if (way == std::ios_base::beg)
-		{
-			setg(eback(), eback() + off, egptr());
-		}
-		return gptr() - eback();
+		CloseHandle(file);
+		return nullptr;
 	}
-
-	std::streampos seekpos([[maybe_unused]] pos_type pos,
-	                       [[maybe_unused]] std::ios_base::openmode which = std::ios_base::in | std::ios_base::out) override
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mapping == nullptr)
 	{
-		return seekoff(pos - pos_type(off_type(0)), std::ios_base::beg, which);
+		return nullptr;
 	}
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (view == nullptr)
+	{
+		return nullptr;
+	}
+	size = static_cast<std::size_t>(file_size.QuadPart);
+	return std::shared_ptr<const uint8_t>(static_cast<const uint8_t*>(view),
+	                                      [](const uint8_t* p) { UnmapViewOfFile(p); });
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return nullptr;
+	}
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+	{
+		close(fd);
+		return nullptr;
+	}
+	auto file_size = static_cast<std::size_t>(file_stat.st_size);
+	void* view = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED)
+	{
+		return nullptr;
+	}
+	// Meshes are converted front to back
+	madvise(view, file_size, MADV_SEQUENTIAL);
+	size = file_size;
+	return std::shared_ptr<const uint8_t>(static_cast<const uint8_t*>(view),
+	                                      [file_size](const uint8_t* p) { munmap(const_cast<uint8_t*>(p), file_size); });
+#endif
+}
+
+/// Copy a buffer into storage aligned for any of the file's structures
+std::shared_ptr<const uint8_t> CopyBuffer(const uint8_t* buffer, std::size_t size)
+{
+	std::shared_ptr<uint8_t> copy(new uint8_t[size], std::default_delete<uint8_t[]>());
+	std::memcpy(copy.get(), buffer, size);
+	return copy;
+}
+
+/// Element count at an offset of the file contents
+struct Block
+{
+	uint32_t offset;
+	uint32_t count;
 };
-struct imemstream: virtual membuf, std::istream
+
+/// View over blocks already validated to be inside the contents. Blocks which directly follow
+/// each other in the file at a suitable alignment are used in place, otherwise gathered.
+template <typename T>
+View<T> GatherBlocks(const uint8_t* base, const std::vector<Block>& blocks, std::vector<T>& storage)
 {
-	imemstream(char const* base, size_t size)
-	    : membuf(base, size)
-	    , std::istream(dynamic_cast<std::streambuf*>(this))
+	std::size_t total = 0;
+	bool inPlace = true;
+	uint64_t expected = blocks.empty() ? 0 : blocks.front().offset;
+	for (const auto& block : blocks)
 	{
+		inPlace = inPlace && block.offset == expected;
+		expected = block.offset + uint64_t {block.count} * sizeof(T);
+		total += block.count;
 	}
-};
+	if (total == 0)
+	{
+		return {};
+	}
+	const uint8_t* first = base + blocks.front().offset;
+	if (inPlace && reinterpret_cast<std::uintptr_t>(first) % alignof(T) == 0)
+	{
+		return View<T>(reinterpret_cast<const T*>(first), total);
+	}
+
+	storage.resize(total);
+	std::size_t counter = 0;
+	for (const auto& block : blocks)
+	{
+		std::memcpy(&storage[counter], base + block.offset, block.count * sizeof(T));
+		counter += block.count;
+	}
+	return View<T>(storage);
+}
 } // namespace
 
 /// Error handling
@@ -195,7 +273,7 @@ void L3DFile::ReadFile(std::istream& stream)
 {
 	assert(!_isLoaded);
 
-	// Total file size
+	// Pull the whole stream in one read and parse it from memory
 	std::size_t fsize = 0;
 	if (stream.seekg(0, std::ios_base::end))
 	{
@@ -208,291 +286,273 @@ void L3DFile::ReadFile(std::istream& stream)
 		Fail("File too small to be a valid L3D file.");
 	}
 
+	std::shared_ptr<uint8_t> contents(new uint8_t[fsize], std::default_delete<uint8_t[]>());
+	if (!stream.read(reinterpret_cast<char*>(contents.get()), static_cast<std::streamsize>(fsize)))
+	{
+		Fail("Could not read file.");
+	}
+	_data = std::move(contents);
+
+	ReadBuffer(fsize);
+}
+
+void L3DFile::ReadBuffer(std::size_t fsize)
+{
+	assert(!_isLoaded);
+
+	if (fsize < sizeof(L3DHeader))
+	{
+		Fail("File too small to be a valid L3D file.");
+	}
+
+	const uint8_t* base = _data.get();
+	const auto inFile = [fsize](uint64_t offset, uint64_t count, std::size_t elementSize) {
+		return offset + count * elementSize <= fsize;
+	};
+	const auto readOffsets = [base](uint32_t offset, uint32_t count) {
+		std::vector<uint32_t> offsets(count);
+		std::memcpy(offsets.data(), base + offset, offsets.size() * sizeof(offsets[0]));
+		return offsets;
+	};
+
 	// First 76 bytes
-	stream.read(reinterpret_cast<char*>(&_header), sizeof(L3DHeader));
+	std::memcpy(&_header, base, sizeof(L3DHeader));
 	if (std::memcmp(&_header.magic, kMagic, sizeof(_header.magic)) != 0)
 	{
 		Fail("Unrecognized L3D header");
 	}
 
 	// Read the offset info into a temporary buffers
-	std::vector<uint32_t> submeshOffsets(_header.submeshCount);
-	if (!submeshOffsets.empty() && _header.submeshOffsetsOffset != std::numeric_limits<uint32_t>::max())
+	std::vector<uint32_t> submeshOffsets;
+	if (_header.submeshCount > 0 && _header.submeshOffsetsOffset != std::numeric_limits<uint32_t>::max())
 	{
 		if (_header.submeshOffsetsOffset > fsize)
 		{
 			Fail("Submesh Offset is beyond the size of the file");
 		}
-		if (_header.submeshOffsetsOffset + submeshOffsets.size() * sizeof(submeshOffsets[0]) > fsize)
+		if (!inFile(_header.submeshOffsetsOffset, _header.submeshCount, sizeof(uint32_t)))
 		{
 			Fail("Submesh Offsets are beyond the end of the file");
 		}
-		stream.seekg(_header.submeshOffsetsOffset);
-		stream.read(reinterpret_cast<char*>(submeshOffsets.data()), submeshOffsets.size() * sizeof(submeshOffsets[0]));
+		submeshOffsets = readOffsets(_header.submeshOffsetsOffset, _header.submeshCount);
 	}
 	std::vector<uint32_t> skinOffsets;
-	skinOffsets.resize(_header.skinCount);
-	if (!skinOffsets.empty() && _header.skinOffsetsOffset != std::numeric_limits<uint32_t>::max())
+	if (_header.skinCount > 0 && _header.skinOffsetsOffset != std::numeric_limits<uint32_t>::max())
 	{
 		if (_header.skinOffsetsOffset > fsize)
 		{
 			Fail("Skin Offset is beyond the size of the file");
 		}
-		if (_header.skinOffsetsOffset + skinOffsets.size() * sizeof(skinOffsets[0]) > fsize)
+		if (!inFile(_header.skinOffsetsOffset, _header.skinCount, sizeof(uint32_t)))
 		{
 			Fail("Skin Offsets are beyond the end of the file");
 		}
-		stream.seekg(_header.skinOffsetsOffset);
-		stream.read(reinterpret_cast<char*>(skinOffsets.data()), skinOffsets.size() * sizeof(skinOffsets[0]));
+		skinOffsets = readOffsets(_header.skinOffsetsOffset, _header.skinCount);
 	}
-	_points.resize(_header.pointCount);
-	if (!_points.empty() && _header.pointOffset != std::numeric_limits<uint32_t>::max())
+	std::vector<Block> blocks;
+	if (_header.pointCount > 0 && _header.pointOffset != std::numeric_limits<uint32_t>::max())
 	{
 		if (_header.pointOffset > fsize)
 		{
 			Fail("Point Offset is beyond the size of the file");
 		}
-		if (_header.pointOffset + _points.size() * sizeof(_points[0]) > fsize)
+		if (!inFile(_header.pointOffset, _header.pointCount, sizeof(L3DPoint)))
 		{
 			Fail("Points are beyond the end of the file");
 		}
-		stream.seekg(_header.pointOffset);
-		stream.read(reinterpret_cast<char*>(_points.data()), _points.size() * sizeof(_points[0]));
+		blocks.push_back({_header.pointOffset, _header.pointCount});
 	}
+	_pointsView = GatherBlocks(base, blocks, _points);
 
-	// Reserve space and read submeshes
-	uint32_t totalPrimitives = 0;
-	uint32_t totalBones = 0;
-	_submeshHeaders.reserve(submeshOffsets.size());
+	// Submeshes
+	blocks.clear();
 	for (auto offset : submeshOffsets)
 	{
-		if (offset + sizeof(_submeshHeaders[0]) > fsize)
+		if (!inFile(offset, 1, sizeof(L3DSubmeshHeader)))
 		{
 			Fail("Submesh header is beyond the end of the file");
 		}
-		stream.seekg(offset);
-		_submeshHeaders.emplace_back();
-		stream.read(reinterpret_cast<char*>(&_submeshHeaders.back()), sizeof(_submeshHeaders[0]));
-		totalPrimitives += _submeshHeaders.back().numPrimitives;
-		totalBones += _submeshHeaders.back().numBones;
+		blocks.push_back({offset, 1});
 	}
+	_submeshHeadersView = GatherBlocks(base, blocks, _submeshHeaders);
 
-	// Reserve space and read skins
-	_skins.reserve(skinOffsets.size());
+	// Skins
+	blocks.clear();
 	for (auto offset : skinOffsets)
 	{
-		stream.seekg(offset);
-		_skins.emplace_back();
-		stream.read(reinterpret_cast<char*>(&_skins.back()), sizeof(_skins[0]));
-	}
-
-	// Reserve space for primitive offsets
-	std::vector<uint32_t> primitiveOffsets(totalPrimitives);
-	uint32_t primitiveCounter = 0;
-	for (const auto& header : _submeshHeaders)
-	{
-		stream.seekg(header.primitivesOffset);
-		if (primitiveCounter + header.numPrimitives > totalPrimitives)
+		if (!inFile(offset, 1, sizeof(L3DTexture)))
 		{
-			Fail("More primitives found than declared");
+			Fail("Skin is beyond the end of the file");
 		}
+		blocks.push_back({offset, 1});
+	}
+	_skinsView = GatherBlocks(base, blocks, _skins);
 
+	// Primitive offsets of all submeshes, then the primitives they point to
+	std::vector<uint32_t> primitiveOffsets;
+	for (const auto& header : _submeshHeadersView)
+	{
 		if (header.numPrimitives == 0)
 		{
 			continue;
 		}
-		if (primitiveOffsets.size() <= primitiveCounter)
-		{
-			Fail("Less Primitives than expected");
-		}
-		if (primitiveOffsets[primitiveCounter] > fsize)
+		if (header.primitivesOffset > fsize)
 		{
 			Fail("Primitive Offset is beyond the size of the file");
 		}
-		if (primitiveOffsets[primitiveCounter] + primitiveOffsets[primitiveCounter] * sizeof(primitiveOffsets[0]) > fsize)
+		if (!inFile(header.primitivesOffset, header.numPrimitives, sizeof(uint32_t)))
 		{
 			Fail("Primitive Offsets are beyond the end of the file");
 		}
-		stream.read(reinterpret_cast<char*>(&primitiveOffsets[primitiveCounter]),
-		            header.numPrimitives * sizeof(primitiveOffsets[0]));
-		primitiveCounter += header.numPrimitives;
-	}
-	if (primitiveCounter != totalPrimitives)
-	{
-		Fail("Could not account for all primitives");
+		auto offsets = readOffsets(header.primitivesOffset, header.numPrimitives);
+		primitiveOffsets.insert(primitiveOffsets.end(), offsets.begin(), offsets.end());
 	}
 
-	// Reserve space for primitives
-	_primitiveHeaders.reserve(primitiveOffsets.size());
-	uint32_t totalVertices = 0;
-	uint32_t totalIndices = 0;
-	uint32_t totalGroups = 0;
-	uint32_t totalBlendValues = 0;
+	blocks.clear();
 	for (auto offset : primitiveOffsets)
 	{
-		if (offset + sizeof(_primitiveHeaders[0]) > fsize)
+		if (!inFile(offset, 1, sizeof(L3DPrimitiveHeader)))
 		{
 			Fail("Primitive headers are beyond the end of the file");
 		}
-		stream.seekg(offset);
-		_primitiveHeaders.emplace_back();
-		stream.read(reinterpret_cast<char*>(&_primitiveHeaders.back()), sizeof(_primitiveHeaders[0]));
-		totalVertices += _primitiveHeaders.back().numVertices;
-		totalIndices += _primitiveHeaders.back().numTriangles * 3;
-		totalGroups += _primitiveHeaders.back().numGroups;
-		totalBlendValues += _primitiveHeaders.back().numVertexBlends;
+		blocks.push_back({offset, 1});
 	}
+	_primitiveHeadersView = GatherBlocks(base, blocks, _primitiveHeaders);
 
-	// Reserve space for vertices
-	_vertices.resize(totalVertices);
-	if (!_vertices.empty())
+	// Vertices
+	blocks.clear();
+	uint64_t totalVertices = 0;
+	for (const auto& header : _primitiveHeadersView)
 	{
-		uint32_t counter = 0;
-		for (const auto& header : _primitiveHeaders)
+		totalVertices += header.numVertices;
+		if (header.numVertices == 0 || header.verticesOffset == std::numeric_limits<uint32_t>::max())
 		{
-			if (header.numVertices == 0 || header.verticesOffset == std::numeric_limits<uint32_t>::max())
-			{
-				continue;
-			}
-			if (header.verticesOffset + header.numVertices * sizeof(_vertices[0]) > fsize)
-			{
-				Fail("Vertex list go beyond file");
-			}
-			stream.seekg(header.verticesOffset);
-			stream.read(reinterpret_cast<char*>(&_vertices[counter]), header.numVertices * sizeof(_vertices[0]));
-			counter += header.numVertices;
+			continue;
 		}
-		if (counter != totalVertices)
+		if (!inFile(header.verticesOffset, header.numVertices, sizeof(L3DVertex)))
 		{
-			Fail("Could not account for all vertices");
+			Fail("Vertex list go beyond file");
 		}
+		blocks.push_back({header.verticesOffset, header.numVertices});
+	}
+	_verticesView = GatherBlocks(base, blocks, _vertices);
+	if (_verticesView.size() != totalVertices)
+	{
+		Fail("Could not account for all vertices");
 	}
 
-	// Reserve space for indices
-	_indices.resize(totalIndices);
-	if (!_indices.empty())
+	// Indices
+	blocks.clear();
+	uint64_t totalIndices = 0;
+	for (const auto& header : _primitiveHeadersView)
 	{
-		uint32_t counter = 0;
-		for (const auto& header : _primitiveHeaders)
+		totalIndices += uint64_t {header.numTriangles} * 3;
+		if (header.numTriangles == 0 || header.trianglesOffset == std::numeric_limits<uint32_t>::max())
 		{
-			if (header.numTriangles == 0 || header.trianglesOffset == std::numeric_limits<uint32_t>::max())
-			{
-				continue;
-			}
-			if (header.trianglesOffset + header.numTriangles * 3 * sizeof(_indices[0]) > fsize)
-			{
-				Fail("Triangle list go beyond file");
-			}
-			stream.seekg(header.trianglesOffset);
-			stream.read(reinterpret_cast<char*>(&_indices[counter]), header.numTriangles * 3 * sizeof(_indices[0]));
-			counter += header.numTriangles * 3;
+			continue;
 		}
-		if (counter != totalIndices)
+		if (!inFile(header.trianglesOffset, uint64_t {header.numTriangles} * 3, sizeof(uint16_t)))
 		{
-			Fail("Could not account for all indices");
+			Fail("Triangle list go beyond file");
 		}
+		blocks.push_back({header.trianglesOffset, header.numTriangles * 3});
+	}
+	_indicesView = GatherBlocks(base, blocks, _indices);
+	if (_indicesView.size() != totalIndices)
+	{
+		Fail("Could not account for all indices");
 	}
 
-	// Reserve space for look-up table data
-	_vertexGroups.resize(totalGroups);
-	if (!_vertexGroups.empty())
+	// Look-up table data
+	blocks.clear();
+	uint64_t totalGroups = 0;
+	for (const auto& header : _primitiveHeadersView)
 	{
-		uint32_t counter = 0;
-		for (const auto& header : _primitiveHeaders)
+		totalGroups += header.numGroups;
+		if (header.numGroups == 0 || header.groupsOffset == std::numeric_limits<uint32_t>::max())
 		{
-			if (header.numGroups == 0 || header.groupsOffset == std::numeric_limits<uint32_t>::max())
-			{
-				continue;
-			}
-			if (header.groupsOffset + header.numGroups * sizeof(_vertexGroups[0]) > fsize)
-			{
-				Fail("Vertex groups go beyond end of file");
-			}
-			stream.seekg(header.groupsOffset);
-			stream.read(reinterpret_cast<char*>(&_vertexGroups[counter]), header.numGroups * sizeof(_vertexGroups[0]));
-			counter += header.numGroups;
+			continue;
 		}
-		if (counter != totalGroups)
+		if (!inFile(header.groupsOffset, header.numGroups, sizeof(L3DVertexGroup)))
 		{
-			Fail("Could not account for vertex group data");
+			Fail("Vertex groups go beyond end of file");
 		}
+		blocks.push_back({header.groupsOffset, header.numGroups});
+	}
+	_vertexGroupsView = GatherBlocks(base, blocks, _vertexGroups);
+	if (_vertexGroupsView.size() != totalGroups)
+	{
+		Fail("Could not account for vertex group data");
 	}
 
-	// Reserve space for vertex blend data
-	_blends.resize(totalBlendValues);
-
-	if (!_blends.empty())
+	// Vertex blend data
+	blocks.clear();
+	uint64_t totalBlendValues = 0;
+	for (const auto& header : _primitiveHeadersView)
 	{
-		uint32_t counter = 0;
-		for (const auto& header : _primitiveHeaders)
+		totalBlendValues += header.numVertexBlends;
+		if (header.numVertexBlends == 0 || header.vertexBlendsOffset == std::numeric_limits<uint32_t>::max())
 		{
-			if (header.numVertexBlends == 0 || header.vertexBlendsOffset == std::numeric_limits<uint32_t>::max())
-			{
-				continue;
-			}
-			if (header.vertexBlendsOffset + header.numVertexBlends * sizeof(_blends[0]) > fsize)
-			{
-				Fail("Blend value data goes beyond file");
-			}
-			stream.seekg(header.vertexBlendsOffset);
-			stream.read(reinterpret_cast<char*>(&_blends[counter]), header.numVertexBlends * sizeof(_blends[0]));
-			counter += header.numVertexBlends;
+			continue;
 		}
-		if (counter != totalBlendValues)
+		if (!inFile(header.vertexBlendsOffset, header.numVertexBlends, sizeof(L3DBlend)))
 		{
-			Fail("Could not account for blend values data");
+			Fail("Blend value data goes beyond file");
 		}
+		blocks.push_back({header.vertexBlendsOffset, header.numVertexBlends});
+	}
+	_blendsView = GatherBlocks(base, blocks, _blends);
+	if (_blendsView.size() != totalBlendValues)
+	{
+		Fail("Could not account for blend values data");
 	}
 
-	// Reserve space for bone data
-	_bones.resize(totalBones);
-	if (!_bones.empty())
+	// Bone data
+	blocks.clear();
+	uint64_t totalBones = 0;
+	for (const auto& header : _submeshHeadersView)
 	{
-		uint32_t counter = 0;
-		for (const auto& header : _submeshHeaders)
+		totalBones += header.numBones;
+		if (header.numBones == 0 || header.bonesOffset == std::numeric_limits<uint32_t>::max())
 		{
-			if (header.numBones == 0 || header.bonesOffset == std::numeric_limits<uint32_t>::max())
-			{
-				continue;
-			}
-			if (header.bonesOffset + header.numBones * sizeof(_bones[0]) > fsize)
-			{
-				Fail("Bone value data goes beyond file");
-			}
-			stream.seekg(header.bonesOffset);
-			stream.read(reinterpret_cast<char*>(&_bones[counter]), header.numBones * sizeof(_bones[0]));
-			counter += header.numBones;
+			continue;
 		}
-		if (counter != totalBones)
+		if (!inFile(header.bonesOffset, header.numBones, sizeof(L3DBone)))
 		{
-			Fail("Could not account for bone values data");
+			Fail("Bone value data goes beyond file");
 		}
+		blocks.push_back({header.bonesOffset, header.numBones});
+	}
+	_bonesView = GatherBlocks(base, blocks, _bones);
+	if (_bonesView.size() != totalBones)
+	{
+		Fail("Could not account for bone values data");
 	}
 
 	// Create spans per submesh
-	_primitiveSpans.reserve(_submeshHeaders.size());
-	_boneSpans.reserve(_submeshHeaders.size());
+	_primitiveSpans.reserve(_submeshHeadersView.size());
+	_boneSpans.reserve(_submeshHeadersView.size());
 	{
 		uint32_t primitiveStart = 0;
 		uint32_t boneStart = 0;
-		for (auto& _submeshHeader : _submeshHeaders)
+		for (const auto& submeshHeader : _submeshHeadersView)
 		{
-			_primitiveSpans.emplace_back(_primitiveHeaders, primitiveStart, _submeshHeader.numPrimitives);
-			primitiveStart += _submeshHeader.numPrimitives;
-			_boneSpans.emplace_back(_bones, boneStart, _submeshHeader.numBones);
-			boneStart += _submeshHeader.numBones;
+			_primitiveSpans.emplace_back(_primitiveHeadersView, primitiveStart, submeshHeader.numPrimitives);
+			primitiveStart += submeshHeader.numPrimitives;
+			_boneSpans.emplace_back(_bonesView, boneStart, submeshHeader.numBones);
+			boneStart += submeshHeader.numBones;
 		}
 	}
 
 	// Create Primitive spans per submesh
-	_vertexSpans.reserve(_submeshHeaders.size());
-	_indexSpans.reserve(_submeshHeaders.size());
-	_vertexGroupSpans.reserve(_submeshHeaders.size());
+	_vertexSpans.reserve(_submeshHeadersView.size());
+	_indexSpans.reserve(_submeshHeadersView.size());
+	_vertexGroupSpans.reserve(_submeshHeadersView.size());
 	{
 		uint32_t vertexStart = 0;
 		uint32_t indexStart = 0;
 		uint32_t vertexGroupStart = 0;
-		for (uint32_t i = 0; i < _submeshHeaders.size(); ++i)
+		for (uint32_t i = 0; i < _submeshHeadersView.size(); ++i)
 		{
 			uint32_t vertexLength = 0;
 			uint32_t indexLength = 0;
@@ -504,9 +564,9 @@ void L3DFile::ReadFile(std::istream& stream)
 				vertexGroupLength += primitive.numGroups;
 			}
 
-			_vertexSpans.emplace_back(_vertices, vertexStart, vertexLength);
-			_indexSpans.emplace_back(_indices, indexStart, indexLength);
-			_vertexGroupSpans.emplace_back(_vertexGroups, vertexGroupStart, vertexGroupLength);
+			_vertexSpans.emplace_back(_verticesView, vertexStart, vertexLength);
+			_indexSpans.emplace_back(_indicesView, indexStart, indexLength);
+			_vertexGroupSpans.emplace_back(_vertexGroupsView, vertexGroupStart, vertexGroupLength);
 
 			vertexStart += vertexLength;
 			indexStart += indexLength;
@@ -621,25 +681,88 @@ void L3DFile::Open(const std::string& file)
 
 	_filename = file;
 
-	std::ifstream stream(_filename, std::ios::binary);
-
-	if (!stream.is_open())
+	std::size_t size;
+	_data = MapFile(_filename, size);
+	if (!_data)
 	{
-		Fail("Could not open file.");
+		// Empty files and files which can't be mapped go through the stream reader
+		std::ifstream stream(_filename, std::ios::binary);
+
+		if (!stream.is_open())
+		{
+			Fail("Could not open file.");
+		}
+
+		ReadFile(stream);
+		return;
 	}
 
-	ReadFile(stream);
+	ReadBuffer(size);
 }
 
 void L3DFile::Open(const std::vector<uint8_t>& buffer)
 {
 	assert(!_isLoaded);
 
-	imemstream stream(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(buffer[0]));
+	_filename = "buffer";
+
+	_data = CopyBuffer(buffer.data(), buffer.size() * sizeof(buffer[0]));
+
+	ReadBuffer(buffer.size() * sizeof(buffer[0]));
+}
+
+void L3DFile::Open(const uint8_t* buffer, std::size_t size)
+{
+	assert(!_isLoaded);
 
 	_filename = "buffer";
 
-	ReadFile(stream);
+	// Non-owning, the caller keeps the buffer alive
+	_data = std::shared_ptr<const uint8_t>(buffer, [](const uint8_t*) {});
+
+	ReadBuffer(size);
+}
+
+bool L3DFile::TryOpen(const std::string& file, std::string& error)
+{
+	try
+	{
+		Open(file);
+	}
+	catch (const std::runtime_error& exception)
+	{
+		error = exception.what();
+		return false;
+	}
+	return true;
+}
+
+bool L3DFile::TryOpen(const std::vector<uint8_t>& buffer, std::string& error)
+{
+	try
+	{
+		Open(buffer);
+	}
+	catch (const std::runtime_error& exception)
+	{
+		error = exception.what();
+		return false;
+	}
+	return true;
+}
+
+bool L3DFile::TryOpen(const uint8_t* buffer, std::size_t size, std::string& error)
+{
+	try
+	{
+		Open(buffer, size);
+	}
+	catch (const std::runtime_error& exception)
+	{
+		error = exception.what();
+		return false;
+	}
+	return true;
 }
 
 void L3DFile::Write(const std::string& file)
@@ -720,41 +843,46 @@ void L3DFile::Write(const std::string& file)
 void L3DFile::AddSubmesh(const L3DSubmeshHeader& header)
 {
 	_submeshHeaders.push_back(header);
+	_submeshHeadersView = View<L3DSubmeshHeader>(_submeshHeaders);
 }
 
 void L3DFile::AddPrimitives(const std::vector<L3DPrimitiveHeader>& headers)
 {
-	_primitiveSpans.emplace_back(_primitiveHeaders, static_cast<uint32_t>(_primitiveHeaders.size()),
+	_primitiveSpans.emplace_back(_primitiveHeadersView, static_cast<uint32_t>(_primitiveHeaders.size()),
 	                             static_cast<uint32_t>(headers.size()));
 	for (auto& header : headers)
 	{
 		_primitiveHeaders.push_back(header);
 	}
+	_primitiveHeadersView = View<L3DPrimitiveHeader>(_primitiveHeaders);
 }
 
 void L3DFile::AddVertices(const std::vector<L3DVertex>& vertices)
 {
-	_vertexSpans.emplace_back(_vertices, static_cast<uint32_t>(_vertices.size()), static_cast<uint32_t>(vertices.size()));
+	_vertexSpans.emplace_back(_verticesView, static_cast<uint32_t>(_vertices.size()), static_cast<uint32_t>(vertices.size()));
 	for (auto& vertex : vertices)
 	{
 		_vertices.push_back(vertex);
 	}
+	_verticesView = View<L3DVertex>(_vertices);
 }
 
 void L3DFile::AddIndices(const std::vector<uint16_t>& indices)
 {
-	_indexSpans.emplace_back(_indices, static_cast<uint32_t>(_indices.size()), static_cast<uint32_t>(indices.size()));
+	_indexSpans.emplace_back(_indicesView, static_cast<uint32_t>(_indices.size()), static_cast<uint32_t>(indices.size()));
 	for (auto& index : indices)
 	{
 		_indices.push_back(index);
 	}
+	_indicesView = View<uint16_t>(_indices);
 }
 
 void L3DFile::AddBones(const std::vector<L3DBone>& bones)
 {
-	_boneSpans.emplace_back(_bones, static_cast<uint32_t>(_bones.size()), static_cast<uint32_t>(bones.size()));
+	_boneSpans.emplace_back(_bonesView, static_cast<uint32_t>(_bones.size()), static_cast<uint32_t>(bones.size()));
 	for (auto& bone : bones)
 	{
 		_bones.push_back(bone);
 	}
+	_bonesView = View<L3DBone>(_bones);
 }
@@ -1,7 +1,15 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
+#include <cstdlib>
 #include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/vec2.hpp>
 
 namespace AnimationViewer {
 class ResourceManager;
@@ -22,10 +30,38 @@ public:
            std::chrono::microseconds& dt);
   bool should_quit() const;
 
+#ifdef __EMSCRIPTEN__
+  /// Import a file dropped on the canvas during the next run
+  ///
+  /// Takes ownership of @contents, which must be allocated with malloc.
+  void drop_buffer(std::string name, uint8_t* contents, size_t size);
+#endif
+
 protected:
   Input();
 
 private:
+  /// Remember where to place the meshes of a dropped file once it is imported
+  void track_drop(uint32_t ticket, const Window& window, const Ui& ui);
+
   bool quit_;
+  /// Screen position of meshes to add once the dropped file is imported, by import ticket
+  std::unordered_map<uint32_t, std::optional<glm::vec2>> pending_drops_;
+#ifdef __EMSCRIPTEN__
+  struct FreeDeleter
+  {
+    void operator()(uint8_t* contents) const { std::free(contents); }
+  };
+  using BufferPtr = std::unique_ptr<uint8_t, FreeDeleter>;
+  struct DroppedBuffer
+  {
+    std::string name;
+    BufferPtr contents;
+    size_t size;
+  };
+  std::vector<DroppedBuffer> dropped_buffers_;
+  /// Contents of dropped files, kept alive until their import has finished
+  std::unordered_map<uint32_t, BufferPtr> importing_buffers_;
+#endif
 };
 } // namespace AnimationViewer
@@ -6,6 +6,8 @@
 #include <utility>
 #include <vector>
 
+#include <glm/vec4.hpp>
+
 struct SDL_Window;
 typedef void* SDL_GLContext;
 
@@ -13,14 +15,20 @@ namespace AnimationViewer {
 class ResourceManager;
 class Scene;
 class Ui;
-struct vertex_t;
+namespace Resource {
+struct Mesh;
+struct MotionCapture;
+} // namespace Resource
 } // namespace AnimationViewer
 
 namespace AnimationViewer::Graphics {
 class Buffer;
+class InstanceBuffer;
 struct Framebuffer;
 struct IndexedMesh;
 class Pipeline;
+class RingBuffer;
+struct Texture;
 
 class Renderer
 {
@@ -39,7 +47,12 @@ public:
               const Ui& ui,
               const std::chrono::microseconds& dt);
   void set_back_buffer_size(uint16_t width, uint16_t height);
-  std::unique_ptr<IndexedMesh> upload_mesh(const std::vector<vertex_t>& vertices, const std::vector<uint16_t>& indices);
+  /// Uploads 16 bit indices when every index fits, 32 bit ones otherwise
+  std::unique_ptr<IndexedMesh> upload_mesh(const Resource::Mesh& mesh);
+  /// Uploads the points of every frame, split into chunks of whole frames when they do not fit in
+  /// one buffer
+  std::vector<std::unique_ptr<InstanceBuffer>> upload_motion_capture(
+    const Resource::MotionCapture& mocap);
   void* context_handle();
 
 protected:
@@ -49,6 +62,10 @@ private:
   void rebuild_back_buffers();
   void create_geometry();
   void create_pipeline();
+  /// Upload bone_palette_ to bone_palette_texture_, growing it when it has too few rows
+  void upload_bone_palettes();
+  /// Draw a joint disk for every three affine matrix rows of @instance_rows
+  void draw_joint_disks(const std::vector<glm::vec4>& instance_rows);
 
   std::unique_ptr<void, SDLDestroyer> context_;
   uint16_t width_;
@@ -56,11 +73,22 @@ private:
   std::unique_ptr<Framebuffer> back_buffer_;
   std::unique_ptr<IndexedMesh> full_screen_quad_;
   std::unique_ptr<IndexedMesh> disk_;
+  std::unique_ptr<IndexedMesh> line_;
+  std::unique_ptr<InstanceBuffer> mesh_instances_;
+  std::unique_ptr<InstanceBuffer> joint_instances_;
+  std::unique_ptr<InstanceBuffer> bone_line_instances_;
   std::unique_ptr<Buffer> rayleigh_sky_uniform_buffer_;
   std::unique_ptr<Pipeline> rayleigh_sky_pipeline_;
-  std::unique_ptr<Buffer> mesh_vertex_uniform_buffer_;
   std::unique_ptr<Pipeline> mesh_pipeline_;
+  /// Same as mesh_pipeline_ for meshes uploaded with packed vertices
+  std::unique_ptr<Pipeline> mesh_packed_pipeline_;
   std::unique_ptr<Pipeline> joint_pipeline_;
-  std::unique_ptr<Buffer> joint_disk_uniform_buffer_;
+  std::unique_ptr<Pipeline> bone_line_pipeline_;
+  std::unique_ptr<Pipeline> mocap_point_pipeline_;
+  /// Camera, mesh, joint and mocap uniforms of the current frame
+  std::unique_ptr<RingBuffer> uniform_ring_buffer_;
+  /// Palettes of the meshes drawn this frame, one value per texel of bone_palette_texture_
+  std::vector<glm::vec4> bone_palette_;
+  std::unique_ptr<Texture> bone_palette_texture_;
 };
 } // namespace AnimationViewer::Graphics
@@ -1,14 +1,22 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <filesystem>
+#include <limits>
+#include <list>
+#include <map>
 #include <memory>
 #include <optional>
+#include <span>
+#include <string>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
 #include <entt/core/hashed_string.hpp>
 #include <entt/resource/cache.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/matrix.hpp>
 #include <glm/vec3.hpp>
@@ -16,8 +24,20 @@
 namespace AnimationViewer {
 namespace Graphics {
 struct IndexedMesh;
+class InstanceBuffer;
 class Renderer;
 } // namespace Graphics
+namespace Compression {
+class CompressedAnimation;
+} // namespace Compression
+namespace Io {
+class AssetCache;
+} // namespace Io
+namespace Threading {
+class ThreadPool;
+template<typename T>
+class MpscQueue;
+} // namespace Threading
 
 struct vertex_t
 {
@@ -37,32 +57,206 @@ struct bone_t
 };
 
 namespace Resource {
+/// Bone hierarchy of a mesh, ordered so that it is evaluated in one forward pass
+struct Skeleton
+{
+  static constexpr uint32_t kNoParent = std::numeric_limits<uint32_t>::max();
+
+  /// Bone indices with every parent before its children
+  std::vector<uint32_t> order;
+  /// Parent of every bone, kNoParent for roots
+  std::vector<uint32_t> parents;
+  /// Rest pose of every bone relative to its parent and to the model
+  std::vector<glm::mat4> rest_local;
+  std::vector<glm::mat4> rest_global;
+  /// Inverse of the rest pose, from the model to the space of every bone
+  std::vector<glm::mat4> inverse_bind;
+
+  /// Sort @bones and cache their rest pose, parent cycles are cut
+  void build(std::span<const bone_t> bones);
+  /// Only sort bones with the parents @bone_parents, leaving the rest pose empty
+  void sort(std::span<const uint32_t> bone_parents);
+  /// Global matrix of every bone from the one relative to its parent
+  void local_to_global(std::span<const glm::mat4> locals, std::span<glm::mat4> globals) const;
+};
+
 struct Mesh
 {
+  /// Range of indices relative to a base vertex, addressing at most 65536 vertices
+  struct Submesh
+  {
+    uint32_t index_offset;
+    uint32_t index_count;
+    uint32_t base_vertex;
+  };
+
+  /// Range of indices drawing one level of detail
+  struct Lod
+  {
+    uint32_t index_offset;
+    uint32_t index_count;
+    /// How far the surface may be from the full detail one, relative to the bounding radius
+    float error;
+  };
+
   Mesh() = default;
   std::string name;
   std::optional<glm::mat4> default_matrix;
   std::vector<vertex_t> vertices;
+  /// Axis aligned bounds of the vertex positions, set by the import
+  glm::vec3 bounds_min = glm::vec3(0.0f);
+  glm::vec3 bounds_max = glm::vec3(0.0f);
   std::vector<bone_t> bones;
-  std::vector<uint16_t> indices;
+  /// Built from the bones by the import
+  Skeleton skeleton;
+  std::vector<uint32_t> indices;
+  /// Empty unless the mesh was split so that every submesh can be drawn with 16 bit indices
+  std::vector<Submesh> submeshes;
+  /// Empty when the mesh has a single level, otherwise one range of indices per level, finest
+  /// first, which all draw from the same vertices
+  std::vector<Lod> lods;
   std::unique_ptr<Graphics::IndexedMesh> gpu_resource;
 };
 
-struct AnimationFrame
-{
-  uint32_t time;
-  std::vector<glm::mat4> bones; // bones trans_rot (no bottom row)
-};
-
+/// Joint transforms of every frame, split into translation, rotation and scale channels which
+/// all live in one allocation, or compressed
 struct Animation
 {
+  /// Order of the samples within each channel
+  enum class Layout : uint32_t
+  {
+    /// [frame][joint], a whole pose is contiguous
+    FrameMajor,
+    /// [joint][frame], a whole track is contiguous
+    JointMajor,
+  };
+  /// Unit the samples are allocated in, every channel starts on one
+  struct alignas(64) SampleBlock
+  {
+    float values[16];
+  };
+  /// Largest difference from the samples compression may introduce
+  struct Tolerances
+  {
+    /// In the units of the translations
+    float position;
+    /// Angle in radians
+    float rotation;
+    float scale;
+  };
+
   Animation() = default;
   std::string name;
   float frame_rate;
   uint32_t frame_count;
   uint32_t animation_duration;
+  /// May be empty, otherwise one per joint
   std::vector<std::string> joint_names;
-  std::vector<AnimationFrame> keyframes;
+  /// Parent of every joint, Skeleton::kNoParent for roots. Empty when the joints are the bones of
+  /// the mesh the animation plays on, in bone order, and the samples are relative to their parent
+  /// bone. Otherwise the samples are relative to the parent joint.
+  std::vector<uint32_t> joint_parents;
+  /// Static transform between every joint and its parent joint, from nodes without samples in
+  /// between. Empty when there are none.
+  std::vector<glm::mat4> joint_offsets;
+  uint32_t joint_count;
+  Layout layout;
+  /// Time of every frame in microseconds
+  std::vector<uint32_t> frame_times;
+  /// Translations, rotations and scales of frame_count * joint_count samples each, empty once
+  /// the animation is compressed
+  std::vector<SampleBlock> samples;
+  std::unique_ptr<Compression::CompressedAnimation> compressed;
+
+  /// Size the channels for @frames frames of @joints joints, identity transforms at 0 time
+  void allocate(uint32_t frames, uint32_t joints, Layout sample_layout = Layout::FrameMajor);
+  /// Reorder the samples of every channel, keeping their values
+  void set_layout(Layout sample_layout);
+  /// Replace the samples by a compressed copy within @tolerances
+  void compress(const Tolerances& tolerances);
+  /// Position of the sample of @joint in @frame within each channel
+  size_t sample_index(uint32_t frame, uint32_t joint) const
+  {
+    return layout == Layout::FrameMajor ? size_t{ frame } * joint_count + joint
+                                        : size_t{ joint } * frame_count + frame;
+  }
+  /// Channels of the samples, empty once the animation is compressed
+  std::span<glm::vec3> translations();
+  std::span<const glm::vec3> translations() const;
+  std::span<glm::quat> rotations();
+  std::span<const glm::quat> rotations() const;
+  std::span<glm::vec3> scales();
+  std::span<const glm::vec3> scales() const;
+  /// Translation, rotation and scale of one joint in one frame, from the samples or decompressed
+  void sample(uint32_t frame,
+              uint32_t joint,
+              glm::vec3& translation,
+              glm::quat& rotation,
+              glm::vec3& scale) const;
+  /// Translation, rotation and scale of every joint, fractional frames interpolate linearly
+  /// between frames. Every span must hold joint_count values.
+  void sample_pose(float frame,
+                   std::span<glm::vec3> translations,
+                   std::span<glm::quat> rotations,
+                   std::span<glm::vec3> scales) const;
+  /// Translation * rotation * scale of one joint in one frame
+  glm::mat4 transform(uint32_t frame, uint32_t joint) const;
+  /// Store the translation, rotation and scale of one joint in one frame
+  void set_sample(uint32_t frame,
+                  uint32_t joint,
+                  const glm::vec3& translation,
+                  const glm::quat& rotation,
+                  const glm::vec3& scale);
+  /// Store a translation * rotation * scale matrix, as local transforms are, any shear is lost
+  void set_transform(uint32_t frame, uint32_t joint, const glm::mat4& transform);
+  /// Blocks needed for the channels of @sample_count samples
+  static size_t block_count(size_t sample_count);
+
+private:
+  size_t rotations_block() const;
+  size_t scales_block() const;
+  size_t sample_count() const;
+};
+
+/// Global joint matrices of an animation played on the skeleton of a mesh
+///
+/// Frames are evaluated when they are first asked for and only the most recently used ones are
+/// kept, so setting one up costs no more than a pass over the bones.
+struct PoseCache
+{
+  static constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+  ENTT_ID_TYPE mesh_id;
+  ENTT_ID_TYPE animation_id;
+  uint32_t frame_count;
+  uint32_t joint_count;
+  Skeleton skeleton;
+  /// Joints are the bones, in bone order, instead of matched to them by name
+  bool local_joints;
+  /// Parents first order of the animation joints, when they are not the bones
+  Skeleton joint_hierarchy;
+  /// Animation joint driving every bone, kNone for bones which stay in their rest pose
+  std::vector<uint32_t> joints;
+  /// Frames kept at most, 0 evaluates a frame again every time it is asked for
+  uint32_t capacity;
+
+  /// Global matrix of every bone in @frame of @animation, valid until the next call
+  std::span<const glm::mat4> pose(const Animation& animation, uint32_t frame);
+
+private:
+  void evaluate(const Animation& animation, uint32_t frame, std::span<glm::mat4> pose);
+
+  /// Frames in the cache and the slot holding their matrices, most recently used first
+  std::list<std::pair<uint32_t, uint32_t>> recent_;
+  std::unordered_map<uint32_t, std::list<std::pair<uint32_t, uint32_t>>::iterator> cached_;
+  /// joint_count matrices per slot
+  std::vector<glm::mat4> slots_;
+  /// Samples and local matrices of every animation joint of the frame being evaluated, the
+  /// matrices become global in place when the joints are not the bones
+  std::vector<glm::vec3> translations_;
+  std::vector<glm::quat> rotations_;
+  std::vector<glm::vec3> scales_;
+  std::vector<glm::mat4> locals_;
 };
 
 struct MotionCapture
@@ -73,6 +267,8 @@ struct MotionCapture
   uint32_t point_count;
   /// Flat array of frame count * point count, with all points in one frame sequential
   std::vector<glm::vec3> frame_points;
+  /// frame_points in consecutive chunks of whole frames, all as large as the first one
+  std::vector<std::unique_ptr<Graphics::InstanceBuffer>> gpu_resources;
 };
 } // namespace Resource
 
@@ -86,35 +282,207 @@ public:
     MotionCapture = 1u << 2u,
   };
 
+  /// Backend used for FBX files, both can be compared on the same file
+  enum class FbxImporter
+  {
+    OpenFbx,
+    Assimp,
+  };
+
+  /// Post-processing Assimp runs on a scene before it is converted
+  enum class AssimpProfile
+  {
+    /// No post-processing and no meshes, only the node hierarchy and animations are converted
+    AnimationOnly,
+    /// Just what the mesh conversion needs: triangles, normals and shared vertices
+    FastPreview,
+    /// aiProcessPreset_TargetRealtime_MaxQuality
+    MaxQuality,
+  };
+
+  /// Identifies one call to load_file until its import has finished
+  using Ticket = uint32_t;
+
+  /// Progress of a file import, written by an import worker and read by the main thread
+  struct ImportStatus
+  {
+    enum class State
+    {
+      Queued,
+      Running,
+      Finished,
+      Failed,
+    };
+
+    explicit ImportStatus(std::string file_name);
+
+    const std::string name;
+    std::atomic<State> state;
+    std::atomic<float> progress;
+    /// Resources were read from the asset cache instead of being converted
+    std::atomic<bool> cache_hit;
+    /// Name of the importer handling the file, empty until the worker picked one
+    std::atomic<const char*> importer;
+    /// Wall time of the import in seconds, set once it has finished
+    std::atomic<float> duration;
+    /// Seconds spent in each step of the importer, set by finish_imports on the main thread
+    std::vector<std::pair<std::string, float>> phases;
+    /// Why the import failed when the importer could tell, set by finish_imports like phases
+    std::string error;
+    /// Effect of the mesh optimization on each mesh, set by finish_imports like phases
+    struct MeshOptimization
+    {
+      std::string mesh;
+      uint32_t vertices_before;
+      uint32_t vertices_after;
+      /// Average cache miss ratio, transformed vertices per triangle
+      float acmr_before;
+      float acmr_after;
+      /// Triangles of every level of detail, finest first
+      std::vector<uint32_t> lod_triangles;
+    };
+    std::vector<MeshOptimization> optimized_meshes;
+    /// Effect of the compression on each animation, set by finish_imports like phases
+    struct AnimationCompression
+    {
+      std::string animation;
+      size_t raw_bytes;
+      size_t compressed_bytes;
+      /// Largest difference from the samples over every frame and joint
+      float max_position_error;
+      float max_rotation_error;
+      float max_scale_error;
+    };
+    std::vector<AnimationCompression> compressed_animations;
+  };
+
+  /// Resources produced by a finished import, already inserted in the caches
+  struct FinishedImport
+  {
+    Ticket ticket;
+    std::vector<std::pair<ENTT_ID_TYPE, Type>> resources;
+  };
+
   static std::unique_ptr<ResourceManager> create();
   virtual ~ResourceManager();
 
   /// Use the rendering device/context to upload cpu_resources into gpu_resources
   void upload_dirty_buffers(Graphics::Renderer& renderer);
 
-  /// Load file from path and detect type before loading as mesh or animation
+  /// Queue a file to be imported on a worker thread and return without waiting for it
   ///
+  /// The type is detected before loading as mesh, animation or motion capture on the worker.
   /// @path is the path of the file to load
-  std::vector<std::pair<entt::hashed_string, Type>> load_file(const std::filesystem::path& path);
+  Ticket load_file(const std::filesystem::path& path);
+
+  /// Queue a file which is already in memory to be imported, like load_file
+  ///
+  /// The type is detected from the contents, @name is used like the path of a file: it names the
+  /// resources and its extension identifies formats without a magic number. @contents are parsed
+  /// in place and must stay alive until the import with the returned ticket has finished.
+  Ticket load_buffer(std::span<const uint8_t> contents, const std::string& name);
+
+  /// Move the resources of all imports finished since the last call into the caches
+  ///
+  /// Must be called from the main thread, like every other non-const member.
+  std::vector<FinishedImport> finish_imports();
+
+  /// All imports which were not cleared, in the order they were queued
+  const std::vector<std::shared_ptr<ImportStatus>>& imports() const;
+  void clear_finished_imports();
+
+  /// Applies to imports queued after the call
+  void set_fbx_importer(FbxImporter importer);
+  FbxImporter fbx_importer() const;
+  /// Applies to imports queued after the call
+  void set_assimp_profile(AssimpProfile profile);
+  AssimpProfile assimp_profile() const;
+  /// Weld identical vertices and reorder triangles and vertices of imported meshes for the
+  /// post-transform cache and vertex fetch, applies to imports queued after the call
+  void set_optimize_meshes(bool optimize);
+  bool optimize_meshes() const;
+  /// Split meshes over 65536 vertices into submeshes with 16 bit indices instead of drawing them
+  /// with 32 bit ones, applies to imports queued after the call
+  void set_split_large_meshes(bool split);
+  bool split_large_meshes() const;
+  /// Simplify imported meshes without authored levels of detail into a chain of coarser levels
+  /// the renderer picks from by their size on screen, applies to imports queued after the call
+  void set_generate_lods(bool generate);
+  bool generate_lods() const;
+  /// Order of the samples of imported animations, applies to imports queued after the call
+  void set_animation_layout(Resource::Animation::Layout layout);
+  Resource::Animation::Layout animation_layout() const;
+  /// Compress imported animations by dropping keys and quantizing the ones left within the
+  /// animation tolerances, applies to imports queued after the call
+  void set_compress_animations(bool compress);
+  bool compress_animations() const;
+  void set_animation_tolerances(const Resource::Animation::Tolerances& tolerances);
+  const Resource::Animation::Tolerances& animation_tolerances() const;
 
   const entt::cache<Resource::Mesh>& mesh_cache() const;
   const entt::cache<Resource::Animation>& animation_cache() const;
   const entt::cache<Resource::MotionCapture>& motion_capture_cache() const;
 
+  /// Global joint matrices of the frames of an animation on the skeleton of a mesh
+  ///
+  /// Created on the first request for a pair and shared with every later one, the cache is freed
+  /// when the last returned pointer is released.
+  std::shared_ptr<Resource::PoseCache> acquire_pose_cache(ENTT_ID_TYPE mesh_id,
+                                                          ENTT_ID_TYPE animation_id);
+  /// Frames every pose cache keeps, applies to caches created after the call
+  void set_pose_cache_frames(uint32_t frames);
+  uint32_t pose_cache_frames() const;
+
 protected:
+  /// File or buffer an import reads from
+  struct ImportSource;
+  /// Resources converted by a worker and waiting for the main thread to adopt them
+  struct ImportResult;
+
   ResourceManager(entt::cache<Resource::Mesh>&& mesh_cache,
-                  entt::cache<Resource::Animation>&& animation_cache);
+                  entt::cache<Resource::Animation>&& animation_cache,
+                  std::unique_ptr<Io::AssetCache>&& asset_cache,
+                  std::unique_ptr<Threading::ThreadPool>&& import_pool);
+
+  Ticket queue_import(ImportSource&& source);
 
-  std::optional<entt::hashed_string> load_l3d_file(const std::filesystem::path& path);
-  std::vector<std::pair<entt::hashed_string, Type>> load_fbx_file(const std::filesystem::path& path);
-  std::optional<entt::hashed_string> load_anm_file(const std::filesystem::path& path);
-  std::optional<entt::hashed_string> load_bvh_file(const std::filesystem::path& path);
-  std::optional<entt::hashed_string> load_c3d_file(const std::filesystem::path& path);
-  std::vector<std::pair<entt::hashed_string, Type>> load_assimp_file(const std::filesystem::path& path, bool skip_meshes);
+  // Loaders run on import workers, they must not touch the caches
+  bool import_file(const ImportSource& source, ImportResult& result) const;
+  /// Bounds, optimization and splitting of the meshes of a successful import
+  void post_process_meshes(ImportResult& result) const;
+  /// Layout and compression of the animations of a successful import
+  void post_process_animations(ImportResult& result) const;
+  bool load_l3d_file(const ImportSource& source, ImportResult& result) const;
+  bool load_fbx_file(const ImportSource& source, ImportResult& result) const;
+  bool load_anm_file(const ImportSource& source, ImportResult& result) const;
+  bool load_bvh_file(const ImportSource& source, ImportResult& result) const;
+  bool load_c3d_file(const ImportSource& source, ImportResult& result) const;
+  bool load_assimp_file(const ImportSource& source,
+                        AssimpProfile profile,
+                        ImportResult& result) const;
 
 private:
   entt::cache<Resource::Mesh> mesh_cache_;
   entt::cache<Resource::Animation> animation_cache_;
   entt::cache<Resource::MotionCapture> motion_capture_cache_;
+  /// Pose caches which are still in use, keyed by mesh and animation id
+  std::map<std::pair<ENTT_ID_TYPE, ENTT_ID_TYPE>, std::weak_ptr<Resource::PoseCache>>
+    pose_caches_;
+  std::unique_ptr<Threading::MpscQueue<ImportResult>> finished_imports_;
+  std::vector<std::shared_ptr<ImportStatus>> imports_;
+  Ticket next_ticket_;
+  FbxImporter fbx_importer_;
+  AssimpProfile assimp_profile_;
+  bool optimize_meshes_;
+  bool split_large_meshes_;
+  bool generate_lods_;
+  Resource::Animation::Layout animation_layout_;
+  bool compress_animations_;
+  Resource::Animation::Tolerances animation_tolerances_;
+  uint32_t pose_cache_frames_;
+  /// May be null when there is no writable cache directory
+  std::unique_ptr<Io::AssetCache> asset_cache_;
+  // Declared last so workers are joined before anything they write to is destroyed
+  std::unique_ptr<Threading::ThreadPool> import_pool_;
 };
 } // namespace AnimationViewer
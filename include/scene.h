@@ -14,6 +14,9 @@ union SDL_Event;
 
 namespace AnimationViewer {
 class ResourceManager;
+namespace Resource {
+struct PoseCache;
+} // namespace Resource
 
 namespace Components {
 struct Transform
@@ -48,7 +51,12 @@ struct Animation
   uint32_t current_time = 0;
   bool animating = false;
   bool loop = false;
-  std::vector<std::vector<glm::mat4>> transformed_matrices;
+  /// Shared with every entity playing the same animation on the same mesh
+  std::shared_ptr<Resource::PoseCache> poses;
+  /// Global joint matrices of current_frame and the frame after it, set by Scene::update
+  std::optional<uint32_t> evaluated_frame;
+  std::vector<glm::mat4> current_pose;
+  std::vector<glm::mat4> next_pose;
 };
 struct MotionCaptureAnimation
 {
@@ -78,7 +86,7 @@ public:
                 const ResourceManager& resource_manager);
   bool attach_animation(const entt::entity& entity,
                         ENTT_ID_TYPE animation_id,
-                        const ResourceManager& resource_manager);
+                        ResourceManager& resource_manager);
 
   /// A scene can have any number of cameras including zero
   /// This returns the camera selected for rendering or a default camera
@@ -38,10 +38,10 @@ public:
            std::chrono::microseconds& dt);
   void entity_dnd_target(Scene& scene,
                          const entt::entity& entity,
-                         const ResourceManager& resource_manager);
+                         ResourceManager& resource_manager);
   bool entity_accept_animation(Scene& scene,
                                const entt::entity& entity,
-                               const ResourceManager& resource_manager);
+                               ResourceManager& resource_manager);
   bool entity_accept_mocap(Scene& scene,
                            const entt::entity& entity,
                            const ResourceManager& resource_manager);
@@ -62,6 +62,7 @@ private:
   bool show_assets_;
   bool show_scene_;
   bool show_components_;
+  bool show_imports_;
   bool scene_window_hovered_;
   bool show_nodes_;
   float node_size_;
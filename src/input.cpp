@@ -23,18 +23,11 @@ extern "C"
   void EMSCRIPTEN_KEEPALIVE // Required to be export
   animation_viewer_ui_load_file_contents(Input* input,
                                          const char* file_name,
-                                         const uint8_t* contents,
+                                         uint8_t* contents,
                                          size_t size_)
   {
-    FILE* file = fopen(file_name, "wb");
-    fwrite(contents, size_, size_, file);
-    fclose(file);
-    SDL_Event event = {};
-    event.type = SDL_DROPFILE;
-    event.drop.timestamp = SDL_GetTicks();
-    event.drop.file = (char*)SDL_malloc(size_);
-    memcpy(event.drop.file, file_name, size_);
-    SDL_PushEvent(&event);
+    // The contents are imported in place and freed once the import has finished
+    input->drop_buffer(file_name, contents, size_);
   }
 }
 
@@ -60,21 +53,17 @@ animation_viewer_emscripten_install_drop_handler(Input& input)
           for (var i = 0, file; file = files[i]; i++) {
             var reader = new FileReader();
             reader.onload = (function(f) {
-              var len = lengthBytesUTF8(f.name) + 1;
-              var file_name = stackAlloc(len);
-              stringToUTF8(f.name, file_name, len);
               return function(ev2)
               {
                 var file_contents = _malloc(ev2.target.result.byteLength);
                 var heap_bytes =
                   new Uint8Array(HEAPU8.buffer, file_contents, ev2.target.result.byteLength);
                 heap_bytes.set(new Uint8Array(ev2.target.result));
+                // Ownership of file_contents passes to the application
                 ccall('animation_viewer_ui_load_file_contents',
                       'v',
-                      'isii',
-                      [ $0, file_name, file_contents, ev2.target.result.byteLength ],
-                      []);
-                _free(file_contents);
+                      [ 'number', 'string', 'number', 'number' ],
+                      [ $0, f.name, file_contents, ev2.target.result.byteLength ]);
               };
             })(file);
             reader.readAsArrayBuffer(file);
@@ -113,6 +102,14 @@ Input::~Input()
 #endif
 }
 
+#ifdef __EMSCRIPTEN__
+void
+Input::drop_buffer(std::string name, uint8_t* contents, size_t size)
+{
+  dropped_buffers_.push_back({ std::move(name), BufferPtr(contents), size });
+}
+#endif
+
 void
 Input::run(const Window& window,
            Ui& ui,
@@ -216,28 +213,52 @@ Input::run(const Window& window,
         break;
       case SDL_DROPFILE: {
         const auto path = std::filesystem::path(event.drop.file);
-        glm::ivec2 mouse_position;
-        SDL_GetMouseState(&mouse_position.x, &mouse_position.y);
-        glm::u16vec2 resolution;
-        window.get_dimensions(resolution.x, resolution.y);
-        glm::vec2 screen_space_position =
-          static_cast<glm::vec2>(mouse_position) / static_cast<glm::vec2>(resolution);
-        auto resources = resource_manager.load_file(path);
-        for (auto& [str, type] : resources) {
-          if (type & ResourceManager::Type::Mesh) {
-            if (!ui.has_mouse()) {
-              scene.add_mesh(str, screen_space_position, resource_manager);
-            } else if (ui.mouse_over_scene_window()) {
-              scene.add_mesh(str, std::nullopt, resource_manager);
-            }
-          }
-        }
+        track_drop(resource_manager.load_file(path), window, ui);
+      } break;
+    }
+  }
+
 #ifdef __EMSCRIPTEN__
-        // Files are created at runtime in memory, free this memory after load
-        // std::filesystem::remove(path);
+  for (auto& dropped : dropped_buffers_) {
+    auto ticket =
+      resource_manager.load_buffer({ dropped.contents.get(), dropped.size }, dropped.name);
+    track_drop(ticket, window, ui);
+    importing_buffers_.emplace(ticket, std::move(dropped.contents));
+  }
+  dropped_buffers_.clear();
 #endif
-      } break;
+
+  for (auto& [ticket, resources] : resource_manager.finish_imports()) {
+#ifdef __EMSCRIPTEN__
+    importing_buffers_.erase(ticket);
+#endif
+    auto drop = pending_drops_.find(ticket);
+    if (drop == pending_drops_.end()) {
+      continue;
+    }
+    for (auto& [id, type] : resources) {
+      if (type & ResourceManager::Type::Mesh) {
+        scene.add_mesh(id, drop->second, resource_manager);
+      }
     }
+    pending_drops_.erase(drop);
+  }
+}
+
+void
+Input::track_drop(uint32_t ticket, const Window& window, const Ui& ui)
+{
+  glm::ivec2 mouse_position;
+  SDL_GetMouseState(&mouse_position.x, &mouse_position.y);
+  glm::u16vec2 resolution;
+  window.get_dimensions(resolution.x, resolution.y);
+  glm::vec2 screen_space_position =
+    static_cast<glm::vec2>(mouse_position) / static_cast<glm::vec2>(resolution);
+  // Decide on placement now, the mouse will have moved by the time the import is done
+  if (!ui.has_mouse()) {
+    pending_drops_.emplace(ticket, screen_space_position);
+  } else if (ui.mouse_over_scene_window()) {
+    pending_drops_.emplace(ticket, std::nullopt);
   }
 }
 
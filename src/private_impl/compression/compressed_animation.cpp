@@ -0,0 +1,421 @@
+#include "compressed_animation.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <type_traits>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+using namespace AnimationViewer;
+using namespace AnimationViewer::Compression;
+
+namespace {
+/// Frames per block, a power of two so the frame within a block fits the 8 bits of a key frame
+constexpr uint32_t kBlockShift = 8;
+constexpr uint32_t kBlockFrames = 1u << kBlockShift;
+
+constexpr float kVectorSteps = 65535.0f;
+/// Components other than the largest of a unit quaternion are within +-1/sqrt(2)
+constexpr float kSmallestThreeRange = 0.70710678f;
+constexpr float kRotationSteps = 32767.0f;
+
+glm::vec3
+interpolate(const glm::vec3& a, const glm::vec3& b, float factor)
+{
+  return a + (b - a) * factor;
+}
+
+/// Normalized linear interpolation along the shorter arc
+glm::quat
+interpolate(const glm::quat& a, glm::quat b, float factor)
+{
+  if (glm::dot(a, b) < 0.0f) {
+    b = -b;
+  }
+  return glm::normalize(a * (1.0f - factor) + b * factor);
+}
+
+/// Angle of the rotation between @a and @b
+///
+/// 2 acos(|a.b|) moves in steps of about 7e-4 radians near 0, as the dot product rounds to 1, so
+/// the angle is taken from the chord between the quaternions instead.
+float
+rotation_error(const glm::quat& a, glm::quat b)
+{
+  if (glm::dot(a, b) < 0.0f) {
+    b = -b;
+  }
+  auto difference = a - b;
+  auto sum = a + b;
+  return 4.0f * std::atan2(std::sqrt(glm::dot(difference, difference)),
+                           std::sqrt(glm::dot(sum, sum)));
+}
+
+float
+vector_error(const glm::vec3& a, const glm::vec3& b)
+{
+  return glm::length(a - b);
+}
+
+/// Largest component dropped, the other three in 15 bits each and its index in the top bits of
+/// the first two
+void
+encode_smallest_three(glm::quat rotation, uint16_t* encoded)
+{
+  rotation = glm::normalize(rotation);
+  int largest = 0;
+  for (int i = 1; i < 4; ++i) {
+    if (std::abs(rotation[i]) > std::abs(rotation[largest])) {
+      largest = i;
+    }
+  }
+  // q and -q are the same rotation, the dropped component is always positive
+  if (rotation[largest] < 0.0f) {
+    rotation = -rotation;
+  }
+  int component = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (i == largest) {
+      continue;
+    }
+    auto normalized = std::clamp(rotation[i] / kSmallestThreeRange, -1.0f, 1.0f) * 0.5f + 0.5f;
+    encoded[component++] = static_cast<uint16_t>(std::lround(normalized * kRotationSteps));
+  }
+  encoded[0] |= static_cast<uint16_t>((largest & 1) << 15);
+  encoded[1] |= static_cast<uint16_t>((largest >> 1) << 15);
+}
+
+glm::quat
+decode_smallest_three(const uint16_t* encoded)
+{
+  int largest = (encoded[0] >> 15) | ((encoded[1] >> 15) << 1);
+  glm::quat rotation;
+  float sum = 0.0f;
+  int component = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (i == largest) {
+      continue;
+    }
+    auto value = static_cast<float>(encoded[component++] & 0x7FFF) / kRotationSteps;
+    rotation[i] = (value * 2.0f - 1.0f) * kSmallestThreeRange;
+    sum += rotation[i] * rotation[i];
+  }
+  rotation[largest] = std::sqrt(std::max(1.0f - sum, 0.0f));
+  return rotation;
+}
+} // namespace
+
+std::unique_ptr<CompressedAnimation>
+CompressedAnimation::create(const Resource::Animation& animation,
+                            const Resource::Animation::Tolerances& tolerances)
+{
+  auto compressed = std::unique_ptr<CompressedAnimation>(
+    new CompressedAnimation(animation.frame_count, animation.joint_count));
+  auto& statistics = compressed->statistics_;
+  statistics.raw_bytes = animation.samples.size() * sizeof(Resource::Animation::SampleBlock);
+
+  // Gathered per joint, so it works with either layout
+  std::vector<glm::vec3> translations(animation.frame_count);
+  std::vector<glm::quat> rotations(animation.frame_count);
+  std::vector<glm::vec3> scales(animation.frame_count);
+  compressed->tracks_.resize(size_t{ animation.joint_count } * 3);
+  for (uint32_t joint = 0; joint < animation.joint_count; ++joint) {
+    for (uint32_t frame = 0; frame < animation.frame_count; ++frame) {
+      auto sample = animation.sample_index(frame, joint);
+      translations[frame] = animation.translations()[sample];
+      rotations[frame] = animation.rotations()[sample];
+      scales[frame] = animation.scales()[sample];
+    }
+    auto* tracks = &compressed->tracks_[size_t{ joint } * 3];
+    statistics.max_position_error =
+      std::max(statistics.max_position_error,
+               compressed->compress_vector_track(tracks[0], translations, tolerances.position));
+    statistics.max_rotation_error =
+      std::max(statistics.max_rotation_error,
+               compressed->compress_rotation_track(tracks[1], rotations, tolerances.rotation));
+    statistics.max_scale_error =
+      std::max(statistics.max_scale_error,
+               compressed->compress_vector_track(tracks[2], scales, tolerances.scale));
+  }
+
+  for (const auto& track : compressed->tracks_) {
+    if (track.key_count == 0) {
+      ++statistics.constant_tracks;
+    } else {
+      ++statistics.animated_tracks;
+    }
+  }
+  statistics.keys = static_cast<uint32_t>(compressed->key_frames_.size());
+  compressed->tracks_.shrink_to_fit();
+  compressed->key_frames_.shrink_to_fit();
+  compressed->vector_keys_.shrink_to_fit();
+  compressed->rotation_keys_.shrink_to_fit();
+  compressed->block_keys_.shrink_to_fit();
+  statistics.compressed_bytes = sizeof(CompressedAnimation) +
+                                compressed->tracks_.size() * sizeof(Track) +
+                                compressed->key_frames_.size() * sizeof(uint8_t) +
+                                compressed->vector_keys_.size() * sizeof(uint16_t) +
+                                compressed->rotation_keys_.size() * sizeof(uint16_t) +
+                                compressed->block_keys_.size() * sizeof(uint32_t);
+  return compressed;
+}
+
+CompressedAnimation::CompressedAnimation(uint32_t frame_count, uint32_t joint_count)
+  : frame_count_(frame_count)
+  , joint_count_(joint_count)
+  , statistics_{ 0, 0, 0, 0, 0, 0.0f, 0.0f, 0.0f }
+{}
+
+CompressedAnimation::~CompressedAnimation() = default;
+
+uint32_t
+CompressedAnimation::frame_count() const
+{
+  return frame_count_;
+}
+
+uint32_t
+CompressedAnimation::joint_count() const
+{
+  return joint_count_;
+}
+
+const CompressedAnimation::Statistics&
+CompressedAnimation::statistics() const
+{
+  return statistics_;
+}
+
+void
+CompressedAnimation::sample(float frame,
+                            uint32_t joint,
+                            glm::vec3& translation,
+                            glm::quat& rotation,
+                            glm::vec3& scale) const
+{
+  assert(joint < joint_count_);
+  const auto* tracks = &tracks_[size_t{ joint } * 3];
+  translation = sample_vector(tracks[0], frame);
+  rotation = sample_rotation(tracks[1], frame);
+  scale = sample_vector(tracks[2], frame);
+}
+
+void
+CompressedAnimation::sample(float frame,
+                            std::span<glm::vec3> translations,
+                            std::span<glm::quat> rotations,
+                            std::span<glm::vec3> scales) const
+{
+  assert(translations.size() >= joint_count_ && rotations.size() >= joint_count_ &&
+         scales.size() >= joint_count_);
+  for (uint32_t joint = 0; joint < joint_count_; ++joint) {
+    sample(frame, joint, translations[joint], rotations[joint], scales[joint]);
+  }
+}
+
+void
+CompressedAnimation::find_keys(const Track& track, float frame, uint32_t& key, float& factor) const
+{
+  auto last_frame = static_cast<float>(frame_count_ - 1);
+  frame = std::clamp(frame, 0.0f, last_frame);
+  auto whole = static_cast<uint32_t>(frame);
+  auto block = whole >> kBlockShift;
+  // The first key of a block is on its first frame, so the search never leaves the block
+  const auto* block_keys = &block_keys_[track.first_block];
+  const auto* frames = &key_frames_[track.first_key];
+  auto within = static_cast<uint8_t>(whole & (kBlockFrames - 1));
+  auto found =
+    std::upper_bound(frames + block_keys[block], frames + block_keys[block + 1], within);
+  key = static_cast<uint32_t>(found - frames) - 1;
+  if (key + 1 >= track.key_count) {
+    factor = 0.0f;
+    return;
+  }
+  auto key_frame = static_cast<float>((block << kBlockShift) + frames[key]);
+  // The next key is either later in this block or the first frame of the next one
+  auto next_frame = key + 1 < block_keys[block + 1]
+                      ? static_cast<float>((block << kBlockShift) + frames[key + 1])
+                      : static_cast<float>((block + 1) << kBlockShift);
+  factor = (frame - key_frame) / (next_frame - key_frame);
+}
+
+glm::vec3
+CompressedAnimation::sample_vector(const Track& track, float frame) const
+{
+  if (track.key_count == 0) {
+    return glm::vec3(track.base);
+  }
+  uint32_t key;
+  float factor;
+  find_keys(track, frame, key, factor);
+  if (factor <= 0.0f) {
+    return decode_vector(track, key);
+  }
+  return interpolate(decode_vector(track, key), decode_vector(track, key + 1), factor);
+}
+
+glm::quat
+CompressedAnimation::sample_rotation(const Track& track, float frame) const
+{
+  if (track.key_count == 0) {
+    return glm::quat(track.base.w, track.base.x, track.base.y, track.base.z);
+  }
+  uint32_t key;
+  float factor;
+  find_keys(track, frame, key, factor);
+  if (factor <= 0.0f) {
+    return decode_rotation(track, key);
+  }
+  return interpolate(decode_rotation(track, key), decode_rotation(track, key + 1), factor);
+}
+
+glm::vec3
+CompressedAnimation::decode_vector(const Track& track, uint32_t key) const
+{
+  const auto* encoded = &vector_keys_[(size_t{ track.first_value } + key) * 3];
+  return glm::vec3(track.base) +
+         track.extent * glm::vec3(encoded[0], encoded[1], encoded[2]) / kVectorSteps;
+}
+
+glm::quat
+CompressedAnimation::decode_rotation(const Track& track, uint32_t key) const
+{
+  return decode_smallest_three(&rotation_keys_[(size_t{ track.first_value } + key) * 3]);
+}
+
+float
+CompressedAnimation::compress_vector_track(Track& track,
+                                           std::span<const glm::vec3> values,
+                                           float tolerance)
+{
+  track = { 0, 0, 0, 0, glm::vec4(values.empty() ? glm::vec3(0.0f) : values[0], 0.0f), {} };
+  float constant_error = 0.0f;
+  for (const auto& value : values) {
+    constant_error = std::max(constant_error, vector_error(value, values[0]));
+  }
+  if (constant_error <= tolerance) {
+    return constant_error;
+  }
+
+  glm::vec3 min = values[0];
+  glm::vec3 max = values[0];
+  for (const auto& value : values) {
+    min = glm::min(min, value);
+    max = glm::max(max, value);
+  }
+  track.base = glm::vec4(min, 0.0f);
+  track.extent = max - min;
+  auto quantize = [&track](const glm::vec3& value) {
+    std::array<uint16_t, 3> encoded{};
+    for (glm::length_t i = 0; i < 3; ++i) {
+      auto normalized =
+        track.extent[i] > 0.0f ? (value[i] - track.base[i]) / track.extent[i] : 0.0f;
+      normalized = std::clamp(normalized, 0.0f, 1.0f);
+      encoded[i] = static_cast<uint16_t>(std::lround(normalized * kVectorSteps));
+    }
+    return encoded;
+  };
+  std::vector<glm::vec3> decoded(values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    auto encoded = quantize(values[i]);
+    decoded[i] = glm::vec3(track.base) +
+                 track.extent * glm::vec3(encoded[0], encoded[1], encoded[2]) / kVectorSteps;
+  }
+  return reduce_keys<glm::vec3>(
+    track, values, decoded, tolerance, vector_error, [this, &quantize](const glm::vec3& value) {
+      auto encoded = quantize(value);
+      vector_keys_.insert(vector_keys_.end(), encoded.begin(), encoded.end());
+    });
+}
+
+float
+CompressedAnimation::compress_rotation_track(Track& track,
+                                             std::span<const glm::quat> values,
+                                             float tolerance)
+{
+  auto first = values.empty() ? glm::quat(1.0f, 0.0f, 0.0f, 0.0f) : values[0];
+  track = { 0, 0, 0, 0, glm::vec4(first.x, first.y, first.z, first.w), {} };
+  float constant_error = 0.0f;
+  for (const auto& value : values) {
+    constant_error = std::max(constant_error, rotation_error(value, first));
+  }
+  if (constant_error <= tolerance) {
+    return constant_error;
+  }
+
+  std::vector<glm::quat> decoded(values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    uint16_t encoded[3];
+    encode_smallest_three(values[i], encoded);
+    decoded[i] = decode_smallest_three(encoded);
+  }
+  return reduce_keys<glm::quat>(
+    track, values, decoded, tolerance, rotation_error, [this](const glm::quat& value) {
+      uint16_t encoded[3];
+      encode_smallest_three(value, encoded);
+      rotation_keys_.insert(rotation_keys_.end(), encoded, encoded + 3);
+    });
+}
+
+template<typename T, typename Error, typename Encode>
+float
+CompressedAnimation::reduce_keys(Track& track,
+                                 std::span<const T> values,
+                                 std::span<const T> decoded,
+                                 float tolerance,
+                                 Error error,
+                                 Encode encode)
+{
+  auto frame_count = static_cast<uint32_t>(values.size());
+  track.key_count = 0;
+  track.first_key = static_cast<uint32_t>(key_frames_.size());
+  auto values_size = std::is_same_v<T, glm::quat> ? rotation_keys_.size() : vector_keys_.size();
+  track.first_value = static_cast<uint32_t>(values_size / 3);
+  track.first_block = static_cast<uint32_t>(block_keys_.size());
+
+  float max_error = 0.0f;
+  auto add_key = [&](uint32_t frame) {
+    if ((frame & (kBlockFrames - 1)) == 0) {
+      block_keys_.push_back(track.key_count);
+    }
+    key_frames_.push_back(static_cast<uint8_t>(frame & (kBlockFrames - 1)));
+    encode(values[frame]);
+    max_error = std::max(max_error, error(decoded[frame], values[frame]));
+    ++track.key_count;
+  };
+
+  // Greedily extend every segment as long as interpolating its ends stays within tolerance. Block
+  // starts always get a key, so segments end there at the latest
+  add_key(0);
+  uint32_t start = 0;
+  while (start + 1 < frame_count) {
+    auto limit = std::min(frame_count - 1, ((start >> kBlockShift) + 1) << kBlockShift);
+    auto end = start + 1;
+    float segment_error = 0.0f;
+    while (end < limit) {
+      auto candidate = end + 1;
+      float candidate_error = 0.0f;
+      for (auto frame = start + 1; frame < candidate; ++frame) {
+        auto factor = static_cast<float>(frame - start) / static_cast<float>(candidate - start);
+        auto value = interpolate(decoded[start], decoded[candidate], factor);
+        candidate_error = std::max(candidate_error, error(value, values[frame]));
+        if (candidate_error > tolerance) {
+          break;
+        }
+      }
+      if (candidate_error > tolerance) {
+        break;
+      }
+      end = candidate;
+      segment_error = candidate_error;
+    }
+    max_error = std::max(max_error, segment_error);
+    add_key(end);
+    start = end;
+  }
+  block_keys_.push_back(track.key_count);
+  return max_error;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/vec3.hpp>
+
+#include "resource.h"
+
+namespace AnimationViewer::Compression {
+/// Lossy, randomly accessible copy of the translation, rotation and scale tracks of an animation
+///
+/// Tracks which stay within tolerance of their first sample collapse to that one value. Others
+/// keep only the frames needed for linear interpolation to stay within tolerance. Rotation keys are
+/// quantized with the smallest three encoding into 48 bits, translation and scale keys to 16 bits
+/// per component over the range of their track. Every 256 frames start a block with a key on its
+/// first frame and an index of where its keys start, so sampling any frame only searches one block.
+class CompressedAnimation
+{
+public:
+  struct Statistics
+  {
+    /// Bytes of the source samples and of everything the compressed animation holds
+    size_t raw_bytes;
+    size_t compressed_bytes;
+    uint32_t constant_tracks;
+    uint32_t animated_tracks;
+    uint32_t keys;
+    /// Largest errors measured over every frame of every track
+    float max_position_error;
+    float max_rotation_error;
+    float max_scale_error;
+  };
+
+  static std::unique_ptr<CompressedAnimation> create(
+    const Resource::Animation& animation,
+    const Resource::Animation::Tolerances& tolerances);
+  virtual ~CompressedAnimation();
+
+  uint32_t frame_count() const;
+  uint32_t joint_count() const;
+  const Statistics& statistics() const;
+
+  /// Decompress one joint, fractional frames interpolate linearly between frames
+  void sample(float frame,
+              uint32_t joint,
+              glm::vec3& translation,
+              glm::quat& rotation,
+              glm::vec3& scale) const;
+  /// Decompress all joints, every span must hold joint_count() values
+  void sample(float frame,
+              std::span<glm::vec3> translations,
+              std::span<glm::quat> rotations,
+              std::span<glm::vec3> scales) const;
+
+protected:
+  CompressedAnimation(uint32_t frame_count, uint32_t joint_count);
+
+private:
+  /// One channel of one joint
+  struct Track
+  {
+    /// 0 for a constant track
+    uint32_t key_count;
+    uint32_t first_key;
+    /// First key in the vector or the rotation keys
+    uint32_t first_value;
+    /// Offset of the block index of an animated track
+    uint32_t first_block;
+    /// Value of a constant track, or where the quantization range of an animated one starts
+    glm::vec4 base;
+    /// Size of the quantization range of animated translations and scales
+    glm::vec3 extent;
+  };
+
+  /// Key at or before @frame, or the last key, and how far @frame is towards the next one
+  void find_keys(const Track& track, float frame, uint32_t& key, float& factor) const;
+  glm::vec3 sample_vector(const Track& track, float frame) const;
+  glm::quat sample_rotation(const Track& track, float frame) const;
+  glm::vec3 decode_vector(const Track& track, uint32_t key) const;
+  glm::quat decode_rotation(const Track& track, uint32_t key) const;
+  /// Fill in the keys of one track from its source samples and return the largest error
+  float compress_vector_track(Track& track, std::span<const glm::vec3> values, float tolerance);
+  float compress_rotation_track(Track& track, std::span<const glm::quat> values, float tolerance);
+  /// Pick the keys of a track from decoded values and add them and the block index
+  template<typename T, typename Error, typename Encode>
+  float reduce_keys(Track& track,
+                    std::span<const T> values,
+                    std::span<const T> decoded,
+                    float tolerance,
+                    Error error,
+                    Encode encode);
+
+  const uint32_t frame_count_;
+  const uint32_t joint_count_;
+  /// Translation, rotation and scale track of every joint in turn
+  std::vector<Track> tracks_;
+  /// Frame of every key within its block
+  std::vector<uint8_t> key_frames_;
+  /// Three components per key, translations and scales share one array, rotations the other
+  std::vector<uint16_t> vector_keys_;
+  std::vector<uint16_t> rotation_keys_;
+  /// Per animated track, the first key of every block and its key count after the last block
+  std::vector<uint32_t> block_keys_;
+  Statistics statistics_;
+};
+} // namespace AnimationViewer::Compression
@@ -0,0 +1,200 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+#include "resource.h"
+
+using namespace AnimationViewer;
+using namespace AnimationViewer::Geometry;
+
+namespace {
+constexpr uint32_t kUnused = std::numeric_limits<uint32_t>::max();
+
+// Welding compares the bytes of vertices, there must not be any padding in between
+static_assert(sizeof(vertex_t) == 9 * sizeof(float));
+
+/// Hashes and compares vertices by index into one array, so the map doesn't copy them
+struct VertexHash
+{
+  const std::vector<vertex_t>& vertices;
+  size_t operator()(uint32_t index) const
+  {
+    // FNV-1a
+    uint64_t hash = 0xCBF29CE484222325ull;
+    auto bytes = reinterpret_cast<const uint8_t*>(&vertices[index]);
+    for (size_t i = 0; i < sizeof(vertex_t); ++i) {
+      hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return static_cast<size_t>(hash);
+  }
+};
+
+struct VertexEqual
+{
+  const std::vector<vertex_t>& vertices;
+  bool operator()(uint32_t a, uint32_t b) const
+  {
+    return std::memcmp(&vertices[a], &vertices[b], sizeof(vertex_t)) == 0;
+  }
+};
+} // namespace
+
+float
+Geometry::average_cache_miss_ratio(std::span<const uint32_t> indices,
+                                   uint32_t vertex_count,
+                                   uint32_t cache_size)
+{
+  auto triangle_count = indices.size() / 3;
+  if (triangle_count == 0) {
+    return 0.0f;
+  }
+  // A vertex is in the FIFO as long as fewer than cache_size misses happened since it went in
+  std::vector<uint64_t> inserted(vertex_count, 0);
+  uint64_t misses = 0;
+  for (size_t i = 0; i < triangle_count * 3; ++i) {
+    auto vertex = indices[i];
+    if (inserted[vertex] == 0 || misses - inserted[vertex] + 1 > cache_size) {
+      ++misses;
+      inserted[vertex] = misses;
+    }
+  }
+  return static_cast<float>(misses) / static_cast<float>(triangle_count);
+}
+
+void
+Geometry::weld_vertices(std::vector<vertex_t>& vertices, std::span<uint32_t> indices)
+{
+  std::unordered_map<uint32_t, uint32_t, VertexHash, VertexEqual> unique(
+    vertices.size(), VertexHash{ vertices }, VertexEqual{ vertices });
+  std::vector<uint32_t> remap(vertices.size());
+  uint32_t unique_count = 0;
+  for (uint32_t i = 0; i < vertices.size(); ++i) {
+    auto [found, inserted] = unique.emplace(i, unique_count);
+    if (inserted) {
+      ++unique_count;
+    }
+    remap[i] = found->second;
+  }
+  if (unique_count == vertices.size()) {
+    return;
+  }
+
+  // Survivors keep their order, so they can be moved down in place
+  for (uint32_t i = 0; i < vertices.size(); ++i) {
+    vertices[remap[i]] = vertices[i];
+  }
+  vertices.resize(unique_count);
+  for (auto& index : indices) {
+    index = remap[index];
+  }
+}
+
+void
+Geometry::optimize_vertex_cache(std::span<uint32_t> indices,
+                                uint32_t vertex_count,
+                                uint32_t cache_size)
+{
+  auto triangle_count = static_cast<uint32_t>(indices.size() / 3);
+  if (triangle_count == 0) {
+    return;
+  }
+
+  // Triangles using each vertex, and how many of them are not emitted yet
+  std::vector<uint32_t> live(vertex_count, 0);
+  for (uint32_t i = 0; i < triangle_count * 3; ++i) {
+    ++live[indices[i]];
+  }
+  std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+  for (uint32_t i = 0; i < vertex_count; ++i) {
+    adjacency_offsets[i + 1] = adjacency_offsets[i] + live[i];
+  }
+  std::vector<uint32_t> adjacency(triangle_count * 3);
+  {
+    auto fill = adjacency_offsets;
+    for (uint32_t i = 0; i < triangle_count * 3; ++i) {
+      adjacency[fill[indices[i]]++] = i / 3;
+    }
+  }
+
+  std::vector<uint32_t> output;
+  output.reserve(triangle_count * 3);
+  std::vector<bool> emitted(triangle_count, false);
+  // Time stamps start past the cache size, so no vertex is considered cached at first
+  std::vector<uint32_t> cache_time(vertex_count, 0);
+  uint32_t time = cache_size + 1;
+  std::vector<uint32_t> dead_end;
+  std::vector<uint32_t> candidates;
+  uint32_t cursor = 0;
+  auto fanning = indices[0];
+  while (fanning != kUnused) {
+    candidates.clear();
+    for (auto a = adjacency_offsets[fanning]; a < adjacency_offsets[fanning + 1]; ++a) {
+      auto triangle = adjacency[a];
+      if (emitted[triangle]) {
+        continue;
+      }
+      emitted[triangle] = true;
+      for (uint32_t corner = 0; corner < 3; ++corner) {
+        auto vertex = indices[3 * triangle + corner];
+        output.push_back(vertex);
+        dead_end.push_back(vertex);
+        candidates.push_back(vertex);
+        --live[vertex];
+        if (time - cache_time[vertex] > cache_size) {
+          cache_time[vertex] = time++;
+        }
+      }
+    }
+
+    // Prefer the candidate staying in the cache longest whose remaining triangles still fit
+    fanning = kUnused;
+    int64_t best_priority = -1;
+    for (auto vertex : candidates) {
+      if (live[vertex] == 0) {
+        continue;
+      }
+      int64_t priority = 0;
+      if (time - cache_time[vertex] + 2 * live[vertex] <= cache_size) {
+        priority = time - cache_time[vertex];
+      }
+      if (priority > best_priority) {
+        best_priority = priority;
+        fanning = vertex;
+      }
+    }
+    // Dead end: go back to recently used vertices, then to any vertex with triangles left
+    while (fanning == kUnused && !dead_end.empty()) {
+      auto vertex = dead_end.back();
+      dead_end.pop_back();
+      if (live[vertex] > 0) {
+        fanning = vertex;
+      }
+    }
+    for (; fanning == kUnused && cursor < vertex_count; ++cursor) {
+      if (live[cursor] > 0) {
+        fanning = cursor;
+      }
+    }
+  }
+
+  std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void
+Geometry::optimize_vertex_fetch(std::vector<vertex_t>& vertices, std::span<uint32_t> indices)
+{
+  std::vector<uint32_t> remap(vertices.size(), kUnused);
+  std::vector<vertex_t> reordered;
+  reordered.reserve(vertices.size());
+  for (auto& index : indices) {
+    if (remap[index] == kUnused) {
+      remap[index] = static_cast<uint32_t>(reordered.size());
+      reordered.push_back(vertices[index]);
+    }
+    index = remap[index];
+  }
+  vertices = std::move(reordered);
+}
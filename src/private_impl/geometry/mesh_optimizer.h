@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace AnimationViewer {
+struct vertex_t;
+} // namespace AnimationViewer
+
+namespace AnimationViewer::Geometry {
+/// Entries of the FIFO post-transform cache the optimizations and statistics assume
+constexpr uint32_t kVertexCacheSize = 16;
+
+/// Average cache miss ratio: vertices transformed per triangle of an indexed triangle list
+///
+/// Simulates a FIFO post-transform cache of @cache_size entries. 0.5 is the best any mesh can do,
+/// 3 means no vertex was ever reused from the cache.
+float
+average_cache_miss_ratio(std::span<const uint32_t> indices,
+                         uint32_t vertex_count,
+                         uint32_t cache_size = kVertexCacheSize);
+
+/// Merge vertices which are identical in every attribute and point @indices at the survivors
+void
+weld_vertices(std::vector<vertex_t>& vertices, std::span<uint32_t> indices);
+
+/// Reorder the triangles of @indices for post-transform cache hits with Tipsify
+///
+/// Sander, Nehab and Barczak, Fast Triangle Reordering for Vertex Locality and Reduced Overdraw,
+/// 2007. Runs in linear time, indices past the last complete triangle are left in place.
+void
+optimize_vertex_cache(std::span<uint32_t> indices,
+                      uint32_t vertex_count,
+                      uint32_t cache_size = kVertexCacheSize);
+
+/// Reorder @vertices in the order @indices first use them and drop the unreferenced ones
+void
+optimize_vertex_fetch(std::vector<vertex_t>& vertices, std::span<uint32_t> indices);
+} // namespace AnimationViewer::Geometry
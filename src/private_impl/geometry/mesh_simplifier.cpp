@@ -0,0 +1,325 @@
+#include "mesh_simplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include <glm/geometric.hpp>
+
+#include "resource.h"
+
+using namespace AnimationViewer;
+using namespace AnimationViewer::Geometry;
+
+namespace {
+/// Boundary edges are kept in place by planes through them, weighted this much more than faces
+constexpr double kBoundaryWeight = 10.0;
+
+/// Symmetric 4x4 matrix of weighted squared distances to a set of planes, and the sum of their
+/// weights
+struct Quadric
+{
+  double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+  double weight;
+
+  static Quadric from_plane(const glm::dvec3& normal, double distance, double weight)
+  {
+    auto a = normal.x;
+    auto b = normal.y;
+    auto c = normal.z;
+    auto d = distance;
+    return { weight * a * a, weight * a * b, weight * a * c, weight * a * d, weight * b * b,
+             weight * b * c, weight * b * d, weight * c * c, weight * c * d, weight * d * d,
+             weight };
+  }
+
+  Quadric& operator+=(const Quadric& other)
+  {
+    a2 += other.a2;
+    ab += other.ab;
+    ac += other.ac;
+    ad += other.ad;
+    b2 += other.b2;
+    bc += other.bc;
+    bd += other.bd;
+    c2 += other.c2;
+    cd += other.cd;
+    d2 += other.d2;
+    weight += other.weight;
+    return *this;
+  }
+
+  double evaluate(const glm::dvec3& p) const
+  {
+    return a2 * p.x * p.x + 2.0 * ab * p.x * p.y + 2.0 * ac * p.x * p.z + 2.0 * ad * p.x +
+           b2 * p.y * p.y + 2.0 * bc * p.y * p.z + 2.0 * bd * p.y + c2 * p.z * p.z +
+           2.0 * cd * p.z + d2;
+  }
+
+  /// Squared distance from @p to the planes, averaged by their weights
+  double mean_squared_distance(const glm::dvec3& p) const
+  {
+    return weight > 0.0 ? std::max(evaluate(p), 0.0) / weight : 0.0;
+  }
+};
+
+struct Collapse
+{
+  uint32_t from;
+  uint32_t to;
+  double cost;
+};
+
+/// Weight of @bone for a vertex, which blends from bone_id.x to bone_id.y by bone_id.z
+float
+bone_weight(const vertex_t& vertex, float bone)
+{
+  float weight = 0.0f;
+  if (vertex.bone_id.x == bone) {
+    weight += 1.0f - vertex.bone_id.z;
+  }
+  if (vertex.bone_id.y == bone) {
+    weight += vertex.bone_id.z;
+  }
+  return weight;
+}
+
+/// Half the L1 distance between the bone weights of two vertices, 0 when they are skinned the
+/// same and 1 when they share no bone
+float
+skin_distance(const vertex_t& a, const vertex_t& b)
+{
+  float distance = 0.0f;
+  for (auto bone : { a.bone_id.x, a.bone_id.y, b.bone_id.x, b.bone_id.y }) {
+    distance += std::abs(bone_weight(a, bone) - bone_weight(b, bone));
+  }
+  // Every bone was counted once per id naming it, bones named by both ids of one vertex twice
+  return std::min(distance * 0.25f, 1.0f);
+}
+
+glm::dvec3
+position(std::span<const vertex_t> vertices, uint32_t index)
+{
+  return glm::dvec3(vertices[index].position);
+}
+} // namespace
+
+std::vector<uint32_t>
+Geometry::simplify(std::span<const vertex_t> vertices,
+                   std::span<const uint32_t> indices,
+                   size_t target_index_count,
+                   float max_error,
+                   float skin_error,
+                   float& error)
+{
+  error = 0.0f;
+  auto vertex_count = static_cast<uint32_t>(vertices.size());
+  std::vector<uint32_t> result(indices.begin(), indices.end() - indices.size() % 3);
+
+  // Vertices sharing a position with another one are on a seam and stay where they are
+  std::vector<bool> locked(vertex_count, false);
+  {
+    struct PositionHash
+    {
+      size_t operator()(const glm::vec3& p) const
+      {
+        uint32_t bits[3];
+        std::memcpy(bits, &p, sizeof(bits));
+        return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+      }
+    };
+    std::unordered_map<glm::vec3, uint32_t, PositionHash> first(vertex_count);
+    for (uint32_t i = 0; i < vertex_count; ++i) {
+      auto [found, inserted] = first.emplace(vertices[i].position, i);
+      if (!inserted) {
+        locked[i] = true;
+        locked[found->second] = true;
+      }
+    }
+  }
+
+  // Quadrics of the planes of every triangle around a vertex, weighted by their area. Boundary
+  // planes below are weighted by their squared length, so the weights share a unit and their
+  // weighted mean is a squared distance whatever the scale of the mesh
+  std::vector<Quadric> quadrics(vertex_count, Quadric{});
+  std::unordered_map<uint64_t, uint32_t> edge_uses;
+  for (size_t i = 0; i < result.size(); i += 3) {
+    auto p0 = position(vertices, result[i]);
+    auto cross = glm::cross(position(vertices, result[i + 1]) - p0,
+                            position(vertices, result[i + 2]) - p0);
+    auto area = glm::length(cross);
+    if (area <= 0.0) {
+      continue;
+    }
+    auto normal = cross / area;
+    auto quadric = Quadric::from_plane(normal, -glm::dot(normal, p0), area * 0.5);
+    for (size_t j = i; j < i + 3; ++j) {
+      quadrics[result[j]] += quadric;
+      auto a = result[j];
+      auto b = result[j == i + 2 ? i : j + 1];
+      ++edge_uses[uint64_t{ std::min(a, b) } << 32u | std::max(a, b)];
+    }
+  }
+  // Edges of only one triangle are on a boundary, planes perpendicular to the triangle keep them
+  for (size_t i = 0; i < result.size(); i += 3) {
+    auto p0 = position(vertices, result[i]);
+    auto face_normal = glm::cross(position(vertices, result[i + 1]) - p0,
+                                  position(vertices, result[i + 2]) - p0);
+    if (glm::length(face_normal) <= 0.0) {
+      continue;
+    }
+    face_normal = glm::normalize(face_normal);
+    for (size_t j = i; j < i + 3; ++j) {
+      auto a = result[j];
+      auto b = result[j == i + 2 ? i : j + 1];
+      if (edge_uses[uint64_t{ std::min(a, b) } << 32u | std::max(a, b)] != 1) {
+        continue;
+      }
+      auto edge = position(vertices, b) - position(vertices, a);
+      auto length = glm::length(edge);
+      if (length <= 0.0) {
+        continue;
+      }
+      auto normal = glm::normalize(glm::cross(edge, face_normal));
+      auto quadric = Quadric::from_plane(
+        normal, -glm::dot(normal, position(vertices, a)), kBoundaryWeight * length * length);
+      quadrics[a] += quadric;
+      quadrics[b] += quadric;
+    }
+  }
+
+  auto cost = [&](uint32_t from, uint32_t to) {
+    auto quadric = quadrics[from];
+    quadric += quadrics[to];
+    auto skin = static_cast<double>(skin_error * skin_distance(vertices[from], vertices[to]));
+    return quadric.mean_squared_distance(position(vertices, to)) + skin * skin;
+  };
+
+  auto max_cost = static_cast<double>(max_error) * max_error;
+  std::vector<uint32_t> remap(vertex_count);
+  std::vector<bool> touched(vertex_count);
+  std::vector<uint32_t> adjacency_offsets(vertex_count + 1);
+  std::vector<uint32_t> adjacency;
+  std::vector<Collapse> collapses;
+  // Every pass collapses independent edges, cheapest first, then rebuilds the triangles
+  while (result.size() > target_index_count) {
+    auto triangle_count = static_cast<uint32_t>(result.size() / 3);
+    std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+    for (auto index : result) {
+      ++adjacency_offsets[index + 1];
+    }
+    for (uint32_t i = 0; i < vertex_count; ++i) {
+      adjacency_offsets[i + 1] += adjacency_offsets[i];
+    }
+    adjacency.resize(result.size());
+    {
+      auto fill = adjacency_offsets;
+      for (uint32_t i = 0; i < result.size(); ++i) {
+        adjacency[fill[result[i]]++] = i / 3;
+      }
+    }
+
+    collapses.clear();
+    for (uint32_t t = 0; t < triangle_count; ++t) {
+      for (uint32_t corner = 0; corner < 3; ++corner) {
+        auto a = result[3 * t + corner];
+        auto b = result[3 * t + (corner + 1) % 3];
+        if (locked[a] && locked[b]) {
+          continue;
+        }
+        auto forward = locked[a] ? max_cost + 1.0 : cost(a, b);
+        auto backward = locked[b] ? max_cost + 1.0 : cost(b, a);
+        if (forward <= backward) {
+          collapses.push_back({ a, b, forward });
+        } else {
+          collapses.push_back({ b, a, backward });
+        }
+      }
+    }
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+      return a.cost < b.cost;
+    });
+
+    for (uint32_t i = 0; i < vertex_count; ++i) {
+      remap[i] = i;
+    }
+    std::fill(touched.begin(), touched.end(), false);
+    // Each collapse removes about two triangles
+    size_t removed = 0;
+    size_t to_remove = (result.size() - target_index_count + 2) / 3;
+    size_t collapsed = 0;
+    for (const auto& collapse : collapses) {
+      if (removed >= to_remove || collapse.cost > max_cost) {
+        break;
+      }
+      if (touched[collapse.from] || touched[collapse.to]) {
+        continue;
+      }
+
+      // Reject collapses which flip or degenerate a triangle which stays
+      bool flips = false;
+      size_t collapsing = 0;
+      auto to_position = position(vertices, collapse.to);
+      for (auto a = adjacency_offsets[collapse.from]; a < adjacency_offsets[collapse.from + 1];
+           ++a) {
+        const auto* triangle = &result[3 * adjacency[a]];
+        if (triangle[0] == collapse.to || triangle[1] == collapse.to ||
+            triangle[2] == collapse.to) {
+          ++collapsing;
+          continue;
+        }
+        std::array<glm::dvec3, 3> before, after;
+        for (uint32_t corner = 0; corner < 3; ++corner) {
+          before[corner] = after[corner] = position(vertices, triangle[corner]);
+          if (triangle[corner] == collapse.from) {
+            after[corner] = to_position;
+          }
+        }
+        auto normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+        auto normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+        if (glm::dot(normal_before, normal_after) <= 0.0) {
+          flips = true;
+          break;
+        }
+      }
+      if (flips) {
+        continue;
+      }
+
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to] += quadrics[collapse.from];
+      // Everything around the collapse changed, leave it to the next pass
+      for (auto a = adjacency_offsets[collapse.from]; a < adjacency_offsets[collapse.from + 1];
+           ++a) {
+        for (uint32_t corner = 0; corner < 3; ++corner) {
+          touched[result[3 * adjacency[a] + corner]] = true;
+        }
+      }
+      touched[collapse.to] = true;
+      removed += collapsing;
+      ++collapsed;
+      error = std::max(error, static_cast<float>(std::sqrt(collapse.cost)));
+    }
+    if (collapsed == 0) {
+      break;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < result.size(); i += 3) {
+      auto a = remap[result[i]];
+      auto b = remap[result[i + 1]];
+      auto c = remap[result[i + 2]];
+      if (a == b || b == c || c == a) {
+        continue;
+      }
+      result[kept++] = a;
+      result[kept++] = b;
+      result[kept++] = c;
+    }
+    result.resize(kept);
+  }
+
+  return result;
+}
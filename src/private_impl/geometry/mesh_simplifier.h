@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace AnimationViewer {
+struct vertex_t;
+} // namespace AnimationViewer
+
+namespace AnimationViewer::Geometry {
+/// Simplify an indexed triangle list by quadric error edge collapse
+///
+/// Edges collapse onto one of their vertices, so the result only references the existing
+/// @vertices and keeps their normals, bone ids and blend as they are. Collapsing between vertices
+/// with different bone influences costs up to @skin_error on top of the geometric error, so joints
+/// keep their shape the longest. Vertices on seams, where several vertices share a position, are
+/// never moved. Stops once at most @target_index_count indices are left or the next collapse would
+/// move the surface by more than @max_error.
+/// The geometric error of a collapse is the root mean square distance to the planes of the
+/// triangles it replaces, weighted by their area, so it does not depend on how finely the mesh is
+/// tessellated. @error is set to the largest error of any collapse, in the units of the positions.
+std::vector<uint32_t>
+simplify(std::span<const vertex_t> vertices,
+         std::span<const uint32_t> indices,
+         size_t target_index_count,
+         float max_error,
+         float skin_error,
+         float& error);
+} // namespace AnimationViewer::Geometry
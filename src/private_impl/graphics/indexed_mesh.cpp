@@ -1,5 +1,6 @@
 #include "indexed_mesh.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 
@@ -97,6 +98,12 @@ const std::vector<IndexedMesh::MeshAttributes> box_attributes = {
   IndexedMesh::MeshAttributes{ GL_FLOAT, 3 }, // Normal
 };
 
+const float line_vertices[2 * 3] = {
+  0.0f, 0.0f, 0.0f, // Start
+  1.0f, 0.0f, 0.0f, // End
+};
+const uint16_t line_indices[2] = { 0, 1 };
+
 } // namespace
 
 std::unique_ptr<IndexedMesh>
@@ -104,7 +111,55 @@ IndexedMesh::create(const std::vector<MeshAttributes>& attributes,
                     const void* vertices,
                     uint32_t vertex_size,
                     const uint16_t* indices,
-                    uint16_t index_count,
+                    uint32_t index_count,
+                    PrimitiveTopology topology)
+{
+  return create(
+    attributes, vertices, vertex_size, indices, IndexType::UnsignedShort, index_count, {}, topology);
+}
+
+std::unique_ptr<IndexedMesh>
+IndexedMesh::create(const std::vector<MeshAttributes>& attributes,
+                    const void* vertices,
+                    uint32_t vertex_size,
+                    const uint32_t* indices,
+                    uint32_t index_count,
+                    PrimitiveTopology topology)
+{
+  return create(
+    attributes, vertices, vertex_size, indices, IndexType::UnsignedInt, index_count, {}, topology);
+}
+
+std::unique_ptr<IndexedMesh>
+IndexedMesh::create(const std::vector<MeshAttributes>& attributes,
+                    const void* vertices,
+                    uint32_t vertex_size,
+                    const uint16_t* indices,
+                    std::vector<Submesh> submeshes,
+                    PrimitiveTopology topology)
+{
+  uint32_t index_count = 0;
+  for (const auto& submesh : submeshes) {
+    index_count = std::max(index_count, submesh.index_offset + submesh.index_count);
+  }
+  return create(attributes,
+                vertices,
+                vertex_size,
+                indices,
+                IndexType::UnsignedShort,
+                index_count,
+                std::move(submeshes),
+                topology);
+}
+
+std::unique_ptr<IndexedMesh>
+IndexedMesh::create(const std::vector<MeshAttributes>& attributes,
+                    const void* vertices,
+                    uint32_t vertex_size,
+                    const void* indices,
+                    IndexType index_type,
+                    uint32_t index_count,
+                    std::vector<Submesh> submeshes,
                     PrimitiveTopology topology)
 {
   uint32_t buffers[2];
@@ -116,10 +171,17 @@ IndexedMesh::create(const std::vector<MeshAttributes>& attributes,
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
 
   glBufferData(GL_ARRAY_BUFFER, vertex_size, vertices, GL_STATIC_DRAW);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * sizeof(indices[0]), indices, GL_STATIC_DRAW);
-
-  return std::unique_ptr<IndexedMesh>(
-    new IndexedMesh(buffers[0], buffers[1], vao, attributes, topology, index_count));
+  size_t index_size = index_type == IndexType::UnsignedInt ? sizeof(uint32_t) : sizeof(uint16_t);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * index_size, indices, GL_STATIC_DRAW);
+
+  return std::unique_ptr<IndexedMesh>(new IndexedMesh(buffers[0],
+                                                      buffers[1],
+                                                      vao,
+                                                      attributes,
+                                                      topology,
+                                                      index_type,
+                                                      index_count,
+                                                      std::move(submeshes)));
 }
 
 std::unique_ptr<IndexedMesh>
@@ -201,19 +263,34 @@ IndexedMesh::create_box()
   return box;
 }
 
+std::unique_ptr<IndexedMesh>
+IndexedMesh::create_line()
+{
+  return IndexedMesh::create(pos_vec_3_attributes,
+                             line_vertices,
+                             sizeof(line_vertices),
+                             line_indices,
+                             sizeof(line_indices) / sizeof(line_indices[0]),
+                             PrimitiveTopology::LineList);
+}
+
 IndexedMesh::IndexedMesh(uint32_t vertex_buffer,
                          uint32_t index_buffer,
                          uint32_t vao,
                          std::vector<MeshAttributes> attributes,
                          PrimitiveTopology topology,
-                         uint16_t element_count)
+                         IndexType index_type,
+                         uint32_t element_count,
+                         std::vector<Submesh> submeshes)
 
   : vertex_buffer_(vertex_buffer)
   , index_buffer_(index_buffer)
   , vao_(vao)
   , attributes_(std::move(attributes))
   , topology_(topology)
+  , index_type_(index_type)
   , element_count_(element_count)
+  , submeshes_(std::move(submeshes))
 {}
 
 IndexedMesh::~IndexedMesh()
@@ -224,9 +301,71 @@ IndexedMesh::~IndexedMesh()
 
 void
 IndexedMesh::draw() const
+{
+  draw(0, element_count_);
+}
+
+void
+IndexedMesh::draw(uint32_t index_offset, uint32_t index_count) const
 {
   bind();
-  glDrawElements(static_cast<uint32_t>(topology_), element_count_, GL_UNSIGNED_SHORT, nullptr);
+  size_t index_size = index_type_ == IndexType::UnsignedInt ? sizeof(uint32_t) : sizeof(uint16_t);
+  if (submeshes_.empty()) {
+    glDrawElements(static_cast<uint32_t>(topology_),
+                   index_count,
+                   static_cast<uint32_t>(index_type_),
+                   reinterpret_cast<const void*>(index_offset * index_size));
+    return;
+  }
+  // Without glDrawElementsBaseVertex in GLES 3.0 the attributes are offset instead
+  for (const auto& submesh : submeshes_) {
+    if (submesh.index_offset < index_offset ||
+        submesh.index_offset >= index_offset + index_count) {
+      continue;
+    }
+    bind_attributes(submesh.base_vertex);
+    glDrawElements(static_cast<uint32_t>(topology_),
+                   submesh.index_count,
+                   static_cast<uint32_t>(index_type_),
+                   reinterpret_cast<const void*>(submesh.index_offset * index_size));
+  }
+}
+
+void
+IndexedMesh::draw_instanced(uint32_t instance_count) const
+{
+  draw_instanced(0, element_count_, instance_count);
+}
+
+void
+IndexedMesh::draw_instanced(uint32_t index_offset,
+                            uint32_t index_count,
+                            uint32_t instance_count) const
+{
+  glBindVertexArray(vao_);
+  size_t index_size = index_type_ == IndexType::UnsignedInt ? sizeof(uint32_t) : sizeof(uint16_t);
+  if (submeshes_.empty()) {
+    glDrawElementsInstanced(static_cast<uint32_t>(topology_),
+                            index_count,
+                            static_cast<uint32_t>(index_type_),
+                            reinterpret_cast<const void*>(index_offset * index_size),
+                            instance_count);
+    return;
+  }
+  // The instance attributes may have left another buffer bound
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+  for (const auto& submesh : submeshes_) {
+    if (submesh.index_offset < index_offset ||
+        submesh.index_offset >= index_offset + index_count) {
+      continue;
+    }
+    bind_attributes(submesh.base_vertex);
+    glDrawElementsInstanced(static_cast<uint32_t>(topology_),
+                            submesh.index_count,
+                            static_cast<uint32_t>(index_type_),
+                            reinterpret_cast<const void*>(submesh.index_offset * index_size),
+                            instance_count);
+  }
 }
 
 void
@@ -235,43 +374,60 @@ IndexedMesh::bind() const
   glBindVertexArray(vao_);
   glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_);
+  bind_attributes(0);
+}
 
+uint32_t
+IndexedMesh::vertex_stride() const
+{
   uint32_t total_stride = 0;
-  std::vector<uint32_t> offsets;
-  offsets.reserve(attributes_.size());
-  uint32_t attr_index = 0;
   for (auto& attr : attributes_) {
-    auto size = attr.count;
-    switch (attr.type) {
-      case GL_FLOAT:
-        size *= sizeof(float);
-        break;
-      case GL_UNSIGNED_INT:
-        size *= sizeof(uint32_t);
-        break;
-      case GL_UNSIGNED_SHORT:
-        size *= sizeof(uint16_t);
-        break;
-      case GL_UNSIGNED_BYTE:
-        size *= sizeof(uint8_t);
-        break;
-      default:
-        // printf("unsupported type\n");
-        assert(false);
-        return;
-    }
-    offsets.push_back(total_stride);
-    total_stride += size;
-    attr_index++;
+    total_stride += attribute_size(attr);
   }
+  return total_stride;
+}
+
+uint32_t
+IndexedMesh::attribute_size(const MeshAttributes& attr)
+{
+  switch (attr.type) {
+    case GL_FLOAT:
+      return attr.count * sizeof(float);
+    case GL_UNSIGNED_INT:
+      return attr.count * sizeof(uint32_t);
+    case GL_HALF_FLOAT:
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+      return attr.count * sizeof(uint16_t);
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+      return attr.count * sizeof(uint8_t);
+    default:
+      // printf("unsupported type\n");
+      assert(false);
+      return 0;
+  }
+}
 
-  for (uint32_t i = 0; i < offsets.size(); ++i) {
-    glVertexAttribPointer(i,
-                          attributes_[i].count,
-                          attributes_[i].type,
-                          GL_FALSE,
-                          total_stride,
-                          reinterpret_cast<const void*>(offsets[i]));
+void
+IndexedMesh::bind_attributes(uint32_t base_vertex) const
+{
+  auto total_stride = vertex_stride();
+  size_t offset = size_t{ base_vertex } * total_stride;
+  for (uint32_t i = 0; i < attributes_.size(); ++i) {
+    const auto& attr = attributes_[i];
+    if (attr.integer) {
+      glVertexAttribIPointer(
+        i, attr.count, attr.type, total_stride, reinterpret_cast<const void*>(offset));
+    } else {
+      glVertexAttribPointer(i,
+                            attr.count,
+                            attr.type,
+                            attr.normalized ? GL_TRUE : GL_FALSE,
+                            total_stride,
+                            reinterpret_cast<const void*>(offset));
+    }
     glEnableVertexAttribArray(i);
+    offset += attribute_size(attr);
   }
 }
@@ -10,41 +10,97 @@ struct IndexedMesh
 {
   enum class PrimitiveTopology
   {
+    LineList = 0x0001,
     TriangleList = 0x0004,
     TriangleFan = 0x0006,
   };
+  enum class IndexType
+  {
+    UnsignedShort = 0x1403,
+    UnsignedInt = 0x1405,
+  };
+  /// Range of indices which are relative to a base vertex
+  struct Submesh
+  {
+    uint32_t index_offset;
+    uint32_t index_count;
+    uint32_t base_vertex;
+  };
   struct MeshAttributes
   {
     uint32_t type;
     uint32_t count;
+    /// Fixed point values are mapped to [0, 1] or [-1, 1] instead of converted as they are
+    bool normalized = false;
+    /// Read by the shader as integers, type must be an integer type
+    bool integer = false;
   };
   const uint32_t vertex_buffer_;
   const uint32_t index_buffer_;
   const uint32_t vao_;
   const std::vector<MeshAttributes> attributes_;
   const PrimitiveTopology topology_;
-  const uint16_t element_count_;
+  const IndexType index_type_;
+  const uint32_t element_count_;
+  /// Drawn one after another when not empty, otherwise all elements are drawn at once
+  const std::vector<Submesh> submeshes_;
 
   static std::unique_ptr<IndexedMesh> create(const std::vector<MeshAttributes>& attributes,
                                              const void* vertices,
                                              uint32_t vertex_size,
                                              const uint16_t* indices,
-                                             uint16_t index_count,
+                                             uint32_t index_count,
+                                             PrimitiveTopology topology);
+  static std::unique_ptr<IndexedMesh> create(const std::vector<MeshAttributes>& attributes,
+                                             const void* vertices,
+                                             uint32_t vertex_size,
+                                             const uint32_t* indices,
+                                             uint32_t index_count,
+                                             PrimitiveTopology topology);
+  /// Every index of @submeshes must be relative to the base vertex of its submesh
+  static std::unique_ptr<IndexedMesh> create(const std::vector<MeshAttributes>& attributes,
+                                             const void* vertices,
+                                             uint32_t vertex_size,
+                                             const uint16_t* indices,
+                                             std::vector<Submesh> submeshes,
                                              PrimitiveTopology topology);
   static std::unique_ptr<IndexedMesh> create_full_screen_quad();
   static std::unique_ptr<IndexedMesh> create_disk_3_fan(uint32_t triangle_count, float radius);
   static std::unique_ptr<IndexedMesh> create_box();
+  /// Line from x = 0 to x = 1
+  static std::unique_ptr<IndexedMesh> create_line();
 
   virtual ~IndexedMesh();
   void draw() const;
+  /// Draw @index_count elements from @index_offset, which must start and end on submesh bounds
+  void draw(uint32_t index_offset, uint32_t index_count) const;
+  /// Draw all elements @instance_count times, instance attributes are bound after bind()
+  void draw_instanced(uint32_t instance_count) const;
+  /// Instanced draw(@index_offset, @index_count)
+  void draw_instanced(uint32_t index_offset, uint32_t index_count, uint32_t instance_count) const;
   void bind() const;
+  /// Bytes of one vertex, all attributes are interleaved
+  uint32_t vertex_stride() const;
+  static uint32_t attribute_size(const MeshAttributes& attr);
 
 private:
+  static std::unique_ptr<IndexedMesh> create(const std::vector<MeshAttributes>& attributes,
+                                             const void* vertices,
+                                             uint32_t vertex_size,
+                                             const void* indices,
+                                             IndexType index_type,
+                                             uint32_t index_count,
+                                             std::vector<Submesh> submeshes,
+                                             PrimitiveTopology topology);
   IndexedMesh(uint32_t vertex_buffer,
               uint32_t index_buffer,
               uint32_t vao,
               std::vector<MeshAttributes> attributes,
               PrimitiveTopology topology,
-              uint16_t element_count);
+              IndexType index_type,
+              uint32_t element_count,
+              std::vector<Submesh> submeshes);
+  /// Point the attributes at the vertices starting from @base_vertex
+  void bind_attributes(uint32_t base_vertex) const;
 };
 } // namespace AnimationViewer::Graphics
@@ -0,0 +1,94 @@
+#include "instance_buffer.h"
+
+#include <cassert>
+
+#include <glad/glad.h>
+
+using AnimationViewer::Graphics::InstanceBuffer;
+
+std::unique_ptr<InstanceBuffer>
+InstanceBuffer::create(std::vector<IndexedMesh::MeshAttributes> attributes, Usage usage)
+{
+  uint32_t buffer = 0;
+  glGenBuffers(1, &buffer);
+  return std::unique_ptr<InstanceBuffer>(
+    new InstanceBuffer(buffer, std::move(attributes), usage));
+}
+
+InstanceBuffer::InstanceBuffer(uint32_t native_handle,
+                               std::vector<IndexedMesh::MeshAttributes> attributes,
+                               Usage usage)
+  : native_handle_(native_handle)
+  , attributes_(std::move(attributes))
+  , usage_(usage)
+  , count_(0)
+{}
+
+InstanceBuffer::~InstanceBuffer()
+{
+  glDeleteBuffers(1, &native_handle_);
+}
+
+void
+InstanceBuffer::set_debug_name([[maybe_unused]] const std::string& name) const
+{
+#if !__EMSCRIPTEN__
+  glObjectLabel(GL_BUFFER, native_handle_, -1, name.c_str());
+#endif
+}
+
+void
+InstanceBuffer::upload(const void* data, uint32_t count)
+{
+  count_ = count;
+  glBindBuffer(GL_ARRAY_BUFFER, native_handle_);
+  // Orphan the storage rather than wait for the draws reading it
+  glBufferData(GL_ARRAY_BUFFER,
+               size_t{ count } * stride(),
+               data,
+               usage_ == Usage::Static ? GL_STATIC_DRAW : GL_STREAM_DRAW);
+}
+
+void
+InstanceBuffer::bind(uint32_t first_location, uint32_t first_instance) const
+{
+  assert(first_instance <= count_);
+  glBindBuffer(GL_ARRAY_BUFFER, native_handle_);
+  auto total_stride = stride();
+  // There is no base instance in GLES, so the attributes start at the first instance instead
+  size_t offset = size_t{ first_instance } * total_stride;
+  for (uint32_t i = 0; i < attributes_.size(); ++i) {
+    const auto& attr = attributes_[i];
+    auto location = first_location + i;
+    if (attr.integer) {
+      glVertexAttribIPointer(
+        location, attr.count, attr.type, total_stride, reinterpret_cast<const void*>(offset));
+    } else {
+      glVertexAttribPointer(location,
+                            attr.count,
+                            attr.type,
+                            attr.normalized ? GL_TRUE : GL_FALSE,
+                            total_stride,
+                            reinterpret_cast<const void*>(offset));
+    }
+    glVertexAttribDivisor(location, 1);
+    glEnableVertexAttribArray(location);
+    offset += IndexedMesh::attribute_size(attr);
+  }
+}
+
+uint32_t
+InstanceBuffer::stride() const
+{
+  uint32_t total_stride = 0;
+  for (const auto& attr : attributes_) {
+    total_stride += IndexedMesh::attribute_size(attr);
+  }
+  return total_stride;
+}
+
+uint32_t
+InstanceBuffer::count() const
+{
+  return count_;
+}
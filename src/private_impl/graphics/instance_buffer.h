@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "indexed_mesh.h"
+
+namespace AnimationViewer::Graphics {
+/// Vertex attributes which advance once per instance, interleaved like the ones of IndexedMesh
+class InstanceBuffer
+{
+public:
+  enum class Usage : uint8_t
+  {
+    /// Replaced every frame
+    Stream,
+    /// Uploaded once and drawn from many times
+    Static,
+  };
+
+  static std::unique_ptr<InstanceBuffer> create(std::vector<IndexedMesh::MeshAttributes> attributes,
+                                                Usage usage);
+  virtual ~InstanceBuffer();
+
+  void set_debug_name(const std::string& name) const;
+  /// Replace the contents by @count instances, draws issued before keep reading the old ones
+  void upload(const void* data, uint32_t count);
+  /// Point the attributes at locations from @first_location on at the instances, starting at
+  /// @first_instance, to be called with the vertex array of the instanced mesh bound
+  void bind(uint32_t first_location, uint32_t first_instance = 0) const;
+  /// Bytes of one instance
+  uint32_t stride() const;
+  uint32_t count() const;
+
+protected:
+  InstanceBuffer(uint32_t native_handle,
+                 std::vector<IndexedMesh::MeshAttributes> attributes,
+                 Usage usage);
+
+private:
+  const uint32_t native_handle_;
+  const std::vector<IndexedMesh::MeshAttributes> attributes_;
+  const Usage usage_;
+  uint32_t count_;
+};
+} // namespace AnimationViewer::Graphics
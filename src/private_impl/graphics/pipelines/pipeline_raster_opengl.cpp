@@ -109,6 +109,29 @@ PipelineRasterOpenGL::create(const CreateInfo& info)
     return nullptr;
   }
 
+  // GLSL ES 3.00 has no binding qualifier, so blocks and samplers get the binding of the SPIR-V
+  // after linking
+  glUseProgram(program);
+  for (const auto* compiler : { &vertex_shader_compiler, &fragment_shader_compiler }) {
+    auto resources = compiler->get_shader_resources();
+    for (const auto& block : resources.uniform_buffers) {
+      auto index =
+        glGetUniformBlockIndex(program, compiler->get_name(block.base_type_id).c_str());
+      if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(
+          program, index, compiler->get_decoration(block.id, spv::DecorationBinding));
+      }
+    }
+    for (const auto& sampler : resources.sampled_images) {
+      auto location = glGetUniformLocation(program, compiler->get_name(sampler.id).c_str());
+      if (location != -1) {
+        glUniform1i(location,
+                    static_cast<int32_t>(
+                      compiler->get_decoration(sampler.id, spv::DecorationBinding)));
+      }
+    }
+  }
+
   uint32_t winding_order;
   switch (info.winding_order) {
     case TriangleWindingOrder::Clockwise:
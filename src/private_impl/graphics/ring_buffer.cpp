@@ -0,0 +1,153 @@
+#include "ring_buffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include <glad/glad.h>
+
+using AnimationViewer::Graphics::RingBuffer;
+
+namespace {
+uint32_t
+align_up(size_t value, uint32_t alignment)
+{
+  return static_cast<uint32_t>((value + alignment - 1) / alignment * alignment);
+}
+} // namespace
+
+std::unique_ptr<RingBuffer>
+RingBuffer::create(uint32_t frame_size)
+{
+  int32_t alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  uint32_t buffer = 0;
+  glGenBuffers(1, &buffer);
+  auto result = std::unique_ptr<RingBuffer>(
+    new RingBuffer(buffer, static_cast<uint32_t>(std::max(alignment, 1))));
+  result->reserve(frame_size);
+  return result;
+}
+
+RingBuffer::RingBuffer(uint32_t native_handle, uint32_t alignment)
+  : native_handle_(native_handle)
+  , alignment_(alignment)
+  , frame_size_(0)
+  , region_(0)
+  , flushed_(0)
+  , fences_{}
+{}
+
+RingBuffer::~RingBuffer()
+{
+  for (auto fence : fences_) {
+    if (fence != nullptr) {
+      glDeleteSync(static_cast<GLsync>(fence));
+    }
+  }
+  glDeleteBuffers(1, &native_handle_);
+}
+
+void
+RingBuffer::set_debug_name([[maybe_unused]] const std::string& name) const
+{
+#if !__EMSCRIPTEN__
+  glObjectLabel(GL_BUFFER, native_handle_, -1, name.c_str());
+#endif
+}
+
+void
+RingBuffer::begin_frame()
+{
+  staging_.clear();
+  flushed_ = 0;
+  region_ = (region_ + 1) % kRegions;
+#if __EMSCRIPTEN__
+  // Detach the storage the previous frame draws from rather than wait for it
+  glBindBuffer(GL_UNIFORM_BUFFER, native_handle_);
+  glBufferData(GL_UNIFORM_BUFFER, frame_size_, nullptr, GL_DYNAMIC_DRAW);
+#else
+  if (auto fence = static_cast<GLsync>(fences_[region_])) {
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000) ==
+           GL_TIMEOUT_EXPIRED) {
+    }
+    glDeleteSync(fence);
+    fences_[region_] = nullptr;
+  }
+#endif
+}
+
+uint32_t
+RingBuffer::push(const void* data, uint32_t size)
+{
+  auto offset = align_up(staging_.size(), alignment_);
+  staging_.resize(offset + size);
+  std::memcpy(staging_.data() + offset, data, size);
+  return offset;
+}
+
+void
+RingBuffer::flush()
+{
+  if (flushed_ == staging_.size()) {
+    return;
+  }
+  if (staging_.size() > frame_size_) {
+    // Ranges bound earlier this frame keep the old storage, the new one gets all of the frame
+    reserve(std::max(frame_size_ * 2, align_up(staging_.size(), alignment_)));
+    flushed_ = 0;
+  }
+  auto size = static_cast<uint32_t>(staging_.size()) - flushed_;
+  glBindBuffer(GL_UNIFORM_BUFFER, native_handle_);
+#if __EMSCRIPTEN__
+  glBufferSubData(GL_UNIFORM_BUFFER, flushed_, size, staging_.data() + flushed_);
+#else
+  // No draw in flight reads this part of the region, the fence of its last frame was waited on
+  auto* mapped = glMapBufferRange(GL_UNIFORM_BUFFER,
+                                  region_offset() + flushed_,
+                                  size,
+                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                    GL_MAP_UNSYNCHRONIZED_BIT);
+  assert(mapped != nullptr);
+  std::memcpy(mapped, staging_.data() + flushed_, size);
+  glUnmapBuffer(GL_UNIFORM_BUFFER);
+#endif
+  flushed_ = static_cast<uint32_t>(staging_.size());
+}
+
+void
+RingBuffer::bind(uint32_t index, uint32_t offset, uint32_t size) const
+{
+  assert(offset + size <= flushed_);
+  glBindBufferRange(GL_UNIFORM_BUFFER, index, native_handle_, region_offset() + offset, size);
+}
+
+void
+RingBuffer::end_frame()
+{
+#if !__EMSCRIPTEN__
+  assert(fences_[region_] == nullptr);
+  fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+}
+
+void
+RingBuffer::reserve(uint32_t frame_size)
+{
+  // Regions in use stay alive in the storage orphaned by glBufferData, their fences can go
+  for (auto& fence : fences_) {
+    if (fence != nullptr) {
+      glDeleteSync(static_cast<GLsync>(fence));
+      fence = nullptr;
+    }
+  }
+  frame_size_ = align_up(frame_size, alignment_);
+  glBindBuffer(GL_UNIFORM_BUFFER, native_handle_);
+  glBufferData(GL_UNIFORM_BUFFER, kRegions * frame_size_, nullptr, GL_DYNAMIC_DRAW);
+}
+
+uint32_t
+RingBuffer::region_offset() const
+{
+  return region_ * frame_size_;
+}
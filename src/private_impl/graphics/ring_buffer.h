@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace AnimationViewer::Graphics {
+/// Uniform buffer which the data of a frame is pushed to and bound from in ranges
+///
+/// Pushed data is gathered on the CPU and goes up in one transfer per flush. Natively every frame
+/// writes its own region of the buffer, mapped unsynchronized, and only waits for the GPU when it
+/// comes back to a region whose frame is still being drawn. WebGL cannot map buffers, so there
+/// the buffer is orphaned at the start of every frame instead.
+class RingBuffer
+{
+public:
+#if __EMSCRIPTEN__
+  static constexpr uint32_t kRegions = 1;
+#else
+  static constexpr uint32_t kRegions = 3;
+#endif
+
+  /// @frame_size bytes are pushed per frame before the buffer grows
+  static std::unique_ptr<RingBuffer> create(uint32_t frame_size);
+  virtual ~RingBuffer();
+
+  void set_debug_name(const std::string& name) const;
+  /// Move on to the next region, everything pushed before is released
+  void begin_frame();
+  /// Copy @size bytes of @data into the frame, returns their offset to bind them with
+  uint32_t push(const void* data, uint32_t size);
+  /// Upload everything pushed since the last flush, must be called before drawing with it
+  void flush();
+  /// Bind @size bytes starting at @offset to uniform block @index
+  void bind(uint32_t index, uint32_t offset, uint32_t size) const;
+  /// Guard the region of the frame until the GPU is done with the draws issued so far
+  void end_frame();
+
+protected:
+  RingBuffer(uint32_t native_handle, uint32_t alignment);
+
+private:
+  /// Allocate room for @frame_size bytes per region, the previous contents are dropped
+  void reserve(uint32_t frame_size);
+  uint32_t region_offset() const;
+
+  const uint32_t native_handle_;
+  const uint32_t alignment_;
+  uint32_t frame_size_;
+  uint32_t region_;
+  /// Uploaded bytes of staging_
+  uint32_t flushed_;
+  std::vector<uint8_t> staging_;
+  /// Sync objects of the last frame written to every region
+  std::array<void*, kRegions> fences_;
+};
+} // namespace AnimationViewer::Graphics
@@ -0,0 +1,15 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : require
+
+#include "bridging_header.h"
+
+layout(binding = 0, std140) uniform uniform_fragment_block_t {
+    joint_uniform_t data;
+} uniform_block;
+
+layout(location = 0) out vec4 out_color;
+
+void main() {
+    out_color = uniform_block.data.color;
+}
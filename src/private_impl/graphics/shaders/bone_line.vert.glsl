@@ -0,0 +1,19 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : require
+
+#include "bridging_header.h"
+
+layout(binding = 1, std140) uniform uniform_camera_block_t {
+    camera_uniform_t data;
+} camera_block;
+
+layout(location = 0) in vec3 vertex_position; // x is 0 at the parent and 1 at the child
+// World positions of the parent and child joint of the bone
+layout(location = 1) in vec3 instance_start;
+layout(location = 2) in vec3 instance_end;
+
+void main() {
+    vec3 position = mix(instance_start, instance_end, vertex_position.x);
+    gl_Position = camera_block.data.projection_matrix * camera_block.data.view_matrix * vec4(position, 1.0);
+}
@@ -50,21 +50,41 @@ struct alignas(16) sky_uniform_t
   uint32_t height;
 };
 
-struct alignas(16) mesh_uniform_t
+// Uploaded once per frame
+struct alignas(16) camera_uniform_t
 {
   mat4 projection_matrix;
   mat4 view_matrix;
-  mat4 model_matrix;
   vec4 direction_to_sun;
-  mat4 bone_trans_rots[256];
-  // storage buffer
 };
 
+// Shared by every instance of a mesh drawn at once
+struct alignas(16) mesh_uniform_t
+{
+  // Packed vertex positions are relative to the center of the mesh bounds, in half extents
+  vec4 position_offset;
+  vec4 position_scale;
+};
+
+// Meshes are instanced, every instance has the rows of its affine model matrix and the first
+// texel and number of bones of its palette in the bone palette texture as vertex attributes from
+// this location on
+#define MESH_INSTANCE_LOCATION 4
+
+// Bone palettes are stored in an rgba32f texture, three texels per bone holding the rows of its
+// affine matrix, filling every row of the texture before moving on to the next
+#define BONE_PALETTE_TEXELS 3
+
+// Joint disks and bone lines are instanced, their transforms are instance attributes
 struct alignas(16) joint_uniform_t
 {
-  mat4 vp;
-  mat4 model;
   vec4 color;
+};
+
+// Points of a motion capture are instance attributes read straight from its frames
+struct alignas(16) mocap_uniform_t
+{
+  float scale;
   float node_size;
 };
 
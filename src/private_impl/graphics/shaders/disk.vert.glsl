@@ -4,14 +4,20 @@
 
 #include "bridging_header.h"
 
-layout(binding = 0, std140) uniform uniform_vertex_block_t {
-    joint_uniform_t data;
-} uniform_block;
+layout(binding = 1, std140) uniform uniform_camera_block_t {
+    camera_uniform_t data;
+} camera_block;
 
 layout(location = 0) in vec3 vertex_position;
+// Rows of the affine matrix of the joint, scaled to the size of its disk
+layout(location = 1) in vec4 instance_row_0;
+layout(location = 2) in vec4 instance_row_1;
+layout(location = 3) in vec4 instance_row_2;
 layout(location = 0) out float edge;
 
 void main() {
-    gl_Position = uniform_block.data.vp * uniform_block.data.model * vec4(vertex_position * uniform_block.data.node_size, 1.0);
+    vec4 position = vec4(vertex_position, 1.0);
+    position = vec4(dot(instance_row_0, position), dot(instance_row_1, position), dot(instance_row_2, position), 1.0);
+    gl_Position = camera_block.data.projection_matrix * camera_block.data.view_matrix * position;
     edge = float(dot(vertex_position, vertex_position) > 0.0f);
 }
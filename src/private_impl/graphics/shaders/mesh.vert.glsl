@@ -3,21 +3,29 @@
 #extension GL_GOOGLE_include_directive : require
 
 #include "bridging_header.h"
+#include "skinning.h"
 
-layout(binding = 0, std140) uniform uniform_vertex_block_t {
-  mesh_uniform_t data;
-} uniform_block;
+layout(binding = 1, std140) uniform uniform_camera_block_t {
+  camera_uniform_t data;
+} camera_block;
+
+layout(binding = 0) uniform highp sampler2D bone_palette;
 
 layout(location = 0) in vec3 vertex_position;
 layout(location = 1) in vec3 vertex_normal;
 layout(location = 2) in vec3 vertex_bone_ids; // Blend x and y by z value
 
+layout(location = MESH_INSTANCE_LOCATION + 0) in vec4 instance_model_row_0;
+layout(location = MESH_INSTANCE_LOCATION + 1) in vec4 instance_model_row_1;
+layout(location = MESH_INSTANCE_LOCATION + 2) in vec4 instance_model_row_2;
+layout(location = MESH_INSTANCE_LOCATION + 3) in uvec2 instance_bone_palette; // Offset and count
+
 layout(location = 0) out vec3 fragment_position;
 layout(location = 1) out vec3 fragment_normal;
 
 void main() {
-    mat4 mv = uniform_block.data.view_matrix * uniform_block.data.model_matrix;
-    mat4 mvp = uniform_block.data.projection_matrix * mv;
+    mat4 mv = camera_block.data.view_matrix * transpose(mat4(instance_model_row_0, instance_model_row_1, instance_model_row_2, vec4(0, 0, 0, 1)));
+    mat4 mvp = camera_block.data.projection_matrix * mv;
   // Augment vertex_position with 1 in the w parameter indicating that it is a
   // point and can be translated.
   // Transform the position of the vertex with the inverse camera view to move
@@ -26,8 +34,8 @@ void main() {
   // infinite R3 to Normalized Device coordinates. A box from -1 to 1 in three
   // axis where the xy coordinates are perpective projected (parallel lines
   // converge at a point) and the z gets fed into the depth-buffer.
-  vec4 trans_rot_vertex_pos_0 = uniform_block.data.bone_trans_rots[uint(vertex_bone_ids.x)] * vec4(vertex_position, 1);
-  vec4 trans_rot_vertex_pos_1 = uniform_block.data.bone_trans_rots[uint(vertex_bone_ids.y)] * vec4(vertex_position, 1);
+  vec4 trans_rot_vertex_pos_0 = skin(bone_palette, instance_bone_palette.x, instance_bone_palette.y, uint(vertex_bone_ids.x), vec4(vertex_position, 1));
+  vec4 trans_rot_vertex_pos_1 = skin(bone_palette, instance_bone_palette.x, instance_bone_palette.y, uint(vertex_bone_ids.y), vec4(vertex_position, 1));
   vec4 blended_trans_rot_vertex_pos = mix(trans_rot_vertex_pos_0, trans_rot_vertex_pos_1, vertex_bone_ids.z);
   gl_Position = mvp * blended_trans_rot_vertex_pos;
   // We also store the position unaffected by perpective to do lighting calculations
@@ -0,0 +1,52 @@
+#version 450 core
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : require
+
+#include "bridging_header.h"
+#include "skinning.h"
+
+layout(binding = 0, std140) uniform uniform_vertex_block_t {
+  mesh_uniform_t data;
+} uniform_block;
+
+layout(binding = 1, std140) uniform uniform_camera_block_t {
+  camera_uniform_t data;
+} camera_block;
+
+layout(binding = 0) uniform highp sampler2D bone_palette;
+
+layout(location = 0) in vec4 vertex_position; // Normalized to the mesh bounds, w unused
+layout(location = 1) in vec2 vertex_normal; // Octahedral encoding
+layout(location = 2) in uvec2 vertex_bone_ids;
+layout(location = 3) in vec4 vertex_bone_blend; // Blend x and y of the ids by x, rest unused
+
+layout(location = MESH_INSTANCE_LOCATION + 0) in vec4 instance_model_row_0;
+layout(location = MESH_INSTANCE_LOCATION + 1) in vec4 instance_model_row_1;
+layout(location = MESH_INSTANCE_LOCATION + 2) in vec4 instance_model_row_2;
+layout(location = MESH_INSTANCE_LOCATION + 3) in uvec2 instance_bone_palette; // Offset and count
+
+layout(location = 0) out vec3 fragment_position;
+layout(location = 1) out vec3 fragment_normal;
+
+vec3 decode_octahedral(vec2 encoded) {
+  vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+  // The lower hemisphere is folded over the diagonals
+  if (normal.z < 0.0) {
+    vec2 signs = vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+    normal.xy = (1.0 - abs(normal.yx)) * signs;
+  }
+  return normalize(normal);
+}
+
+void main() {
+  mat4 mv = camera_block.data.view_matrix * transpose(mat4(instance_model_row_0, instance_model_row_1, instance_model_row_2, vec4(0, 0, 0, 1)));
+  mat4 mvp = camera_block.data.projection_matrix * mv;
+  // Same as mesh.vert.glsl once the position and normal are decoded
+  vec4 position = vec4(uniform_block.data.position_offset.xyz + uniform_block.data.position_scale.xyz * vertex_position.xyz, 1);
+  vec4 trans_rot_vertex_pos_0 = skin(bone_palette, instance_bone_palette.x, instance_bone_palette.y, vertex_bone_ids.x, position);
+  vec4 trans_rot_vertex_pos_1 = skin(bone_palette, instance_bone_palette.x, instance_bone_palette.y, vertex_bone_ids.y, position);
+  vec4 blended_trans_rot_vertex_pos = mix(trans_rot_vertex_pos_0, trans_rot_vertex_pos_1, vertex_bone_blend.x);
+  gl_Position = mvp * blended_trans_rot_vertex_pos;
+  fragment_position = (mv * blended_trans_rot_vertex_pos).xyz;
+  fragment_normal = normalize((mv * vec4(decode_octahedral(vertex_normal), 0)).xyz);
+}
@@ -0,0 +1,25 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : require
+
+#include "bridging_header.h"
+
+layout(binding = 1, std140) uniform uniform_camera_block_t {
+    camera_uniform_t data;
+} camera_block;
+
+layout(binding = 2, std140) uniform uniform_mocap_block_t {
+    mocap_uniform_t data;
+} mocap_block;
+
+layout(location = 0) in vec3 vertex_position;
+// Position of the point in the current frame, as captured
+layout(location = 1) in vec3 instance_position;
+layout(location = 0) out float edge;
+
+void main() {
+    float scale = mocap_block.data.scale;
+    vec3 position = scale * (scale * instance_position + vertex_position * mocap_block.data.node_size);
+    gl_Position = camera_block.data.projection_matrix * camera_block.data.view_matrix * vec4(position, 1.0);
+    edge = float(dot(vertex_position, vertex_position) > 0.0f);
+}
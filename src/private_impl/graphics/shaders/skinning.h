@@ -0,0 +1,17 @@
+#ifndef SKINNING_H
+#define SKINNING_H
+
+// Transform @position by the affine matrix of @bone of the palette starting at texel @offset,
+// bones past the @count bones of the palette are clamped to the last one
+vec4 skin(highp sampler2D palette, uint offset, uint count, uint bone, vec4 position)
+{
+  int width = textureSize(palette, 0).x;
+  int texel = int(offset + min(bone, count - 1u) * uint(BONE_PALETTE_TEXELS));
+  vec4 rows[BONE_PALETTE_TEXELS];
+  for (int i = 0; i < BONE_PALETTE_TEXELS; ++i) {
+    rows[i] = texelFetch(palette, ivec2((texel + i) % width, (texel + i) / width), 0);
+  }
+  return vec4(dot(rows[0], position), dot(rows[1], position), dot(rows[2], position), position.w);
+}
+
+#endif // SKINNING_H
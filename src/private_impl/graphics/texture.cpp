@@ -169,6 +169,28 @@ Texture::upload(const void* data, [[maybe_unused]] uint32_t size) const
   glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, gl_format.format, gl_format.type, data);
 }
 
+void
+Texture::upload_rows(const void* data, uint32_t row_count) const
+{
+  assert(row_count <= height_);
+  auto gl_format = TextureFormatLookUpTable[static_cast<uint32_t>(format_)];
+  glBindTexture(GL_TEXTURE_2D, native_texture_);
+  glTexSubImage2D(
+    GL_TEXTURE_2D, 0, 0, 0, width_, row_count, gl_format.format, gl_format.type, data);
+}
+
+uint32_t
+Texture::width() const
+{
+  return width_;
+}
+
+uint32_t
+Texture::height() const
+{
+  return height_;
+}
+
 uintptr_t
 Texture::get_native_handle() const
 {
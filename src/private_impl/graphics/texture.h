@@ -76,6 +76,10 @@ struct Texture
   void set_debug_name(const std::string& name) const;
   void bind(uint32_t slot) const;
   void upload(const void* data, uint32_t size) const;
+  /// Upload the first @row_count rows, @data holds full rows
+  void upload_rows(const void* data, uint32_t row_count) const;
+  uint32_t width() const;
+  uint32_t height() const;
   uintptr_t get_native_handle() const;
 
 private:
@@ -0,0 +1,478 @@
+#include "asset_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <type_traits>
+
+#include "mapped_file.h"
+#include "private_impl/compression/compressed_animation.h"
+#include "private_impl/graphics/indexed_mesh.h"
+#include "resource.h"
+
+using namespace AnimationViewer;
+using namespace AnimationViewer::Io;
+
+namespace {
+constexpr char kMagic[8] = { 'A', 'V', 'C', 'A', 'C', 'H', 'E', '\0' };
+/// Bump whenever the layout of the file or of a serialized resource changes, or the conversion
+/// that produced it does
+constexpr uint32_t kVersion = 6;
+
+struct FileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t importer;
+  uint64_t source_size;
+  int64_t source_modification_time;
+  uint64_t content_hash;
+  uint32_t mesh_count;
+  uint32_t animation_count;
+};
+static_assert(sizeof(FileHeader) == 48);
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ull;
+
+constexpr uint64_t
+rotate_left(uint64_t value, int bits)
+{
+  return (value << bits) | (value >> (64 - bits));
+}
+
+/// 64 bit hash over four independent lanes so it keeps up with reading from the page cache
+uint64_t
+hash_contents(const uint8_t* data, size_t size)
+{
+  uint64_t lanes[4] = { kPrime1 + kPrime2, kPrime2, 0, 0 - kPrime1 };
+  size_t offset = 0;
+  for (; offset + sizeof(lanes) <= size; offset += sizeof(lanes)) {
+    for (uint32_t i = 0; i < 4; ++i) {
+      uint64_t word;
+      std::memcpy(&word, data + offset + i * sizeof(word), sizeof(word));
+      lanes[i] = rotate_left(lanes[i] + word * kPrime2, 31) * kPrime1;
+    }
+  }
+  uint64_t hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7) + rotate_left(lanes[2], 12) +
+                  rotate_left(lanes[3], 18);
+  hash += size;
+  for (; offset < size; ++offset) {
+    hash = rotate_left(hash ^ (data[offset] * kPrime3), 11) * kPrime1;
+  }
+  // Avalanche
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+/// FNV-1a, only used for naming entries
+uint64_t
+hash_string(const std::string& string)
+{
+  uint64_t hash = 0xCBF29CE484222325ull;
+  for (auto c : string) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3ull;
+  }
+  return hash;
+}
+
+std::filesystem::path
+default_directory()
+{
+#ifdef _WIN32
+  if (auto local = std::getenv("LOCALAPPDATA"); local && *local) {
+    return std::filesystem::path(local) / "AnimationViewer" / "cache";
+  }
+#else
+  if (auto xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+    return std::filesystem::path(xdg) / "AnimationViewer";
+  }
+  if (auto home = std::getenv("HOME"); home && *home) {
+    return std::filesystem::path(home) / ".cache" / "AnimationViewer";
+  }
+#endif
+  std::error_code error;
+  auto temp = std::filesystem::temp_directory_path(error);
+  if (error) {
+    return {};
+  }
+  return temp / "AnimationViewer";
+}
+
+class Writer
+{
+public:
+  template<typename T>
+  void write(const T& value)
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    append(&value, sizeof(value));
+  }
+
+  template<typename T>
+  void write_array(const std::vector<T>& values)
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    write<uint64_t>(values.size());
+    align();
+    append(values.data(), values.size() * sizeof(T));
+  }
+
+  void write_string(const std::string& string)
+  {
+    write<uint32_t>(static_cast<uint32_t>(string.size()));
+    append(string.data(), string.size());
+  }
+
+  /// Arrays start 16 byte aligned so they can be used in place from a mapping
+  void align() { buffer_.resize((buffer_.size() + 15) & ~size_t{ 15 }); }
+
+  const std::vector<uint8_t>& buffer() const { return buffer_; }
+
+private:
+  void append(const void* data, size_t size)
+  {
+    auto offset = buffer_.size();
+    buffer_.resize(offset + size);
+    if (size > 0) {
+      std::memcpy(buffer_.data() + offset, data, size);
+    }
+  }
+
+  std::vector<uint8_t> buffer_;
+};
+
+/// Bounds checked reads, any failure means the entry is corrupt
+class Reader
+{
+public:
+  Reader(const uint8_t* data, size_t size)
+    : data_(data)
+    , size_(size)
+    , offset_(0)
+  {}
+
+  template<typename T>
+  bool read(T& value)
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (size_ - offset_ < sizeof(value)) {
+      return false;
+    }
+    std::memcpy(&value, data_ + offset_, sizeof(value));
+    offset_ += sizeof(value);
+    return true;
+  }
+
+  template<typename T>
+  bool read_array(std::vector<T>& values)
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    uint64_t count;
+    if (!read(count)) {
+      return false;
+    }
+    align();
+    if (count > (size_ - offset_) / sizeof(T)) {
+      return false;
+    }
+    values.resize(count);
+    if (count > 0) {
+      std::memcpy(values.data(), data_ + offset_, count * sizeof(T));
+    }
+    offset_ += count * sizeof(T);
+    return true;
+  }
+
+  bool read_string(std::string& string)
+  {
+    uint32_t length;
+    if (!read(length) || length > size_ - offset_) {
+      return false;
+    }
+    string.assign(reinterpret_cast<const char*>(data_ + offset_), length);
+    offset_ += length;
+    return true;
+  }
+
+  void align() { offset_ = std::min(size_, (offset_ + 15) & ~size_t{ 15 }); }
+
+  /// Upper bound for element counts read from the entry, so corrupt ones can't exhaust memory
+  size_t remaining() const { return size_ - offset_; }
+
+private:
+  const uint8_t* const data_;
+  const size_t size_;
+  size_t offset_;
+};
+
+void
+write_mesh(Writer& writer, ENTT_ID_TYPE id, const Resource::Mesh& mesh)
+{
+  writer.write(id);
+  writer.write_string(mesh.name);
+  writer.write<uint32_t>(mesh.default_matrix.has_value());
+  writer.write(mesh.default_matrix.value_or(glm::mat4(1.0f)));
+  writer.write_array(mesh.vertices);
+  writer.write<uint32_t>(static_cast<uint32_t>(mesh.bones.size()));
+  for (const auto& bone : mesh.bones) {
+    writer.write_string(bone.name);
+    writer.write(bone.parent);
+    writer.write(bone.firstChild);
+    writer.write(bone.rightSibling);
+    writer.write(bone.position);
+    writer.write(bone.orientation);
+  }
+  writer.write_array(mesh.indices);
+  writer.write_array(mesh.submeshes);
+  writer.write_array(mesh.lods);
+}
+
+bool
+read_mesh(Reader& reader, ENTT_ID_TYPE& id, Resource::Mesh& mesh)
+{
+  uint32_t has_default_matrix;
+  glm::mat4 default_matrix;
+  uint32_t bone_count;
+  if (!reader.read(id) || !reader.read_string(mesh.name) || !reader.read(has_default_matrix) ||
+      !reader.read(default_matrix) || !reader.read_array(mesh.vertices) ||
+      !reader.read(bone_count)) {
+    return false;
+  }
+  if (has_default_matrix) {
+    mesh.default_matrix = default_matrix;
+  }
+  if (bone_count > reader.remaining()) {
+    return false;
+  }
+  mesh.bones.resize(bone_count);
+  for (auto& bone : mesh.bones) {
+    if (!reader.read_string(bone.name) || !reader.read(bone.parent) ||
+        !reader.read(bone.firstChild) || !reader.read(bone.rightSibling) ||
+        !reader.read(bone.position) || !reader.read(bone.orientation)) {
+      return false;
+    }
+  }
+  return reader.read_array(mesh.indices) && reader.read_array(mesh.submeshes) &&
+         reader.read_array(mesh.lods);
+}
+
+void
+write_animation(Writer& writer, ENTT_ID_TYPE id, const Resource::Animation& animation)
+{
+  writer.write(id);
+  writer.write_string(animation.name);
+  writer.write(animation.frame_rate);
+  writer.write(animation.frame_count);
+  writer.write(animation.animation_duration);
+  writer.write<uint32_t>(static_cast<uint32_t>(animation.joint_names.size()));
+  for (const auto& joint_name : animation.joint_names) {
+    writer.write_string(joint_name);
+  }
+  writer.write_array(animation.joint_parents);
+  writer.write_array(animation.joint_offsets);
+  writer.write(animation.joint_count);
+  writer.write(animation.layout);
+  writer.write_array(animation.frame_times);
+  // All channels are in one allocation, so they load with a single copy
+  writer.write_array(animation.samples);
+}
+
+bool
+read_animation(Reader& reader, ENTT_ID_TYPE& id, Resource::Animation& animation)
+{
+  uint32_t joint_count;
+  if (!reader.read(id) || !reader.read_string(animation.name) ||
+      !reader.read(animation.frame_rate) || !reader.read(animation.frame_count) ||
+      !reader.read(animation.animation_duration) || !reader.read(joint_count)) {
+    return false;
+  }
+  if (joint_count > reader.remaining()) {
+    return false;
+  }
+  animation.joint_names.resize(joint_count);
+  for (auto& joint_name : animation.joint_names) {
+    if (!reader.read_string(joint_name)) {
+      return false;
+    }
+  }
+  if (!reader.read_array(animation.joint_parents) || !reader.read_array(animation.joint_offsets) ||
+      !reader.read(animation.joint_count) || !reader.read(animation.layout) ||
+      !reader.read_array(animation.frame_times) || !reader.read_array(animation.samples)) {
+    return false;
+  }
+  return (animation.layout == Resource::Animation::Layout::FrameMajor ||
+          animation.layout == Resource::Animation::Layout::JointMajor) &&
+         (animation.joint_parents.empty() ||
+          animation.joint_parents.size() == animation.joint_count) &&
+         (animation.joint_offsets.empty() ||
+          animation.joint_offsets.size() == animation.joint_count) &&
+         animation.frame_times.size() == animation.frame_count &&
+         animation.samples.size() ==
+           Resource::Animation::block_count(size_t{ animation.frame_count } *
+                                            animation.joint_count);
+}
+} // namespace
+
+std::unique_ptr<AssetCache>
+AssetCache::create(std::filesystem::path directory)
+{
+#ifdef __EMSCRIPTEN__
+  // The file system only lives in memory, entries would never outlive the session
+  return nullptr;
+#else
+  if (directory.empty()) {
+    directory = default_directory();
+  }
+  if (directory.empty()) {
+    return nullptr;
+  }
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  if (error) {
+    return nullptr;
+  }
+  return std::unique_ptr<AssetCache>(new AssetCache(std::move(directory)));
+#endif
+}
+
+AssetCache::AssetCache(std::filesystem::path&& directory)
+  : directory_(std::move(directory))
+{}
+
+AssetCache::~AssetCache() = default;
+
+std::optional<AssetCache::Key>
+AssetCache::make_key(const std::filesystem::path& source, uint32_t importer) const
+{
+  std::error_code error;
+  auto absolute = std::filesystem::absolute(source, error);
+  if (error) {
+    return std::nullopt;
+  }
+  auto modification_time = std::filesystem::last_write_time(absolute, error);
+  if (error) {
+    return std::nullopt;
+  }
+  auto contents = MappedFile::create(absolute);
+  if (!contents) {
+    return std::nullopt;
+  }
+  return Key{
+    absolute.string(),
+    importer,
+    contents->size(),
+    static_cast<int64_t>(modification_time.time_since_epoch().count()),
+    hash_contents(contents->data(), contents->size()),
+  };
+}
+
+bool
+AssetCache::load(const Key& key, MeshList& meshes, AnimationList& animations) const
+{
+  auto entry = MappedFile::create(entry_path(key));
+  if (!entry) {
+    return false;
+  }
+
+  Reader reader(entry->data(), entry->size());
+  FileHeader header;
+  std::string source;
+  if (!reader.read(header) || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.importer != key.importer ||
+      header.source_size != key.size ||
+      header.source_modification_time != key.modification_time ||
+      header.content_hash != key.content_hash || !reader.read_string(source) ||
+      source != key.source || header.mesh_count > reader.remaining() ||
+      header.animation_count > reader.remaining()) {
+    return false;
+  }
+
+  MeshList loaded_meshes(header.mesh_count);
+  for (auto& [id, mesh] : loaded_meshes) {
+    mesh = std::make_shared<Resource::Mesh>();
+    if (!read_mesh(reader, id, *mesh)) {
+      return false;
+    }
+  }
+  AnimationList loaded_animations(header.animation_count);
+  for (auto& [id, animation] : loaded_animations) {
+    animation = std::make_shared<Resource::Animation>();
+    if (!read_animation(reader, id, *animation)) {
+      return false;
+    }
+  }
+
+  meshes.insert(meshes.end(),
+                std::make_move_iterator(loaded_meshes.begin()),
+                std::make_move_iterator(loaded_meshes.end()));
+  animations.insert(animations.end(),
+                    std::make_move_iterator(loaded_animations.begin()),
+                    std::make_move_iterator(loaded_animations.end()));
+  return true;
+}
+
+bool
+AssetCache::store(const Key& key, const MeshList& meshes, const AnimationList& animations) const
+{
+  FileHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.importer = key.importer;
+  header.source_size = key.size;
+  header.source_modification_time = key.modification_time;
+  header.content_hash = key.content_hash;
+  header.mesh_count = static_cast<uint32_t>(meshes.size());
+  header.animation_count = static_cast<uint32_t>(animations.size());
+
+  Writer writer;
+  writer.write(header);
+  writer.write_string(key.source);
+  for (const auto& [id, mesh] : meshes) {
+    write_mesh(writer, id, *mesh);
+  }
+  for (const auto& [id, animation] : animations) {
+    write_animation(writer, id, *animation);
+  }
+
+  // Write next to the entry and rename over it so readers never map a partial file
+  auto path = entry_path(key);
+  auto temporary = path;
+  temporary += "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  FILE* file = fopen(temporary.string().c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  const auto& buffer = writer.buffer();
+  bool written = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+  written = fclose(file) == 0 && written;
+  std::error_code error;
+  if (written) {
+    std::filesystem::rename(temporary, path, error);
+  }
+  if (!written || error) {
+    std::filesystem::remove(temporary, error);
+    return false;
+  }
+  return true;
+}
+
+std::filesystem::path
+AssetCache::entry_path(const Key& key) const
+{
+  char name[32];
+  snprintf(name,
+           sizeof(name),
+           "%016llx.avcache",
+           static_cast<unsigned long long>(
+             hash_string(key.source + ":" + std::to_string(key.importer))));
+  return directory_ / name;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <entt/core/hashed_string.hpp>
+
+namespace AnimationViewer {
+namespace Resource {
+struct Mesh;
+struct Animation;
+} // namespace Resource
+
+namespace Io {
+/// On-disk cache of converted meshes and animations in the native .avcache format
+///
+/// Entries are keyed by source path and importer and only hit if the source's size, modification
+/// time and content hash are unchanged. All members are safe to call from import workers.
+class AssetCache
+{
+public:
+  using MeshList = std::vector<std::pair<ENTT_ID_TYPE, std::shared_ptr<Resource::Mesh>>>;
+  using AnimationList = std::vector<std::pair<ENTT_ID_TYPE, std::shared_ptr<Resource::Animation>>>;
+
+  struct Key
+  {
+    std::string source;
+    /// Which importer and settings produced the resources
+    uint32_t importer;
+    uint64_t size;
+    int64_t modification_time;
+    uint64_t content_hash;
+  };
+
+  /// Uses the platform cache directory when @directory is empty
+  static std::unique_ptr<AssetCache> create(std::filesystem::path directory = {});
+  virtual ~AssetCache();
+
+  /// Hashes the contents of @source, std::nullopt if it can't be read
+  std::optional<Key> make_key(const std::filesystem::path& source, uint32_t importer) const;
+
+  /// Bulk copy the resources of a valid entry out of its mapping
+  bool load(const Key& key, MeshList& meshes, AnimationList& animations) const;
+  /// Write an entry, replacing any previous one for the same source and importer
+  bool store(const Key& key, const MeshList& meshes, const AnimationList& animations) const;
+
+protected:
+  explicit AssetCache(std::filesystem::path&& directory);
+
+private:
+  std::filesystem::path entry_path(const Key& key) const;
+
+  const std::filesystem::path directory_;
+};
+} // namespace Io
+} // namespace AnimationViewer
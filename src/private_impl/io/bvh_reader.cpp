@@ -0,0 +1,289 @@
+#include "bvh_reader.h"
+
+#include <charconv>
+#include <cstdlib>
+#include <limits>
+#include <optional>
+#include <type_traits>
+
+#include "mapped_file.h"
+
+using namespace AnimationViewer::Io;
+
+namespace {
+/// Parent of roots and placeholder for end sites while parsing
+constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+/// Anything up to and including space separates tokens
+bool
+is_separator(char c)
+{
+  return static_cast<unsigned char>(c) <= ' ';
+}
+
+std::optional<BvhReader::Channel>
+parse_channel(std::string_view name)
+{
+  if (name == "Xposition") {
+    return BvhReader::Channel::XPosition;
+  }
+  if (name == "Yposition") {
+    return BvhReader::Channel::YPosition;
+  }
+  if (name == "Zposition") {
+    return BvhReader::Channel::ZPosition;
+  }
+  if (name == "Xrotation") {
+    return BvhReader::Channel::XRotation;
+  }
+  if (name == "Yrotation") {
+    return BvhReader::Channel::YRotation;
+  }
+  if (name == "Zrotation") {
+    return BvhReader::Channel::ZRotation;
+  }
+  return std::nullopt;
+}
+
+template<typename T>
+const char*
+parse_number(const char* begin, const char* end, T& value)
+{
+#if __cpp_lib_to_chars >= 201611L
+  auto [ptr, error] = std::from_chars(begin, end, value);
+  return error == std::errc() ? ptr : nullptr;
+#else
+  // Without floating point from_chars, bound strtof to a terminated copy of the token
+  char token[64];
+  size_t length = 0;
+  while (begin + length != end && !is_separator(begin[length]) && length + 1 < sizeof(token)) {
+    token[length] = begin[length];
+    ++length;
+  }
+  token[length] = '\0';
+  char* token_end;
+  if constexpr (std::is_floating_point_v<T>) {
+    value = std::strtof(token, &token_end);
+  } else {
+    if (token[0] == '-') {
+      return nullptr;
+    }
+    auto parsed = std::strtoull(token, &token_end, 10);
+    if (parsed > std::numeric_limits<T>::max()) {
+      return nullptr;
+    }
+    value = static_cast<T>(parsed);
+  }
+  return token_end == token ? nullptr : begin + (token_end - token);
+#endif
+}
+} // namespace
+
+std::unique_ptr<BvhReader>
+BvhReader::create(const std::filesystem::path& path)
+{
+  auto file = MappedFile::create(path);
+  if (!file) {
+    return nullptr;
+  }
+  std::span<const uint8_t> contents(file->data(), file->size());
+  auto reader = std::unique_ptr<BvhReader>(new BvhReader(std::move(file), contents));
+  if (!reader->parse_hierarchy()) {
+    return nullptr;
+  }
+  return reader;
+}
+
+std::unique_ptr<BvhReader>
+BvhReader::create(std::span<const uint8_t> contents)
+{
+  auto reader = std::unique_ptr<BvhReader>(new BvhReader(nullptr, contents));
+  if (!reader->parse_hierarchy()) {
+    return nullptr;
+  }
+  return reader;
+}
+
+BvhReader::BvhReader(std::unique_ptr<MappedFile>&& file, std::span<const uint8_t> contents)
+  : file_(std::move(file))
+  , begin_(reinterpret_cast<const char*>(contents.data()))
+  , cursor_(begin_)
+  , end_(begin_ + contents.size())
+  , channel_count_(0)
+  , frame_count_(0)
+  , frame_time_(0.0f)
+{}
+
+BvhReader::~BvhReader() = default;
+
+const std::vector<BvhReader::Joint>&
+BvhReader::joints() const
+{
+  return joints_;
+}
+
+uint32_t
+BvhReader::channel_count() const
+{
+  return channel_count_;
+}
+
+uint32_t
+BvhReader::frame_count() const
+{
+  return frame_count_;
+}
+
+float
+BvhReader::frame_time() const
+{
+  return frame_time_;
+}
+
+bool
+BvhReader::read_frame(float* channels)
+{
+  for (uint32_t i = 0; i < channel_count_; ++i) {
+    if (!next_float(channels[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+float
+BvhReader::progress() const
+{
+  return static_cast<float>(cursor_ - begin_) / static_cast<float>(end_ - begin_);
+}
+
+std::string_view
+BvhReader::next_token()
+{
+  while (cursor_ != end_ && is_separator(*cursor_)) {
+    ++cursor_;
+  }
+  auto begin = cursor_;
+  while (cursor_ != end_ && !is_separator(*cursor_)) {
+    ++cursor_;
+  }
+  return std::string_view(begin, static_cast<size_t>(cursor_ - begin));
+}
+
+bool
+BvhReader::next_float(float& value)
+{
+  while (cursor_ != end_ && is_separator(*cursor_)) {
+    ++cursor_;
+  }
+  // from_chars doesn't take an explicit plus sign
+  if (cursor_ != end_ && *cursor_ == '+') {
+    ++cursor_;
+  }
+  auto number_end = parse_number(cursor_, end_, value);
+  // Numbers have to end at a separator, "1.0abc" is an error and not two tokens
+  if (number_end == nullptr || (number_end != end_ && !is_separator(*number_end))) {
+    return false;
+  }
+  cursor_ = number_end;
+  return true;
+}
+
+bool
+BvhReader::next_uint(uint32_t& value)
+{
+  while (cursor_ != end_ && is_separator(*cursor_)) {
+    ++cursor_;
+  }
+  auto number_end = parse_number(cursor_, end_, value);
+  if (number_end == nullptr || (number_end != end_ && !is_separator(*number_end))) {
+    return false;
+  }
+  cursor_ = number_end;
+  return true;
+}
+
+bool
+BvhReader::expect(std::string_view token)
+{
+  return next_token() == token;
+}
+
+bool
+BvhReader::parse_hierarchy()
+{
+  if (!expect("HIERARCHY")) {
+    return false;
+  }
+
+  // Joint of every open brace, iterative so deep hierarchies can't overflow the stack
+  std::vector<uint32_t> open;
+  for (;;) {
+    auto token = next_token();
+    if (token == "ROOT" || token == "JOINT") {
+      // Roots are top level, joints are nested in another joint and never in an end site
+      if ((token == "ROOT") != open.empty() || (!open.empty() && open.back() == kNone)) {
+        return false;
+      }
+      auto name = next_token();
+      if (name.empty() || !expect("{")) {
+        return false;
+      }
+      auto parent = open.empty() ? kNone : open.back();
+      open.push_back(static_cast<uint32_t>(joints_.size()));
+      joints_.push_back({ std::string(name), parent, glm::vec3(0.0f), {} });
+    } else if (token == "End") {
+      if (open.empty() || open.back() == kNone || !expect("Site") || !expect("{")) {
+        return false;
+      }
+      open.push_back(kNone);
+    } else if (token == "OFFSET") {
+      glm::vec3 offset;
+      if (open.empty() || !next_float(offset.x) || !next_float(offset.y) ||
+          !next_float(offset.z)) {
+        return false;
+      }
+      if (open.back() != kNone) {
+        joints_[open.back()].offset = offset;
+      }
+    } else if (token == "CHANNELS") {
+      uint32_t count;
+      if (open.empty() || open.back() == kNone || !next_uint(count)) {
+        return false;
+      }
+      auto& channels = joints_[open.back()].channels;
+      // Each axis at most once for position and rotation
+      if (!channels.empty() || count > 6) {
+        return false;
+      }
+      for (uint32_t i = 0; i < count; ++i) {
+        auto channel = parse_channel(next_token());
+        if (!channel) {
+          return false;
+        }
+        channels.push_back(*channel);
+      }
+      channel_count_ += count;
+    } else if (token == "}") {
+      if (open.empty()) {
+        return false;
+      }
+      open.pop_back();
+    } else if (token == "MOTION") {
+      if (!open.empty() || joints_.empty()) {
+        return false;
+      }
+      break;
+    } else {
+      return false;
+    }
+  }
+
+  if (!expect("Frames:") || !next_uint(frame_count_) || !expect("Frame") || !expect("Time:") ||
+      !next_float(frame_time_) || !(frame_time_ > 0.0f)) {
+    return false;
+  }
+  // Every value takes at least one character, reject counts the file can't hold before anyone
+  // allocates for them
+  return uint64_t{ frame_count_ } * channel_count_ <= static_cast<uint64_t>(end_ - cursor_);
+}
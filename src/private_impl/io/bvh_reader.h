@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+namespace AnimationViewer::Io {
+class MappedFile;
+
+/// Biovision Hierarchy reader working on a single mapping of the file
+///
+/// The hierarchy is parsed up front, frames are tokenized one at a time on request so they can
+/// be converted without keeping the channel values of the whole motion around.
+class BvhReader
+{
+public:
+  enum class Channel : uint8_t
+  {
+    XPosition,
+    YPosition,
+    ZPosition,
+    XRotation,
+    YRotation,
+    ZRotation,
+  };
+
+  struct Joint
+  {
+    std::string name;
+    /// Always precedes the joint, uint32_t max for roots
+    uint32_t parent;
+    glm::vec3 offset;
+    /// In the order their values appear in a frame
+    std::vector<Channel> channels;
+  };
+
+  /// Returns nullptr if the hierarchy or motion header is malformed
+  static std::unique_ptr<BvhReader> create(const std::filesystem::path& path);
+  /// @contents must outlive the reader
+  static std::unique_ptr<BvhReader> create(std::span<const uint8_t> contents);
+  virtual ~BvhReader();
+
+  /// End sites are not included, they have no channels or name
+  const std::vector<Joint>& joints() const;
+  uint32_t channel_count() const;
+  uint32_t frame_count() const;
+  /// Seconds between frames
+  float frame_time() const;
+
+  /// Parse the next frame into @channels, which must hold channel_count() values
+  bool read_frame(float* channels);
+  /// Fraction of the file consumed so far
+  float progress() const;
+
+protected:
+  /// @file is the mapping backing @contents, if the reader owns it
+  BvhReader(std::unique_ptr<MappedFile>&& file, std::span<const uint8_t> contents);
+
+private:
+  std::string_view next_token();
+  bool next_float(float& value);
+  bool next_uint(uint32_t& value);
+  bool expect(std::string_view token);
+  bool parse_hierarchy();
+
+  const std::unique_ptr<MappedFile> file_;
+  const char* const begin_;
+  const char* cursor_;
+  const char* const end_;
+  std::vector<Joint> joints_;
+  uint32_t channel_count_;
+  uint32_t frame_count_;
+  float frame_time_;
+};
+} // namespace AnimationViewer::Io
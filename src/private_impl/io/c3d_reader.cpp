@@ -0,0 +1,501 @@
+#include "c3d_reader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace AnimationViewer::Io;
+
+namespace {
+constexpr size_t kBlockSize = 512;
+/// Points are read in chunks large enough to keep the disk streaming, while the raw frames
+/// still stay in cache for decoding
+constexpr size_t kReadSize = 4u << 20u;
+constexpr uint8_t kHeaderKey = 0x50;
+
+template<C3dReader::ProcessorType P>
+uint16_t
+read_u16(const uint8_t* data)
+{
+  if constexpr (P == C3dReader::ProcessorType::Mips) {
+    return static_cast<uint16_t>((data[0] << 8u) | data[1]);
+  } else {
+    return static_cast<uint16_t>(data[0] | (data[1] << 8u));
+  }
+}
+
+template<C3dReader::ProcessorType P>
+float
+read_float(const uint8_t* data)
+{
+  uint32_t bits;
+  if constexpr (P == C3dReader::ProcessorType::Mips) {
+    bits = (uint32_t{ data[0] } << 24u) | (uint32_t{ data[1] } << 16u) |
+           (uint32_t{ data[2] } << 8u) | data[3];
+  } else if constexpr (P == C3dReader::ProcessorType::Dec) {
+    // VAX F floats have their 16 bit halves swapped compared to IEEE
+    bits = (uint32_t{ data[1] } << 24u) | (uint32_t{ data[0] } << 16u) |
+           (uint32_t{ data[3] } << 8u) | data[2];
+  } else {
+    bits = (uint32_t{ data[3] } << 24u) | (uint32_t{ data[2] } << 16u) |
+           (uint32_t{ data[1] } << 8u) | data[0];
+  }
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  if constexpr (P == C3dReader::ProcessorType::Dec) {
+    // and an exponent bias which is two higher
+    value *= 0.25f;
+  }
+  return value;
+}
+
+uint16_t
+read_u16(const uint8_t* data, C3dReader::ProcessorType processor)
+{
+  if (processor == C3dReader::ProcessorType::Mips) {
+    return read_u16<C3dReader::ProcessorType::Mips>(data);
+  }
+  return read_u16<C3dReader::ProcessorType::Intel>(data);
+}
+
+float
+read_float(const uint8_t* data, C3dReader::ProcessorType processor)
+{
+  switch (processor) {
+    case C3dReader::ProcessorType::Intel:
+      return read_float<C3dReader::ProcessorType::Intel>(data);
+    case C3dReader::ProcessorType::Dec:
+      return read_float<C3dReader::ProcessorType::Dec>(data);
+    case C3dReader::ProcessorType::Mips:
+      return read_float<C3dReader::ProcessorType::Mips>(data);
+  }
+  return 0.0f;
+}
+
+/// Sample @index of a frame, unscaled
+template<C3dReader::ProcessorType P, bool Float>
+float
+read_sample(const uint8_t* frame, size_t index)
+{
+  if constexpr (Float) {
+    return read_float<P>(frame + index * sizeof(float));
+  } else {
+    return static_cast<int16_t>(read_u16<P>(frame + index * sizeof(int16_t)));
+  }
+}
+
+template<C3dReader::ProcessorType P, bool Float>
+void
+decode_frames(const uint8_t* data,
+              size_t frame_count,
+              uint32_t frame_size,
+              uint32_t point_count,
+              float scale,
+              glm::vec3* points)
+{
+  constexpr float nan = std::numeric_limits<float>::quiet_NaN();
+  for (size_t i = 0; i < frame_count; ++i) {
+    const uint8_t* frame = data + i * frame_size;
+    for (size_t j = 0; j < point_count; ++j) {
+      // The fourth sample packs camera mask and residual, negative marks an invalid point
+      if (read_sample<P, Float>(frame, j * 4 + 3) < 0.0f) {
+        *points++ = glm::vec3(nan);
+        continue;
+      }
+      // Swap y and z to go from z up to y up
+      *points++ = glm::vec3(read_sample<P, Float>(frame, j * 4 + 0) * scale,
+                            read_sample<P, Float>(frame, j * 4 + 2) * scale,
+                            read_sample<P, Float>(frame, j * 4 + 1) * scale);
+    }
+  }
+}
+
+template<C3dReader::ProcessorType P>
+void
+decode_frames(const uint8_t* data,
+              size_t frame_count,
+              uint32_t frame_size,
+              uint32_t point_count,
+              float scale,
+              glm::vec3* points)
+{
+  // Float samples are already in world units
+  if (scale < 0.0f) {
+    decode_frames<P, true>(data, frame_count, frame_size, point_count, 1.0f, points);
+  } else {
+    decode_frames<P, false>(data, frame_count, frame_size, point_count, scale, points);
+  }
+}
+
+/// Group and parameter records of the parameter section, pointing into its buffer
+class ParameterSection
+{
+public:
+  ParameterSection(const std::vector<uint8_t>& section, C3dReader::ProcessorType processor)
+    : processor_(processor)
+  {
+    // Skip the 4 byte section header
+    size_t offset = 4;
+    while (offset + 2 <= section.size()) {
+      auto name_length = static_cast<size_t>(std::abs(static_cast<int8_t>(section[offset])));
+      auto id = static_cast<int8_t>(section[offset + 1]);
+      if (name_length == 0 || id == 0) {
+        break;
+      }
+      auto next_field = offset + 2 + name_length;
+      if (next_field + 2 > section.size()) {
+        break;
+      }
+      std::string name(reinterpret_cast<const char*>(section.data() + offset + 2), name_length);
+      std::transform(name.begin(), name.end(), name.begin(), [](char c) {
+        return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+      });
+
+      if (id < 0) {
+        groups_.push_back({ static_cast<int8_t>(-id), std::move(name) });
+      } else if (!parse_parameter(section, next_field + 2, id, std::move(name))) {
+        break;
+      }
+
+      // Offsets count from the offset field itself, zero marks the last record
+      auto next = read_u16(section.data() + next_field, processor_);
+      if (next == 0) {
+        break;
+      }
+      offset = next_field + next;
+    }
+  }
+
+  std::optional<float> as_float(const char* group, const char* name, size_t index = 0) const
+  {
+    auto parameter = find(group, name);
+    if (parameter == nullptr || index >= parameter->count) {
+      return std::nullopt;
+    }
+    switch (parameter->type) {
+      case 1:
+        return parameter->data[index];
+      case 2:
+        return static_cast<int16_t>(read_u16(parameter->data + index * 2, processor_));
+      case 4:
+        return read_float(parameter->data + index * 4, processor_);
+      default:
+        return std::nullopt;
+    }
+  }
+
+  /// Integer parameters are stored as signed words but used as unsigned counts
+  std::optional<uint32_t> as_uint(const char* group, const char* name, size_t index = 0) const
+  {
+    auto parameter = find(group, name);
+    if (parameter == nullptr || index >= parameter->count) {
+      return std::nullopt;
+    }
+    switch (parameter->type) {
+      case 1:
+        return parameter->data[index];
+      case 2:
+        return read_u16(parameter->data + index * 2, processor_);
+      case 4: {
+        // Some writers store frame counts as floats to get past 65535
+        auto value = read_float(parameter->data + index * 4, processor_);
+        constexpr auto limit = static_cast<float>(std::numeric_limits<uint32_t>::max());
+        if (!(value >= 0.0f) || value >= limit) {
+          return std::nullopt;
+        }
+        return static_cast<uint32_t>(value);
+      }
+      default:
+        return std::nullopt;
+    }
+  }
+
+private:
+  struct Group
+  {
+    int8_t id;
+    std::string name;
+  };
+
+  struct Parameter
+  {
+    int8_t group;
+    std::string name;
+    /// -1 for characters, otherwise the byte size of an element
+    int8_t type;
+    const uint8_t* data;
+    size_t count;
+  };
+
+  bool parse_parameter(const std::vector<uint8_t>& section,
+                       size_t offset,
+                       int8_t group,
+                       std::string&& name)
+  {
+    if (offset + 2 > section.size()) {
+      return false;
+    }
+    auto type = static_cast<int8_t>(section[offset]);
+    auto dimension_count = section[offset + 1];
+    if (type != -1 && type != 1 && type != 2 && type != 4) {
+      return false;
+    }
+    offset += 2;
+    if (offset + dimension_count > section.size()) {
+      return false;
+    }
+    size_t count = 1;
+    for (uint8_t i = 0; i < dimension_count; ++i) {
+      count *= section[offset + i];
+    }
+    offset += dimension_count;
+    if (count * static_cast<size_t>(std::abs(type)) > section.size() - offset) {
+      return false;
+    }
+    parameters_.push_back({ group, std::move(name), type, section.data() + offset, count });
+    return true;
+  }
+
+  const Parameter* find(const char* group_name, const char* name) const
+  {
+    auto group = std::find_if(groups_.begin(), groups_.end(), [group_name](const Group& g) {
+      return g.name == group_name;
+    });
+    if (group == groups_.end()) {
+      return nullptr;
+    }
+    auto parameter = std::find_if(
+      parameters_.begin(), parameters_.end(), [&group, name](const Parameter& p) {
+        return p.group == group->id && p.name == name;
+      });
+    return parameter == parameters_.end() ? nullptr : &*parameter;
+  }
+
+  const C3dReader::ProcessorType processor_;
+  std::vector<Group> groups_;
+  std::vector<Parameter> parameters_;
+};
+} // namespace
+
+std::unique_ptr<C3dReader>
+C3dReader::create(const std::filesystem::path& path)
+{
+  std::error_code error;
+  auto file_size = std::filesystem::file_size(path, error);
+  if (error) {
+    return nullptr;
+  }
+  FILE* file = fopen(path.string().c_str(), "rb");
+  if (file == nullptr) {
+    return nullptr;
+  }
+  // All reads are large enough that stdio buffering would only add a copy
+  setvbuf(file, nullptr, _IONBF, 0);
+  // The data start block is at most 65535 * 512 bytes in, all offsets are in range of fseek
+  auto layout = read_layout(file_size, [file](uint64_t offset, uint8_t* data, size_t size) {
+    if (fseek(file, static_cast<long>(offset), SEEK_SET) != 0) {
+      return size_t{ 0 };
+    }
+    return fread(data, 1, size, file);
+  });
+  if (!layout) {
+    fclose(file);
+    return nullptr;
+  }
+  return std::unique_ptr<C3dReader>(new C3dReader(file, nullptr, *layout));
+}
+
+std::unique_ptr<C3dReader>
+C3dReader::create(std::span<const uint8_t> contents)
+{
+  auto layout =
+    read_layout(contents.size(), [contents](uint64_t offset, uint8_t* data, size_t size) {
+      if (offset >= contents.size()) {
+        return size_t{ 0 };
+      }
+      size = std::min<size_t>(size, contents.size() - offset);
+      std::memcpy(data, contents.data() + offset, size);
+      return size;
+    });
+  if (!layout) {
+    return nullptr;
+  }
+  return std::unique_ptr<C3dReader>(new C3dReader(nullptr, contents.data(), *layout));
+}
+
+std::optional<C3dReader::Layout>
+C3dReader::read_layout(uint64_t file_size, const ReadAt& read_at)
+{
+  uint8_t header[kBlockSize];
+  if (read_at(0, header, sizeof(header)) != sizeof(header) || header[0] == 0 ||
+      header[1] != kHeaderKey) {
+    return std::nullopt;
+  }
+
+  // The parameter section header says how the rest of the file is encoded
+  uint64_t parameter_offset = (header[0] - 1) * kBlockSize;
+  uint8_t parameter_header[4];
+  if (read_at(parameter_offset, parameter_header, sizeof(parameter_header)) !=
+      sizeof(parameter_header)) {
+    return std::nullopt;
+  }
+  auto processor = static_cast<ProcessorType>(parameter_header[3]);
+  if (processor != ProcessorType::Intel && processor != ProcessorType::Dec &&
+      processor != ProcessorType::Mips) {
+    return std::nullopt;
+  }
+  std::vector<uint8_t> section(std::max<size_t>(parameter_header[2], 1) * kBlockSize);
+  // Writers don't always pad the last parameter block
+  section.resize(read_at(parameter_offset, section.data(), section.size()));
+  ParameterSection parameters(section, processor);
+
+  uint32_t point_count = read_u16(header + 2, processor);
+  uint32_t analog_count = read_u16(header + 4, processor);
+  uint32_t first_frame = read_u16(header + 6, processor);
+  uint32_t last_frame = read_u16(header + 8, processor);
+  float header_scale = read_float(header + 12, processor);
+  uint32_t data_start = read_u16(header + 16, processor);
+  float frame_rate = read_float(header + 20, processor);
+
+  if (data_start == 0) {
+    data_start = parameters.as_uint("POINT", "DATA_START").value_or(0);
+  }
+  if (!(frame_rate > 0.0f)) {
+    frame_rate = parameters.as_float("POINT", "RATE").value_or(0.0f);
+  }
+  if (data_start == 0 || !(frame_rate > 0.0f)) {
+    return std::nullopt;
+  }
+
+  // The header only has 16 bits for frame numbers, longer captures put the real range in
+  // TRIAL as two words per field or in POINT:FRAMES
+  uint32_t frame_count = last_frame >= first_frame ? last_frame - first_frame + 1 : 0;
+  auto start_low = parameters.as_uint("TRIAL", "ACTUAL_START_FIELD", 0);
+  auto start_high = parameters.as_uint("TRIAL", "ACTUAL_START_FIELD", 1);
+  auto end_low = parameters.as_uint("TRIAL", "ACTUAL_END_FIELD", 0);
+  auto end_high = parameters.as_uint("TRIAL", "ACTUAL_END_FIELD", 1);
+  if (start_low && start_high && end_low && end_high) {
+    auto start = *start_low | (*start_high << 16u);
+    auto end = *end_low | (*end_high << 16u);
+    if (end >= start) {
+      frame_count = std::max(frame_count, end - start + 1);
+    }
+  } else if (auto frames = parameters.as_uint("POINT", "FRAMES")) {
+    frame_count = std::max(frame_count, *frames);
+  }
+
+  // Floats are flagged by the sign of the header scale, POINT:SCALE is the authoritative value
+  bool float_samples = header_scale < 0.0f;
+  float scale = std::abs(parameters.as_float("POINT", "SCALE").value_or(header_scale));
+  uint64_t sample_size = float_samples ? sizeof(float) : sizeof(int16_t);
+  uint64_t frame_size = (uint64_t{ point_count } * 4 + analog_count) * sample_size;
+  if (frame_size > std::numeric_limits<uint32_t>::max()) {
+    return std::nullopt;
+  }
+
+  // Never trust the frame count further than the file actually goes
+  uint64_t data_offset = (uint64_t{ data_start } - 1) * kBlockSize;
+  uint64_t available = file_size > data_offset ? file_size - data_offset : 0;
+  if (frame_size == 0) {
+    frame_count = 0;
+  } else {
+    frame_count = static_cast<uint32_t>(std::min<uint64_t>(frame_count, available / frame_size));
+  }
+
+  return Layout{
+    processor,
+    point_count,
+    frame_count,
+    frame_rate,
+    float_samples ? -1.0f : scale,
+    data_offset,
+    static_cast<uint32_t>(frame_size),
+  };
+}
+
+C3dReader::C3dReader(FILE* file, const uint8_t* contents, const Layout& layout)
+  : file_(file)
+  , contents_(contents)
+  , processor_(layout.processor)
+  , point_count_(layout.point_count)
+  , frame_count_(layout.frame_count)
+  , frame_rate_(layout.frame_rate)
+  , scale_(layout.scale)
+  , data_offset_(layout.data_offset)
+  , frame_size_(layout.frame_size)
+{}
+
+C3dReader::~C3dReader()
+{
+  if (file_ != nullptr) {
+    fclose(file_);
+  }
+}
+
+uint32_t
+C3dReader::point_count() const
+{
+  return point_count_;
+}
+
+uint32_t
+C3dReader::frame_count() const
+{
+  return frame_count_;
+}
+
+float
+C3dReader::frame_rate() const
+{
+  return frame_rate_;
+}
+
+bool
+C3dReader::read_points(glm::vec3* points, const std::function<void(float)>& progress) const
+{
+  if (frame_count_ == 0) {
+    return true;
+  }
+  if (file_ != nullptr && fseek(file_, static_cast<long>(data_offset_), SEEK_SET) != 0) {
+    return false;
+  }
+
+  // In memory frames are decoded in place, the chunks only pace the progress updates
+  auto frames_per_read = std::max<size_t>(1, kReadSize / frame_size_);
+  std::vector<uint8_t> buffer;
+  if (file_ != nullptr) {
+    buffer.resize(std::min<size_t>(frames_per_read, frame_count_) * frame_size_);
+  }
+  for (uint32_t frame = 0; frame < frame_count_;) {
+    auto count = std::min<size_t>(frames_per_read, frame_count_ - frame);
+    const uint8_t* data;
+    if (file_ != nullptr) {
+      if (fread(buffer.data(), frame_size_, count, file_) != count) {
+        return false;
+      }
+      data = buffer.data();
+    } else {
+      data = contents_ + data_offset_ + uint64_t{ frame } * frame_size_;
+    }
+    auto output = points + size_t{ frame } * point_count_;
+    switch (processor_) {
+      case ProcessorType::Intel:
+        decode_frames<ProcessorType::Intel>(data, count, frame_size_, point_count_, scale_, output);
+        break;
+      case ProcessorType::Dec:
+        decode_frames<ProcessorType::Dec>(data, count, frame_size_, point_count_, scale_, output);
+        break;
+      case ProcessorType::Mips:
+        decode_frames<ProcessorType::Mips>(data, count, frame_size_, point_count_, scale_, output);
+        break;
+    }
+    frame += static_cast<uint32_t>(count);
+    progress(static_cast<float>(frame) / static_cast<float>(frame_count_));
+  }
+  return true;
+}
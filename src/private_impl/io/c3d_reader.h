@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+
+#include <glm/vec3.hpp>
+
+namespace AnimationViewer::Io {
+/// Streaming reader for the 3D point data of C3D files
+///
+/// Only the header and parameter section are parsed up front. Frames are decoded from large
+/// sequential reads, or in place for files already in memory, straight into the caller's buffer.
+/// Analog data is skipped.
+class C3dReader
+{
+public:
+  enum class ProcessorType : uint8_t
+  {
+    /// Little endian integers and IEEE floats
+    Intel = 84,
+    /// Little endian integers and VAX F floats
+    Dec = 85,
+    /// Big endian integers and IEEE floats
+    Mips = 86,
+  };
+
+  /// Returns nullptr if the file is not a C3D file or its header and parameters don't agree
+  static std::unique_ptr<C3dReader> create(const std::filesystem::path& path);
+  /// @contents must outlive the reader
+  static std::unique_ptr<C3dReader> create(std::span<const uint8_t> contents);
+  virtual ~C3dReader();
+
+  uint32_t point_count() const;
+  uint32_t frame_count() const;
+  float frame_rate() const;
+
+  /// Decode every frame into @points, which must hold frame_count() * point_count() entries
+  ///
+  /// Points are converted to y up on the way and points flagged invalid are NaN.
+  /// @progress is called with the fraction of frames decoded after each read.
+  bool read_points(glm::vec3* points, const std::function<void(float)>& progress) const;
+
+protected:
+  /// Where and how the points are stored, from the header and parameter section
+  struct Layout
+  {
+    ProcessorType processor;
+    uint32_t point_count;
+    uint32_t frame_count;
+    float frame_rate;
+    float scale;
+    uint64_t data_offset;
+    uint32_t frame_size;
+  };
+  /// Copy up to @size bytes at @offset into @data and return how many were copied
+  using ReadAt = std::function<size_t(uint64_t offset, uint8_t* data, size_t size)>;
+
+  static std::optional<Layout> read_layout(uint64_t file_size, const ReadAt& read_at);
+
+  /// Exactly one of @file and @contents is set
+  C3dReader(FILE* file, const uint8_t* contents, const Layout& layout);
+
+private:
+  FILE* const file_;
+  const uint8_t* const contents_;
+  const ProcessorType processor_;
+  const uint32_t point_count_;
+  const uint32_t frame_count_;
+  const float frame_rate_;
+  /// Negative when samples are stored as floats, otherwise the factor for integer samples
+  const float scale_;
+  const uint64_t data_offset_;
+  /// Bytes per frame, including the analog samples that are skipped
+  const uint32_t frame_size_;
+};
+} // namespace AnimationViewer::Io
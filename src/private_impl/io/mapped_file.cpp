@@ -0,0 +1,94 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace AnimationViewer::Io;
+
+std::unique_ptr<MappedFile>
+MappedFile::create(const std::filesystem::path& path)
+{
+#ifdef _WIN32
+  HANDLE file = CreateFileW(path.c_str(),
+                            GENERIC_READ,
+                            FILE_SHARE_READ,
+                            nullptr,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return nullptr;
+  }
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+    CloseHandle(file);
+    return nullptr;
+  }
+  HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    return nullptr;
+  }
+  // The view keeps the mapping alive
+  auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (view == nullptr) {
+    return nullptr;
+  }
+  return std::unique_ptr<MappedFile>(new MappedFile(static_cast<const uint8_t*>(view),
+                                                    static_cast<size_t>(file_size.QuadPart)));
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+    close(fd);
+    return nullptr;
+  }
+  auto size = static_cast<size_t>(file_stat.st_size);
+  auto view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (view == MAP_FAILED) {
+    return nullptr;
+  }
+  // All users read front to back
+  madvise(view, size, MADV_SEQUENTIAL);
+  return std::unique_ptr<MappedFile>(new MappedFile(static_cast<const uint8_t*>(view), size));
+#endif
+}
+
+MappedFile::MappedFile(const uint8_t* data, size_t size)
+  : data_(data)
+  , size_(size)
+{}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+  UnmapViewOfFile(data_);
+#else
+  munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+}
+
+const uint8_t*
+MappedFile::data() const
+{
+  return data_;
+}
+
+size_t
+MappedFile::size() const
+{
+  return size_;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+namespace AnimationViewer::Io {
+/// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+  /// Returns nullptr if the file can't be opened or mapped, or if it is empty
+  static std::unique_ptr<MappedFile> create(const std::filesystem::path& path);
+  virtual ~MappedFile();
+
+  const uint8_t* data() const;
+  size_t size() const;
+
+protected:
+  MappedFile(const uint8_t* data, size_t size);
+
+private:
+  const uint8_t* const data_;
+  const size_t size_;
+};
+} // namespace AnimationViewer::Io
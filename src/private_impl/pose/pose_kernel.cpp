@@ -0,0 +1,633 @@
+#include "pose_kernel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <glm/geometric.hpp>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+using namespace AnimationViewer;
+using namespace AnimationViewer::Pose;
+
+namespace {
+// The kernels address glm types as floats: vectors are their components, quaternions are x, y, z,
+// w and matrices are column major
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float));
+static_assert(sizeof(glm::quat) == 4 * sizeof(float));
+static_assert(sizeof(glm::mat4) == 16 * sizeof(float));
+
+// One value per joint of a batch
+#if defined(__AVX2__)
+constexpr size_t kLanes = 8;
+struct Lanes
+{
+  __m256 v;
+};
+Lanes
+splat(float value)
+{
+  return { _mm256_set1_ps(value) };
+}
+Lanes
+load(const float* values)
+{
+  return { _mm256_loadu_ps(values) };
+}
+void
+store(float* values, Lanes a)
+{
+  _mm256_storeu_ps(values, a.v);
+}
+/// Every stride-th value from @values
+Lanes
+gather(const float* values, int stride)
+{
+  auto indices =
+    _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+  return { _mm256_i32gather_ps(values, indices, sizeof(float)) };
+}
+Lanes
+operator+(Lanes a, Lanes b)
+{
+  return { _mm256_add_ps(a.v, b.v) };
+}
+Lanes
+operator-(Lanes a, Lanes b)
+{
+  return { _mm256_sub_ps(a.v, b.v) };
+}
+Lanes
+operator*(Lanes a, Lanes b)
+{
+  return { _mm256_mul_ps(a.v, b.v) };
+}
+Lanes
+operator/(Lanes a, Lanes b)
+{
+  return { _mm256_div_ps(a.v, b.v) };
+}
+Lanes
+square_root(Lanes a)
+{
+  return { _mm256_sqrt_ps(a.v) };
+}
+/// 1 where @a is positive, -1 where it is negative
+Lanes
+sign(Lanes a)
+{
+  return { _mm256_or_ps(_mm256_and_ps(a.v, _mm256_set1_ps(-0.0f)), _mm256_set1_ps(1.0f)) };
+}
+#elif defined(__SSE2__) || defined(_M_X64)
+constexpr size_t kLanes = 4;
+struct Lanes
+{
+  __m128 v;
+};
+Lanes
+splat(float value)
+{
+  return { _mm_set1_ps(value) };
+}
+Lanes
+load(const float* values)
+{
+  return { _mm_loadu_ps(values) };
+}
+void
+store(float* values, Lanes a)
+{
+  _mm_storeu_ps(values, a.v);
+}
+/// Every stride-th value from @values
+Lanes
+gather(const float* values, int stride)
+{
+  return { _mm_setr_ps(values[0], values[stride], values[2 * stride], values[3 * stride]) };
+}
+Lanes
+operator+(Lanes a, Lanes b)
+{
+  return { _mm_add_ps(a.v, b.v) };
+}
+Lanes
+operator-(Lanes a, Lanes b)
+{
+  return { _mm_sub_ps(a.v, b.v) };
+}
+Lanes
+operator*(Lanes a, Lanes b)
+{
+  return { _mm_mul_ps(a.v, b.v) };
+}
+Lanes
+operator/(Lanes a, Lanes b)
+{
+  return { _mm_div_ps(a.v, b.v) };
+}
+Lanes
+square_root(Lanes a)
+{
+  return { _mm_sqrt_ps(a.v) };
+}
+/// 1 where @a is positive, -1 where it is negative
+Lanes
+sign(Lanes a)
+{
+  return { _mm_or_ps(_mm_and_ps(a.v, _mm_set1_ps(-0.0f)), _mm_set1_ps(1.0f)) };
+}
+#elif defined(__wasm_simd128__)
+constexpr size_t kLanes = 4;
+struct Lanes
+{
+  v128_t v;
+};
+Lanes
+splat(float value)
+{
+  return { wasm_f32x4_splat(value) };
+}
+Lanes
+load(const float* values)
+{
+  return { wasm_v128_load(values) };
+}
+void
+store(float* values, Lanes a)
+{
+  wasm_v128_store(values, a.v);
+}
+/// Every stride-th value from @values
+Lanes
+gather(const float* values, int stride)
+{
+  return { wasm_f32x4_make(values[0], values[stride], values[2 * stride], values[3 * stride]) };
+}
+Lanes
+operator+(Lanes a, Lanes b)
+{
+  return { wasm_f32x4_add(a.v, b.v) };
+}
+Lanes
+operator-(Lanes a, Lanes b)
+{
+  return { wasm_f32x4_sub(a.v, b.v) };
+}
+Lanes
+operator*(Lanes a, Lanes b)
+{
+  return { wasm_f32x4_mul(a.v, b.v) };
+}
+Lanes
+operator/(Lanes a, Lanes b)
+{
+  return { wasm_f32x4_div(a.v, b.v) };
+}
+Lanes
+square_root(Lanes a)
+{
+  return { wasm_f32x4_sqrt(a.v) };
+}
+/// 1 where @a is positive, -1 where it is negative
+Lanes
+sign(Lanes a)
+{
+  return { wasm_v128_or(wasm_v128_and(a.v, wasm_f32x4_splat(-0.0f)), wasm_f32x4_splat(1.0f)) };
+}
+#else
+constexpr size_t kLanes = 1;
+struct Lanes
+{
+  float v;
+};
+Lanes
+splat(float value)
+{
+  return { value };
+}
+Lanes
+load(const float* values)
+{
+  return { *values };
+}
+void
+store(float* values, Lanes a)
+{
+  *values = a.v;
+}
+/// Every stride-th value from @values
+Lanes
+gather(const float* values, int)
+{
+  return { *values };
+}
+Lanes
+operator+(Lanes a, Lanes b)
+{
+  return { a.v + b.v };
+}
+Lanes
+operator-(Lanes a, Lanes b)
+{
+  return { a.v - b.v };
+}
+Lanes
+operator*(Lanes a, Lanes b)
+{
+  return { a.v * b.v };
+}
+Lanes
+operator/(Lanes a, Lanes b)
+{
+  return { a.v / b.v };
+}
+Lanes
+square_root(Lanes a)
+{
+  return { std::sqrt(a.v) };
+}
+/// 1 where @a is positive, -1 where it is negative
+Lanes
+sign(Lanes a)
+{
+  return { std::copysign(1.0f, a.v) };
+}
+#endif
+
+/// Write every lane to @values with @stride floats between them
+void
+scatter(float* values, size_t stride, Lanes a)
+{
+  float lanes[kLanes];
+  store(lanes, a);
+  for (size_t i = 0; i < kLanes; ++i) {
+    values[i * stride] = lanes[i];
+  }
+}
+
+void
+lerp(const float* a, const float* b, float factor, float* result, size_t count)
+{
+  auto lanes_factor = splat(factor);
+  size_t i = 0;
+  for (; i + kLanes <= count; i += kLanes) {
+    auto from = load(a + i);
+    store(result + i, from + (load(b + i) - from) * lanes_factor);
+  }
+  for (; i < count; ++i) {
+    result[i] = a[i] + (b[i] - a[i]) * factor;
+  }
+}
+
+/// @a * @b into @result, which may be @b
+void
+multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& result)
+{
+  // A column of the result is the columns of a weighted by a column of b, which is read before
+  // the column is written
+  const auto* lhs = reinterpret_cast<const float*>(&a);
+  const auto* rhs = reinterpret_cast<const float*>(&b);
+  auto* out = reinterpret_cast<float*>(&result);
+#if defined(__SSE2__) || defined(_M_X64)
+  auto c0 = _mm_loadu_ps(lhs);
+  auto c1 = _mm_loadu_ps(lhs + 4);
+  auto c2 = _mm_loadu_ps(lhs + 8);
+  auto c3 = _mm_loadu_ps(lhs + 12);
+  for (size_t column = 0; column < 16; column += 4) {
+    auto sum = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(rhs[column])),
+                          _mm_mul_ps(c1, _mm_set1_ps(rhs[column + 1])));
+    sum = _mm_add_ps(sum, _mm_mul_ps(c2, _mm_set1_ps(rhs[column + 2])));
+    sum = _mm_add_ps(sum, _mm_mul_ps(c3, _mm_set1_ps(rhs[column + 3])));
+    _mm_storeu_ps(out + column, sum);
+  }
+#elif defined(__wasm_simd128__)
+  auto c0 = wasm_v128_load(lhs);
+  auto c1 = wasm_v128_load(lhs + 4);
+  auto c2 = wasm_v128_load(lhs + 8);
+  auto c3 = wasm_v128_load(lhs + 12);
+  for (size_t column = 0; column < 16; column += 4) {
+    auto sum = wasm_f32x4_add(wasm_f32x4_mul(c0, wasm_f32x4_splat(rhs[column])),
+                              wasm_f32x4_mul(c1, wasm_f32x4_splat(rhs[column + 1])));
+    sum = wasm_f32x4_add(sum, wasm_f32x4_mul(c2, wasm_f32x4_splat(rhs[column + 2])));
+    sum = wasm_f32x4_add(sum, wasm_f32x4_mul(c3, wasm_f32x4_splat(rhs[column + 3])));
+    wasm_v128_store(out + column, sum);
+  }
+#else
+  for (size_t column = 0; column < 16; column += 4) {
+    float sum[4];
+    for (size_t row = 0; row < 4; ++row) {
+      sum[row] = lhs[row] * rhs[column] + lhs[4 + row] * rhs[column + 1] +
+                 lhs[8 + row] * rhs[column + 2] + lhs[12 + row] * rhs[column + 3];
+    }
+    for (size_t row = 0; row < 4; ++row) {
+      out[column + row] = sum[row];
+    }
+  }
+#endif
+}
+
+glm::quat
+nlerp(const glm::quat& a, glm::quat b, float factor)
+{
+  // Along the shorter arc
+  if (glm::dot(a, b) < 0.0f) {
+    b = -b;
+  }
+  return glm::normalize(a + (b - a) * factor);
+}
+
+glm::mat4
+compose_one(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+  glm::mat4 result = glm::mat4_cast(rotation);
+  result[0] *= scale.x;
+  result[1] *= scale.y;
+  result[2] *= scale.z;
+  result[3] = glm::vec4(translation, 1.0f);
+  return result;
+}
+} // namespace
+
+size_t
+Pose::batch_size()
+{
+  return kLanes;
+}
+
+void
+Pose::interpolate(const TransformSpans& a,
+                  const TransformSpans& b,
+                  float factor,
+                  std::span<glm::vec3> translations,
+                  std::span<glm::quat> rotations,
+                  std::span<glm::vec3> scales)
+{
+  auto count = translations.size();
+  assert(a.translations.size() >= count && b.translations.size() >= count);
+  lerp(reinterpret_cast<const float*>(a.translations.data()),
+       reinterpret_cast<const float*>(b.translations.data()),
+       factor,
+       reinterpret_cast<float*>(translations.data()),
+       count * 3);
+  lerp(reinterpret_cast<const float*>(a.scales.data()),
+       reinterpret_cast<const float*>(b.scales.data()),
+       factor,
+       reinterpret_cast<float*>(scales.data()),
+       count * 3);
+
+  auto lanes_factor = splat(factor);
+  const auto* from = reinterpret_cast<const float*>(a.rotations.data());
+  const auto* to = reinterpret_cast<const float*>(b.rotations.data());
+  auto* out = reinterpret_cast<float*>(rotations.data());
+  size_t joint = 0;
+  for (; joint + kLanes <= count; joint += kLanes) {
+    const auto* q0 = from + joint * 4;
+    const auto* q1 = to + joint * 4;
+    auto x0 = gather(q0, 4);
+    auto y0 = gather(q0 + 1, 4);
+    auto z0 = gather(q0 + 2, 4);
+    auto w0 = gather(q0 + 3, 4);
+    auto x1 = gather(q1, 4);
+    auto y1 = gather(q1 + 1, 4);
+    auto z1 = gather(q1 + 2, 4);
+    auto w1 = gather(q1 + 3, 4);
+    // Along the shorter arc
+    auto flip = sign(x0 * x1 + y0 * y1 + z0 * z1 + w0 * w1);
+    auto x = x0 + (x1 * flip - x0) * lanes_factor;
+    auto y = y0 + (y1 * flip - y0) * lanes_factor;
+    auto z = z0 + (z1 * flip - z0) * lanes_factor;
+    auto w = w0 + (w1 * flip - w0) * lanes_factor;
+    auto inverse_length = splat(1.0f) / square_root(x * x + y * y + z * z + w * w);
+    auto* q = out + joint * 4;
+    scatter(q, 4, x * inverse_length);
+    scatter(q + 1, 4, y * inverse_length);
+    scatter(q + 2, 4, z * inverse_length);
+    scatter(q + 3, 4, w * inverse_length);
+  }
+  for (; joint < count; ++joint) {
+    rotations[joint] = nlerp(a.rotations[joint], b.rotations[joint], factor);
+  }
+}
+
+void
+Pose::compose(const TransformSpans& transforms, std::span<glm::mat4> matrices)
+{
+  auto count = matrices.size();
+  assert(transforms.translations.size() >= count && transforms.rotations.size() >= count &&
+         transforms.scales.size() >= count);
+  const auto* translations = reinterpret_cast<const float*>(transforms.translations.data());
+  const auto* rotations = reinterpret_cast<const float*>(transforms.rotations.data());
+  const auto* scales = reinterpret_cast<const float*>(transforms.scales.data());
+  auto one = splat(1.0f);
+  auto two = splat(2.0f);
+  auto zero = splat(0.0f);
+  size_t joint = 0;
+  for (; joint + kLanes <= count; joint += kLanes) {
+    const auto* r = rotations + joint * 4;
+    auto x = gather(r, 4);
+    auto y = gather(r + 1, 4);
+    auto z = gather(r + 2, 4);
+    auto w = gather(r + 3, 4);
+    const auto* s = scales + joint * 3;
+    auto sx = gather(s, 3);
+    auto sy = gather(s + 1, 3);
+    auto sz = gather(s + 2, 3);
+    const auto* t = translations + joint * 3;
+
+    auto xx = x * x;
+    auto yy = y * y;
+    auto zz = z * z;
+    auto xy = x * y;
+    auto xz = x * z;
+    auto yz = y * z;
+    auto wx = w * x;
+    auto wy = w * y;
+    auto wz = w * z;
+    auto* m = reinterpret_cast<float*>(matrices.data() + joint);
+    scatter(m, 16, (one - two * (yy + zz)) * sx);
+    scatter(m + 1, 16, two * (xy + wz) * sx);
+    scatter(m + 2, 16, two * (xz - wy) * sx);
+    scatter(m + 3, 16, zero);
+    scatter(m + 4, 16, two * (xy - wz) * sy);
+    scatter(m + 5, 16, (one - two * (xx + zz)) * sy);
+    scatter(m + 6, 16, two * (yz + wx) * sy);
+    scatter(m + 7, 16, zero);
+    scatter(m + 8, 16, two * (xz + wy) * sz);
+    scatter(m + 9, 16, two * (yz - wx) * sz);
+    scatter(m + 10, 16, (one - two * (xx + yy)) * sz);
+    scatter(m + 11, 16, zero);
+    scatter(m + 12, 16, gather(t, 3));
+    scatter(m + 13, 16, gather(t + 1, 3));
+    scatter(m + 14, 16, gather(t + 2, 3));
+    scatter(m + 15, 16, one);
+  }
+  for (; joint < count; ++joint) {
+    matrices[joint] = compose_one(
+      transforms.translations[joint], transforms.rotations[joint], transforms.scales[joint]);
+  }
+}
+
+void
+Pose::local_to_global(std::span<const uint32_t> order,
+                      std::span<const uint32_t> parents,
+                      std::span<const glm::mat4> locals,
+                      std::span<glm::mat4> globals)
+{
+  // Every bone depends on its parent, so bones go one after another with each product vectorized
+  for (auto bone : order) {
+    auto parent = parents[bone];
+    if (parent == kNoParent) {
+      globals[bone] = locals[bone];
+    } else {
+      multiply(globals[parent], locals[bone], globals[bone]);
+    }
+  }
+}
+
+void
+Pose::blend(std::span<const glm::mat4> a,
+            std::span<const glm::mat4> b,
+            float factor,
+            std::span<glm::mat4> result)
+{
+  assert(a.size() >= result.size() && b.size() >= result.size());
+  lerp(reinterpret_cast<const float*>(a.data()),
+       reinterpret_cast<const float*>(b.data()),
+       factor,
+       reinterpret_cast<float*>(result.data()),
+       result.size() * 16);
+}
+
+void
+Pose::Reference::interpolate(const TransformSpans& a,
+                             const TransformSpans& b,
+                             float factor,
+                             std::span<glm::vec3> translations,
+                             std::span<glm::quat> rotations,
+                             std::span<glm::vec3> scales)
+{
+  for (size_t joint = 0; joint < translations.size(); ++joint) {
+    translations[joint] = glm::mix(a.translations[joint], b.translations[joint], factor);
+    rotations[joint] = nlerp(a.rotations[joint], b.rotations[joint], factor);
+    scales[joint] = glm::mix(a.scales[joint], b.scales[joint], factor);
+  }
+}
+
+void
+Pose::Reference::compose(const TransformSpans& transforms, std::span<glm::mat4> matrices)
+{
+  for (size_t joint = 0; joint < matrices.size(); ++joint) {
+    matrices[joint] = compose_one(
+      transforms.translations[joint], transforms.rotations[joint], transforms.scales[joint]);
+  }
+}
+
+void
+Pose::Reference::local_to_global(std::span<const uint32_t> order,
+                                 std::span<const uint32_t> parents,
+                                 std::span<const glm::mat4> locals,
+                                 std::span<glm::mat4> globals)
+{
+  for (auto bone : order) {
+    auto parent = parents[bone];
+    globals[bone] = parent == kNoParent ? locals[bone] : globals[parent] * locals[bone];
+  }
+}
+
+void
+Pose::Reference::blend(std::span<const glm::mat4> a,
+                       std::span<const glm::mat4> b,
+                       float factor,
+                       std::span<glm::mat4> result)
+{
+  for (size_t i = 0; i < result.size(); ++i) {
+    result[i] = a[i] + (b[i] - a[i]) * factor;
+  }
+}
+
+bool
+Pose::matches_reference()
+{
+  // Matrices are composed, concatenated and blended from values around 1, in a different order
+  constexpr float kTolerance = 1e-5f;
+  std::mt19937 engine(20);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  auto random_vec3 = [&]() { return glm::vec3(unit(engine), unit(engine), unit(engine)); };
+  auto matches = [](std::span<const float> a, std::span<const float> b) {
+    for (size_t i = 0; i < a.size(); ++i) {
+      if (std::abs(a[i] - b[i]) > kTolerance * std::max(1.0f, std::abs(b[i]))) {
+        return false;
+      }
+    }
+    return true;
+  };
+  auto floats = [](auto& values) {
+    return std::span<const float>(reinterpret_cast<const float*>(values.data()),
+                                  values.size() * sizeof(values[0]) / sizeof(float));
+  };
+
+  for (size_t count = 1; count <= 2 * batch_size() + 3; ++count) {
+    std::vector<glm::vec3> translations[2], scales[2];
+    std::vector<glm::quat> rotations[2];
+    for (size_t pose = 0; pose < 2; ++pose) {
+      for (size_t joint = 0; joint < count; ++joint) {
+        translations[pose].push_back(random_vec3());
+        rotations[pose].push_back(
+          glm::normalize(glm::quat(unit(engine), unit(engine), unit(engine), unit(engine))));
+        scales[pose].push_back(glm::vec3(1.0f) + 0.5f * random_vec3());
+      }
+    }
+    TransformSpans a{ translations[0], rotations[0], scales[0] };
+    TransformSpans b{ translations[1], rotations[1], scales[1] };
+    auto factor = 0.5f + 0.5f * unit(engine);
+
+    std::vector<glm::vec3> mixed_translations(count), expected_translations(count);
+    std::vector<glm::quat> mixed_rotations(count), expected_rotations(count);
+    std::vector<glm::vec3> mixed_scales(count), expected_scales(count);
+    interpolate(a, b, factor, mixed_translations, mixed_rotations, mixed_scales);
+    Reference::interpolate(
+      a, b, factor, expected_translations, expected_rotations, expected_scales);
+    if (!matches(floats(mixed_translations), floats(expected_translations)) ||
+        !matches(floats(mixed_rotations), floats(expected_rotations)) ||
+        !matches(floats(mixed_scales), floats(expected_scales))) {
+      return false;
+    }
+
+    std::vector<glm::mat4> locals(count), expected_locals(count);
+    compose(a, locals);
+    Reference::compose(a, expected_locals);
+    if (!matches(floats(locals), floats(expected_locals))) {
+      return false;
+    }
+
+    // Every parent comes before its children
+    std::vector<uint32_t> order(count), parents(count);
+    for (uint32_t bone = 0; bone < count; ++bone) {
+      order[bone] = bone;
+      parents[bone] = bone == 0 ? kNoParent : static_cast<uint32_t>(engine() % bone);
+    }
+    std::vector<glm::mat4> globals(count), expected_globals(count);
+    local_to_global(order, parents, expected_locals, globals);
+    Reference::local_to_global(order, parents, expected_locals, expected_globals);
+    if (!matches(floats(globals), floats(expected_globals))) {
+      return false;
+    }
+
+    std::vector<glm::mat4> blended(count), expected_blended(count);
+    blend(expected_locals, expected_globals, factor, blended);
+    Reference::blend(expected_locals, expected_globals, factor, expected_blended);
+    if (!matches(floats(blended), floats(expected_blended))) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+namespace AnimationViewer::Pose {
+/// Parent of a root in local_to_global
+constexpr uint32_t kNoParent = std::numeric_limits<uint32_t>::max();
+
+/// Translation, rotation and scale of a set of joints, one value of each per joint
+struct TransformSpans
+{
+  std::span<const glm::vec3> translations;
+  std::span<const glm::quat> rotations;
+  std::span<const glm::vec3> scales;
+};
+
+/// Joints the vectorized kernels process at once: 8 with AVX2, 4 with SSE or wasm SIMD, else 1
+size_t
+batch_size();
+
+/// Lerp translations and scales and nlerp rotations by @factor from @a to @b
+///
+/// Every span holds the same number of joints, the outputs may alias @a.
+void
+interpolate(const TransformSpans& a,
+            const TransformSpans& b,
+            float factor,
+            std::span<glm::vec3> translations,
+            std::span<glm::quat> rotations,
+            std::span<glm::vec3> scales);
+/// Translation * rotation * scale matrix of every joint
+void
+compose(const TransformSpans& transforms, std::span<glm::mat4> matrices);
+/// Global matrix of every bone from the one relative to its parent
+///
+/// @order lists the bones with every parent before its children, @parents holds the parent of
+/// every bone or kNoParent. Bones missing from @order are left as they are. @globals may be
+/// @locals.
+void
+local_to_global(std::span<const uint32_t> order,
+                std::span<const uint32_t> parents,
+                std::span<const glm::mat4> locals,
+                std::span<glm::mat4> globals);
+/// Component wise lerp by @factor of two sets of matrices
+void
+blend(std::span<const glm::mat4> a,
+      std::span<const glm::mat4> b,
+      float factor,
+      std::span<glm::mat4> result);
+
+/// Run every kernel and its Reference version on random poses, with joint counts around multiples
+/// of the batch size so that the tails are covered, and compare the results. Meant for tests.
+bool
+matches_reference();
+
+/// Scalar versions of the kernels, one joint at a time, to check the vectorized ones against
+namespace Reference {
+void
+interpolate(const TransformSpans& a,
+            const TransformSpans& b,
+            float factor,
+            std::span<glm::vec3> translations,
+            std::span<glm::quat> rotations,
+            std::span<glm::vec3> scales);
+void
+compose(const TransformSpans& transforms, std::span<glm::mat4> matrices);
+void
+local_to_global(std::span<const uint32_t> order,
+                std::span<const uint32_t> parents,
+                std::span<const glm::mat4> locals,
+                std::span<glm::mat4> globals);
+void
+blend(std::span<const glm::mat4> a,
+      std::span<const glm::mat4> b,
+      float factor,
+      std::span<glm::mat4> result);
+} // namespace Reference
+} // namespace AnimationViewer::Pose
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace AnimationViewer::Threading {
+/// Unbounded lock-free queue with any number of producers and a single consumer
+///
+/// Intrusive linked list after Dmitry Vyukov's MPSC queue: producers only exchange the head,
+/// the consumer owns the tail and is the only one freeing nodes.
+template<typename T>
+class MpscQueue
+{
+  struct Node
+  {
+    std::atomic<Node*> next{ nullptr };
+    std::optional<T> value;
+  };
+
+public:
+  MpscQueue()
+    : head_(new Node)
+    , tail_(head_.load(std::memory_order_relaxed))
+  {}
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  ~MpscQueue()
+  {
+    while (pop().has_value()) {
+    }
+    delete tail_;
+  }
+
+  /// Safe to call from any thread
+  void push(T&& value)
+  {
+    auto node = new Node;
+    node->value.emplace(std::move(value));
+    auto previous = head_.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+  }
+
+  /// Only call from the consumer thread
+  ///
+  /// A producer which exchanged the head but has not linked its node yet is seen as empty,
+  /// the value becomes visible on a later pop.
+  std::optional<T> pop()
+  {
+    auto tail = tail_;
+    auto next = tail->next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      return std::nullopt;
+    }
+    std::optional<T> result = std::move(next->value);
+    next->value.reset();
+    tail_ = next;
+    delete tail;
+    return result;
+  }
+
+private:
+  std::atomic<Node*> head_;
+  Node* tail_;
+};
+} // namespace AnimationViewer::Threading
@@ -0,0 +1,120 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace AnimationViewer::Threading;
+
+std::unique_ptr<ThreadPool>
+ThreadPool::create(uint32_t thread_count)
+{
+  if (thread_count == 0) {
+    // Leave one hardware thread to the main loop
+    thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+  }
+#ifdef __EMSCRIPTEN__
+  // Threads past the preallocated pthread pool need a new web worker, which is only loaded once
+  // the main thread yields to the browser
+  thread_count = std::min<uint32_t>(thread_count, PTHREAD_POOL_SIZE);
+#endif
+  return std::unique_ptr<ThreadPool>(new ThreadPool(thread_count));
+}
+
+ThreadPool::ThreadPool(uint32_t thread_count)
+  : stopping_(false)
+{
+  workers_.reserve(thread_count);
+  for (uint32_t i = 0; i < thread_count; ++i) {
+    workers_.emplace_back(&ThreadPool::worker_main, this);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  job_available_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void
+ThreadPool::submit(Job&& job)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.emplace_back(std::move(job));
+  }
+  job_available_.notify_one();
+}
+
+uint32_t
+ThreadPool::size() const
+{
+  return static_cast<uint32_t>(workers_.size());
+}
+
+void
+ThreadPool::parallel_for(uint32_t count, const std::function<void(uint32_t)>& body)
+{
+  if (count == 0) {
+    return;
+  }
+  // Shared with the helper jobs, which can start after the call has returned
+  struct Batch
+  {
+    const std::function<void(uint32_t)>* body;
+    uint32_t count;
+    std::atomic<uint32_t> next;
+    std::atomic<uint32_t> finished;
+    std::mutex mutex;
+    std::condition_variable done;
+  };
+  auto batch = std::make_shared<Batch>();
+  batch->body = &body;
+  batch->count = count;
+  batch->next = 0;
+  batch->finished = 0;
+
+  // Indices are claimed one at a time, body is only touched for claimed ones which the caller
+  // waits for
+  auto work = [](Batch& state) {
+    for (uint32_t i = state.next++; i < state.count; i = state.next++) {
+      (*state.body)(i);
+      if (++state.finished == state.count) {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.done.notify_all();
+      }
+    }
+  };
+  auto helpers = std::min(count, size() + 1) - 1;
+  for (uint32_t i = 0; i < helpers; ++i) {
+    submit([batch, work]() { work(*batch); });
+  }
+  work(*batch);
+
+  std::unique_lock<std::mutex> lock(batch->mutex);
+  batch->done.wait(lock, [&batch] { return batch->finished == batch->count; });
+}
+
+void
+ThreadPool::worker_main()
+{
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      job_available_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+      // Jobs still queued on shutdown are dropped, only running ones are waited on
+      if (stopping_) {
+        return;
+      }
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+    job();
+  }
+}
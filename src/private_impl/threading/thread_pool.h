@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace AnimationViewer::Threading {
+/// Fixed set of worker threads consuming jobs in submission order
+class ThreadPool
+{
+public:
+  using Job = std::function<void()>;
+
+  /// Creates a pool of @thread_count workers, zero picks one less than the hardware threads.
+  /// On the web the pool is capped at PTHREAD_POOL_SIZE.
+  static std::unique_ptr<ThreadPool> create(uint32_t thread_count = 0);
+  virtual ~ThreadPool();
+
+  void submit(Job&& job);
+  uint32_t size() const;
+
+  /// Call @body for every index below @count, spread over the workers, and wait for all of them
+  ///
+  /// The calling thread works on the indices as well, so this can be used from inside a job
+  /// without waiting on workers which are all busy. @body must be safe to call concurrently.
+  void parallel_for(uint32_t count, const std::function<void(uint32_t)>& body);
+
+protected:
+  explicit ThreadPool(uint32_t thread_count);
+
+private:
+  void worker_main();
+
+  std::mutex mutex_;
+  std::condition_variable job_available_;
+  std::deque<Job> jobs_;
+  bool stopping_;
+  std::vector<std::thread> workers_;
+};
+} // namespace AnimationViewer::Threading
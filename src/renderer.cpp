@@ -1,10 +1,19 @@
 #include "renderer.h"
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <span>
 #include <string_view>
+#include <unordered_map>
+#include <tuple>
 
 #include <SDL_video.h>
 #include <glad/glad.h>
+#include <glm/common.hpp>
 #include <glm/ext/matrix_common.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/transform.hpp>
@@ -23,14 +32,21 @@
 #include "private_impl/graphics/buffer.h"
 #include "private_impl/graphics/framebuffer.h"
 #include "private_impl/graphics/indexed_mesh.h"
+#include "private_impl/graphics/instance_buffer.h"
+#include "private_impl/graphics/ring_buffer.h"
 #include "private_impl/graphics/scoped_debug_group.h"
 #include "private_impl/graphics/texture.h"
+#include "private_impl/pose/pose_kernel.h"
 
 #include "private_impl/graphics/shaders/bridging_header.h"
 
+#include "private_impl/graphics/shaders/bone_line_frag_glsl.h"
+#include "private_impl/graphics/shaders/bone_line_vert_glsl.h"
 #include "private_impl/graphics/shaders/disk_vert_glsl.h"
 #include "private_impl/graphics/shaders/full_screen_vert_glsl.h"
 #include "private_impl/graphics/shaders/mesh_frag_glsl.h"
+#include "private_impl/graphics/shaders/mesh_packed_vert_glsl.h"
+#include "private_impl/graphics/shaders/mocap_point_vert_glsl.h"
 #include "private_impl/graphics/shaders/mesh_vert_glsl.h"
 #include "private_impl/graphics/shaders/rayleigh_sky_frag_glsl.h"
 #include "private_impl/graphics/shaders/wireframe_frag_glsl.h"
@@ -39,6 +55,14 @@ using namespace AnimationViewer;
 using namespace AnimationViewer::Graphics;
 
 namespace {
+/// Uniform bytes per frame the ring buffer starts out with, enough for a few hundred meshes
+constexpr uint32_t kUniformFrameSize = 1u << 20u;
+/// Texels per row of the bone palette texture and the rows it starts out with
+constexpr uint32_t kBonePaletteWidth = 1024;
+constexpr uint32_t kBonePaletteRows = 64;
+/// Largest buffer the points of a motion capture are uploaded in, longer captures are split
+constexpr uint32_t kMotionCaptureChunkSize = 1u << 26u;
+
 void GLAPIENTRY
 MessageCallback([[maybe_unused]] GLenum source,
                 GLenum type,
@@ -79,6 +103,173 @@ MessageCallback([[maybe_unused]] GLenum source,
           severity_string.data(),
           message);
 }
+
+/// Compact layout of vertex_t, BoneId is wide enough for every bone of the mesh
+template<typename BoneId>
+struct packed_vertex_t
+{
+  /// Relative to the center of the mesh bounds in half extents, w unused
+  std::array<int16_t, 4> position;
+  /// Octahedral encoding
+  std::array<int16_t, 2> normal;
+  std::array<BoneId, 2> bone_ids;
+  /// Blend from the first to the second bone, the rest pads to the alignment of the ids
+  std::array<uint8_t, 2 * sizeof(BoneId)> bone_blend;
+};
+static_assert(sizeof(packed_vertex_t<uint8_t>) == 16);
+static_assert(sizeof(packed_vertex_t<uint16_t>) == 20);
+
+/// Meshes with more bones than 16 bit ids can address keep the float layout
+bool
+packs_vertices(const Resource::Mesh& mesh)
+{
+  auto finite = [](const glm::vec3& v) {
+    return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z);
+  };
+  return mesh.bones.size() <= std::numeric_limits<uint16_t>::max() + size_t{ 1 } &&
+         finite(mesh.bounds_min) && finite(mesh.bounds_max);
+}
+
+/// Positions are packed relative to the center of the bounds in half extents
+void
+packed_position_range(const Resource::Mesh& mesh, glm::vec3& offset, glm::vec3& scale)
+{
+  offset = 0.5f * (mesh.bounds_min + mesh.bounds_max);
+  // Flat meshes still need a valid scale on their flat axis
+  scale = glm::max(0.5f * (mesh.bounds_max - mesh.bounds_min), glm::vec3(1e-6f));
+}
+
+/// Largest error of a level of detail on screen, in pixels, for it to be drawn
+constexpr float kMaxLodErrorPixels = 1.0f;
+
+/// Height in pixels of the bounding sphere of a mesh drawn with @model_view and @projection
+float
+projected_diameter(const Resource::Mesh& mesh,
+                   const glm::mat4& model_view,
+                   const glm::vec3& scale,
+                   const glm::mat4& projection,
+                   float viewport_height)
+{
+  auto center = 0.5f * (mesh.bounds_min + mesh.bounds_max);
+  auto radius = 0.5f * glm::length(mesh.bounds_max - mesh.bounds_min) *
+                glm::max(glm::max(std::abs(scale.x), std::abs(scale.y)), std::abs(scale.z));
+  auto distance = glm::length(glm::vec3(model_view * glm::vec4(center, 1.0f)));
+  if (distance <= radius) {
+    return std::numeric_limits<float>::infinity();
+  }
+  return radius / distance * projection[1][1] * viewport_height;
+}
+
+/// The coarsest level of detail whose error, relative to the bounding radius, covers at most
+/// kMaxLodErrorPixels of a bounding sphere @diameter pixels high, nullptr for a single level
+const Resource::Mesh::Lod*
+select_lod(const Resource::Mesh& mesh, float diameter)
+{
+  if (mesh.lods.empty()) {
+    return nullptr;
+  }
+  size_t lod = 0;
+  while (lod + 1 < mesh.lods.size() &&
+         mesh.lods[lod + 1].error * 0.5f * diameter <= kMaxLodErrorPixels) {
+    ++lod;
+  }
+  return &mesh.lods[lod];
+}
+
+/// Append the three rows of the affine part of @matrix to @rows
+void
+append_affine_rows(const glm::mat4& matrix, std::vector<glm::vec4>& rows)
+{
+  for (glm::length_t row = 0; row < 3; ++row) {
+    rows.emplace_back(matrix[0][row], matrix[1][row], matrix[2][row], matrix[3][row]);
+  }
+}
+
+/// Append the affine rows of every matrix of @bones to @palette and return the texel the first
+/// one starts at
+uint32_t
+append_bone_palette(std::span<const glm::mat4> bones, std::vector<glm::vec4>& palette)
+{
+  static_assert(BONE_PALETTE_TEXELS == 3);
+  auto offset = static_cast<uint32_t>(palette.size());
+  palette.reserve(palette.size() + bones.size() * BONE_PALETTE_TEXELS);
+  for (const auto& bone : bones) {
+    append_affine_rows(bone, palette);
+  }
+  return offset;
+}
+
+/// Instance attributes of a mesh, starting at MESH_INSTANCE_LOCATION
+struct MeshInstance
+{
+  /// Rows of the affine part of the model matrix
+  glm::vec4 model_rows[3];
+  /// First texel and number of bones of the palette in the bone palette texture
+  uint32_t bone_offset;
+  uint32_t bone_count;
+};
+static_assert(sizeof(MeshInstance) == 56);
+
+/// Parent and child joint of a bone, in world space
+struct BoneLine
+{
+  glm::vec3 start;
+  glm::vec3 end;
+};
+
+int16_t
+to_snorm16(float value)
+{
+  return static_cast<int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+/// Project onto the octahedron and fold the lower hemisphere over the diagonals
+glm::vec2
+encode_octahedral(const glm::vec3& normal)
+{
+  auto length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  if (!(length > 0.0f)) {
+    return glm::vec2(0.0f);
+  }
+  glm::vec2 encoded = glm::vec2(normal.x, normal.y) / length;
+  if (normal.z < 0.0f) {
+    glm::vec2 signs(encoded.x >= 0.0f ? 1.0f : -1.0f, encoded.y >= 0.0f ? 1.0f : -1.0f);
+    encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * signs;
+  }
+  return encoded;
+}
+
+/// Interleaved packed vertices of @mesh and the attributes describing them
+template<typename BoneId>
+std::vector<uint8_t>
+pack_vertices(const Resource::Mesh& mesh, std::vector<IndexedMesh::MeshAttributes>& attributes)
+{
+  constexpr uint32_t kIdType = sizeof(BoneId) == 1 ? GL_UNSIGNED_BYTE : GL_UNSIGNED_SHORT;
+  attributes = {
+    IndexedMesh::MeshAttributes{ GL_SHORT, 4, true, false },        // Position
+    IndexedMesh::MeshAttributes{ GL_SHORT, 2, true, false },        // Normal
+    IndexedMesh::MeshAttributes{ kIdType, 2, false, true },         // Bone Id1, Bone Id2
+    IndexedMesh::MeshAttributes{ GL_UNSIGNED_BYTE, 2 * sizeof(BoneId), true, false }, // Blend
+  };
+
+  glm::vec3 offset, scale;
+  packed_position_range(mesh, offset, scale);
+  std::vector<uint8_t> packed(mesh.vertices.size() * sizeof(packed_vertex_t<BoneId>));
+  for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+    const auto& vertex = mesh.vertices[i];
+    packed_vertex_t<BoneId> result{};
+    auto position = (vertex.position - offset) / scale;
+    result.position = { to_snorm16(position.x), to_snorm16(position.y), to_snorm16(position.z), 0 };
+    auto normal = encode_octahedral(vertex.normal);
+    result.normal = { to_snorm16(normal.x), to_snorm16(normal.y) };
+    result.bone_ids = { static_cast<BoneId>(vertex.bone_id.x),
+                        static_cast<BoneId>(vertex.bone_id.y) };
+    result.bone_blend[0] =
+      static_cast<uint8_t>(std::round(std::clamp(vertex.bone_id.z, 0.0f, 1.0f) * 255.0f));
+    std::memcpy(packed.data() + i * sizeof(result), &result, sizeof(result));
+  }
+  return packed;
+}
 } // namespace
 
 std::unique_ptr<Renderer>
@@ -139,9 +330,14 @@ get_interpolated_armature(const Scene& scene,
 
     // If the animation is at the last keyframe, render the bones without linear
     // interpolation. Else we linearly interpolate the bones for smoother animation.
-    auto& matrices = animation.transformed_matrices;
-    if (!animation.loop && animation.current_frame == matrices.size() - 1) {
-      return animation.transformed_matrices[animation.current_frame];
+    const auto& current_pose = animation.current_pose;
+    const auto& next_pose = animation.next_pose;
+    if (current_pose.empty()) {
+      // Not evaluated by Scene::update yet
+      return armature.joints;
+    }
+    if (!animation.loop && animation.current_frame == animation.poses->frame_count - 1) {
+      return current_pose;
     } else {
       const auto& current_animation = resource_manager.animation_cache().handle(animation.id);
       auto current_frame_timestamp = animation.current_frame / current_animation->frame_rate;
@@ -155,13 +351,8 @@ get_interpolated_armature(const Scene& scene,
                                              1.0f);
 
       // Linearly interpolate each bone matrix
-      std::vector<glm::mat4> result;
-      result.reserve(matrices[animation.current_frame].size());
-      for (uint32_t i = 0; i < matrices[animation.current_frame].size(); i++) {
-        result.push_back(glm::mix(matrices[animation.current_frame][i],
-                                  matrices[(animation.current_frame + 1) % matrices.size()][i],
-                                  interpolation_factor));
-      }
+      std::vector<glm::mat4> result(current_pose.size());
+      Pose::blend(current_pose, next_pose, interpolation_factor, result);
       return result;
     }
   } else { // if there is no animation, load default bone mat
@@ -219,14 +410,33 @@ Renderer::render(const Scene& scene,
     full_screen_quad_->draw();
   }
 
+  // Every pass pushes the uniforms of all its draws first, so that they go up in one transfer
+  uniform_ring_buffer_->begin_frame();
+  camera_uniform_t camera_uniform{
+    perspective_matrix,
+    view_matrix,
+    glm::vec4(direction_to_sun, 0),
+  };
+  auto camera_offset = uniform_ring_buffer_->push(&camera_uniform, sizeof(camera_uniform));
+  joint_uniform_t joint_uniform{ ui.node_display_color() };
+  auto joint_offset = uniform_ring_buffer_->push(&joint_uniform, sizeof(joint_uniform));
+  // Interpolated by the mesh pass, kept for the joints of the armature pass
+  std::unordered_map<entt::entity, std::vector<glm::mat4>> armature_poses;
+
   {
     ScopedDebugGroup group("Draw Meshes");
-    mesh_pipeline_->bind();
-    mesh_vertex_uniform_buffer_->bind(0);
-
-    mesh_uniform_t mesh_vertex_uniform{
-      perspective_matrix, view_matrix, glm::mat4(), glm::vec4(direction_to_sun, 0), {},
+    struct MeshDraw
+    {
+      const Resource::Mesh* mesh;
+      Pipeline* pipeline;
+      const Resource::Mesh::Lod* lod;
+      MeshInstance instance;
     };
+    std::vector<MeshDraw> draws;
+    bone_palette_.clear();
+    // Shared by every mesh without bones, whose vertices all use bone 0
+    std::optional<uint32_t> identity_palette_offset;
+
     // Get a multi component view of all entities which have component Mesh and Armature
     auto view = scene.registry().view<const Components::Transform, const Components::Mesh>();
     for (const auto& entity : view) {
@@ -235,96 +445,197 @@ Renderer::render(const Scene& scene,
       // Get the mesh component of the entity
       const auto& mesh = view.get<const Components::Mesh>(entity);
 
-      mesh_vertex_uniform.model_matrix = glm::translate(transform.position) *
-                                         glm::toMat4(transform.orientation) *
-                                         glm::scale(transform.scale);
+      auto model_matrix = glm::translate(transform.position) *
+                          glm::toMat4(transform.orientation) * glm::scale(transform.scale);
+      auto model_rows = glm::transpose(model_matrix);
+      MeshInstance instance{ { model_rows[0], model_rows[1], model_rows[2] }, 0, 1 };
 
       // Get the Armature component of the entity
+      std::vector<glm::mat4> bone_trans_rots;
       if (scene.registry().has<Components::Armature>(entity)) {
-        std::vector<glm::mat4> bone_trans_rots =
-          get_interpolated_armature(scene, entity, resource_manager);
-        memcpy(mesh_vertex_uniform.bone_trans_rots,
-               bone_trans_rots.data(),
-               bone_trans_rots.size() * sizeof(bone_trans_rots[0]));
+        bone_trans_rots = get_interpolated_armature(scene, entity, resource_manager);
+      }
+      if (!bone_trans_rots.empty()) {
+        instance.bone_offset = append_bone_palette(bone_trans_rots, bone_palette_);
+        instance.bone_count = static_cast<uint32_t>(bone_trans_rots.size());
       } else {
-        for (uint32_t i = 0; i < sizeof(mesh_vertex_uniform.bone_trans_rots) /
-                                   sizeof(mesh_vertex_uniform.bone_trans_rots[0]);
-             ++i) {
-          mesh_vertex_uniform.bone_trans_rots[i] = glm::mat4(1.0f);
+        if (!identity_palette_offset) {
+          glm::mat4 identity(1.0f);
+          identity_palette_offset = append_bone_palette({ &identity, 1 }, bone_palette_);
         }
+        instance.bone_offset = *identity_palette_offset;
+      }
+      if (ui.draw_nodes() && !bone_trans_rots.empty()) {
+        armature_poses.emplace(entity, std::move(bone_trans_rots));
       }
-
-      mesh_vertex_uniform_buffer_->upload(&mesh_vertex_uniform, sizeof(mesh_vertex_uniform));
 
       // Mesh
       const auto& res = resource_manager.mesh_cache().handle(mesh.id);
       assert(res->gpu_resource);
-      res->gpu_resource->bind();
-      res->gpu_resource->draw();
+      // Must match the layout picked when the mesh was uploaded
+      const auto& pipeline = packs_vertices(*res) ? mesh_packed_pipeline_ : mesh_pipeline_;
+
+      auto diameter = projected_diameter(*res,
+                                         view_matrix * model_matrix,
+                                         transform.scale,
+                                         perspective_matrix,
+                                         static_cast<float>(height_));
+      draws.push_back({ &*res, pipeline.get(), select_lod(*res, diameter), instance });
+    }
+
+    // Entities sharing a mesh and level of detail become the instances of one draw
+    std::sort(draws.begin(), draws.end(), [](const MeshDraw& lhs, const MeshDraw& rhs) {
+      return std::tie(lhs.pipeline, lhs.mesh, lhs.lod) < std::tie(rhs.pipeline, rhs.mesh, rhs.lod);
+    });
+    struct MeshGroup
+    {
+      const MeshDraw* draw;
+      uint32_t first_instance;
+      uint32_t instance_count;
+      uint32_t uniform_offset;
+    };
+    std::vector<MeshGroup> groups;
+    std::vector<MeshInstance> instances;
+    instances.reserve(draws.size());
+    for (const auto& draw : draws) {
+      if (groups.empty() || groups.back().draw->mesh != draw.mesh ||
+          groups.back().draw->lod != draw.lod) {
+        mesh_uniform_t mesh_uniform{ {}, {} };
+        if (draw.pipeline == mesh_packed_pipeline_.get()) {
+          glm::vec3 offset, scale;
+          packed_position_range(*draw.mesh, offset, scale);
+          mesh_uniform.position_offset = glm::vec4(offset, 0.0f);
+          mesh_uniform.position_scale = glm::vec4(scale, 0.0f);
+        }
+        groups.push_back({
+          &draw,
+          static_cast<uint32_t>(instances.size()),
+          0,
+          uniform_ring_buffer_->push(&mesh_uniform, sizeof(mesh_uniform)),
+        });
+      }
+      instances.push_back(draw.instance);
+      ++groups.back().instance_count;
+    }
+    uniform_ring_buffer_->flush();
+    upload_bone_palettes();
+    mesh_instances_->upload(instances.data(), static_cast<uint32_t>(instances.size()));
+
+    uniform_ring_buffer_->bind(1, camera_offset, sizeof(camera_uniform_t));
+    bone_palette_texture_->bind(0);
+    const Pipeline* bound_pipeline = nullptr;
+    for (const auto& mesh_group : groups) {
+      const auto& draw = *mesh_group.draw;
+      if (draw.pipeline != bound_pipeline) {
+        draw.pipeline->bind();
+        bound_pipeline = draw.pipeline;
+      }
+      uniform_ring_buffer_->bind(0, mesh_group.uniform_offset, sizeof(mesh_uniform_t));
+      const auto& gpu_mesh = *draw.mesh->gpu_resource;
+      gpu_mesh.bind();
+      mesh_instances_->bind(MESH_INSTANCE_LOCATION, mesh_group.first_instance);
+      if (draw.lod != nullptr) {
+        gpu_mesh.draw_instanced(
+          draw.lod->index_offset, draw.lod->index_count, mesh_group.instance_count);
+      } else {
+        gpu_mesh.draw_instanced(mesh_group.instance_count);
+      }
     }
   }
 
+  // Joint disks and bone lines of all armatures are one instanced draw each
   if (ui.draw_nodes()) {
     ScopedDebugGroup group("Draw Armatures");
-    auto view = scene.registry().view<const Components::Transform, const Components::Armature>();
+    std::vector<glm::vec4> joint_rows;
+    std::vector<BoneLine> bone_lines;
+    auto node_scale = glm::scale(glm::vec3(ui.node_display_size()));
+    auto view = scene.registry().view<const Components::Transform,
+                                      const Components::Armature,
+                                      const Components::Mesh>();
     for (const auto& entity : view) {
-      for (const auto& model : get_interpolated_armature(scene, entity, resource_manager)) {
-        const auto& transform = view.get<const Components::Transform>(entity);
-
-        auto model_parent = glm::translate(transform.position) *
-                            glm::toMat4(transform.orientation) * glm::scale(transform.scale);
-
-        joint_disk_uniform_buffer_->bind(0);
-
-        joint_uniform_t joint_disk_uniform = {
-          .vp = perspective_matrix * view_matrix,
-          .model = model_parent * model,
-          .color = ui.node_display_color(),
-          .node_size = ui.node_display_size(),
-        };
-        joint_disk_uniform_buffer_->upload(&joint_disk_uniform, sizeof(joint_disk_uniform));
-
-        joint_pipeline_->bind();
-        disk_->bind();
-        disk_->draw();
+      const auto& transform = view.get<const Components::Transform>(entity);
+      const auto& mesh = view.get<const Components::Mesh>(entity);
+      auto pose = armature_poses.find(entity);
+      if (pose == armature_poses.end()) {
+        continue;
       }
+      const auto& joints = pose->second;
+      auto model_parent = glm::translate(transform.position) *
+                          glm::toMat4(transform.orientation) * glm::scale(transform.scale);
+      const auto& parents = resource_manager.mesh_cache().handle(mesh.id)->skeleton.parents;
+      for (uint32_t i = 0; i < joints.size(); ++i) {
+        auto model = model_parent * joints[i];
+        append_affine_rows(model * node_scale, joint_rows);
+        // kNoParent is past every joint
+        if (i < parents.size() && parents[i] < joints.size()) {
+          bone_lines.push_back(
+            { glm::vec3(model_parent * joints[parents[i]][3]), glm::vec3(model[3]) });
+        }
+      }
+    }
+
+    uniform_ring_buffer_->bind(0, joint_offset, sizeof(joint_uniform_t));
+    uniform_ring_buffer_->bind(1, camera_offset, sizeof(camera_uniform_t));
+    if (!bone_lines.empty()) {
+      bone_line_pipeline_->bind();
+      line_->bind();
+      bone_line_instances_->upload(bone_lines.data(), static_cast<uint32_t>(bone_lines.size()));
+      bone_line_instances_->bind(1);
+      line_->draw_instanced(bone_line_instances_->count());
     }
+    draw_joint_disks(joint_rows);
   }
 
   {
     ScopedDebugGroup group("Draw Mocap points");
-
+    // The points of every frame are already on the GPU, a frame is drawn by starting the
+    // instances at its first point
+    struct MocapDraw
+    {
+      const InstanceBuffer* chunk;
+      uint32_t first_instance;
+      uint32_t point_count;
+      uint32_t uniform_offset;
+    };
+    std::vector<MocapDraw> draws;
     auto view = scene.registry().view<const Components::MotionCaptureAnimation>();
     for (const auto& entity : view) {
       const auto& mocap = scene.registry().get<Components::MotionCaptureAnimation>(entity);
       const auto& mocap_resource = resource_manager.motion_capture_cache().handle(mocap.id);
+      if (mocap_resource->gpu_resources.empty() || mocap_resource->point_count == 0) {
+        continue;
+      }
+      auto chunk_frames = mocap_resource->gpu_resources[0]->count() / mocap_resource->point_count;
+      auto chunk = mocap.current_frame / chunk_frames;
+      assert(chunk < mocap_resource->gpu_resources.size());
+      mocap_uniform_t mocap_uniform = {
+        .scale = mocap.scale,
+        .node_size = mocap.node_size,
+      };
+      draws.push_back({
+        mocap_resource->gpu_resources[chunk].get(),
+        (mocap.current_frame - chunk * chunk_frames) * mocap_resource->point_count,
+        mocap_resource->point_count,
+        uniform_ring_buffer_->push(&mocap_uniform, sizeof(mocap_uniform)),
+      });
+    }
 
-      for (uint32_t i = 0; i < mocap_resource->point_count; ++i) {
-        auto point =
-          mocap_resource->frame_points[mocap.current_frame * mocap_resource->point_count + i] *
-          mocap.scale;
-
-        auto model = glm::scale(glm::vec3(mocap.scale)) * glm::translate(point);
-
-        joint_disk_uniform_buffer_->bind(0);
-
-        joint_uniform_t joint_disk_uniform = {
-          .vp = perspective_matrix * view_matrix,
-          .model = model,
-          .color = ui.node_display_color(),
-          .node_size = mocap.node_size,
-        };
-        joint_disk_uniform_buffer_->upload(&joint_disk_uniform, sizeof(joint_disk_uniform));
-
-        joint_pipeline_->bind();
-        disk_->bind();
-        disk_->draw();
+    if (!draws.empty()) {
+      uniform_ring_buffer_->flush();
+      uniform_ring_buffer_->bind(0, joint_offset, sizeof(joint_uniform_t));
+      uniform_ring_buffer_->bind(1, camera_offset, sizeof(camera_uniform_t));
+      mocap_point_pipeline_->bind();
+      disk_->bind();
+      for (const auto& draw : draws) {
+        uniform_ring_buffer_->bind(2, draw.uniform_offset, sizeof(mocap_uniform_t));
+        draw.chunk->bind(1, draw.first_instance);
+        disk_->draw_instanced(draw.point_count);
       }
     }
   }
+  uniform_ring_buffer_->end_frame();
 
   ui.draw();
-  glFinish();
 }
 
 void
@@ -349,24 +660,148 @@ Renderer::create_geometry()
 {
   full_screen_quad_ = IndexedMesh::create_full_screen_quad();
   disk_ = IndexedMesh::create_disk_3_fan(16, 1.0f);
+  line_ = IndexedMesh::create_line();
+  // Rows of the affine matrix of every joint disk
+  joint_instances_ = InstanceBuffer::create(
+    {
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 4 },
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 4 },
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 4 },
+    },
+    InstanceBuffer::Usage::Stream);
+  joint_instances_->set_debug_name("joint_instances_");
+  // Model matrix and bone palette of every mesh instance
+  mesh_instances_ = InstanceBuffer::create(
+    {
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 4 },
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 4 },
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 4 },
+      IndexedMesh::MeshAttributes{ GL_UNSIGNED_INT, 2, false, true },
+    },
+    InstanceBuffer::Usage::Stream);
+  mesh_instances_->set_debug_name("mesh_instances_");
+  // Start and end of every bone line
+  bone_line_instances_ = InstanceBuffer::create(
+    {
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 3 },
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 3 },
+    },
+    InstanceBuffer::Usage::Stream);
+  bone_line_instances_->set_debug_name("bone_line_instances_");
 }
 
 std::unique_ptr<IndexedMesh>
-Renderer::upload_mesh(const std::vector<vertex_t>& vertices, const std::vector<uint16_t>& indices)
+Renderer::upload_mesh(const Resource::Mesh& mesh)
 {
-  const std::vector<IndexedMesh::MeshAttributes> attributes = {
-    IndexedMesh::MeshAttributes{ GL_FLOAT, 3 }, // Position
-    IndexedMesh::MeshAttributes{ GL_FLOAT, 3 }, // Normal
-    IndexedMesh::MeshAttributes{ GL_FLOAT, 3 }, // Bone Id1, Bone Id2, blend value
-  };
+  std::vector<IndexedMesh::MeshAttributes> attributes;
+  std::vector<uint8_t> packed;
+  if (!packs_vertices(mesh)) {
+    attributes = {
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 3 }, // Position
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 3 }, // Normal
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 3 }, // Bone Id1, Bone Id2, blend value
+    };
+  } else if (mesh.bones.size() <= std::numeric_limits<uint8_t>::max() + size_t{ 1 }) {
+    packed = pack_vertices<uint8_t>(mesh, attributes);
+  } else {
+    packed = pack_vertices<uint16_t>(mesh, attributes);
+  }
+  // The instance attributes follow the vertex attributes
+  assert(attributes.size() <= MESH_INSTANCE_LOCATION);
+  const void* vertex_data = packed.empty() ? static_cast<const void*>(mesh.vertices.data())
+                                           : static_cast<const void*>(packed.data());
+  auto vertex_size = static_cast<uint32_t>(
+    packed.empty() ? mesh.vertices.size() * sizeof(mesh.vertices[0]) : packed.size());
+
+  const auto& vertices = mesh.vertices;
+  const auto& indices = mesh.indices;
+  auto index_count = static_cast<uint32_t>(indices.size());
+  // Indices of submeshes are relative to their base vertex and always fit
+  bool fits_short = !mesh.submeshes.empty() ||
+                    vertices.size() <= std::numeric_limits<uint16_t>::max() + size_t{ 1 };
+  if (!fits_short) {
+    return IndexedMesh::create(attributes,
+                               vertex_data,
+                               vertex_size,
+                               indices.data(),
+                               index_count,
+                               IndexedMesh::PrimitiveTopology::TriangleList);
+  }
+
+  std::vector<uint16_t> short_indices(indices.begin(), indices.end());
+  if (mesh.submeshes.empty()) {
+    return IndexedMesh::create(attributes,
+                               vertex_data,
+                               vertex_size,
+                               short_indices.data(),
+                               index_count,
+                               IndexedMesh::PrimitiveTopology::TriangleList);
+  }
+  std::vector<IndexedMesh::Submesh> submeshes;
+  submeshes.reserve(mesh.submeshes.size());
+  for (const auto& submesh : mesh.submeshes) {
+    submeshes.push_back({ submesh.index_offset, submesh.index_count, submesh.base_vertex });
+  }
   return IndexedMesh::create(attributes,
-                             vertices.data(),
-                             vertices.size() * sizeof(vertices[0]),
-                             indices.data(),
-                             indices.size(),
+                             vertex_data,
+                             vertex_size,
+                             short_indices.data(),
+                             std::move(submeshes),
                              IndexedMesh::PrimitiveTopology::TriangleList);
 }
 
+std::vector<std::unique_ptr<InstanceBuffer>>
+Renderer::upload_motion_capture(const Resource::MotionCapture& mocap)
+{
+  std::vector<std::unique_ptr<InstanceBuffer>> chunks;
+  if (mocap.point_count == 0) {
+    return chunks;
+  }
+  auto frame_count = static_cast<uint32_t>(mocap.frame_points.size() / mocap.point_count);
+  auto frame_size = mocap.point_count * static_cast<uint32_t>(sizeof(glm::vec3));
+  // Every chunk holds whole frames so that a frame is drawn from a single one
+  auto chunk_frames = std::max(kMotionCaptureChunkSize / frame_size, 1u);
+  for (uint32_t first_frame = 0; first_frame < frame_count; first_frame += chunk_frames) {
+    auto frames = std::min(chunk_frames, frame_count - first_frame);
+    auto& chunk = chunks.emplace_back(InstanceBuffer::create(
+      { IndexedMesh::MeshAttributes{ GL_FLOAT, 3 } }, InstanceBuffer::Usage::Static));
+    chunk->set_debug_name(mocap.name + " frames " + std::to_string(first_frame));
+    chunk->upload(&mocap.frame_points[size_t{ first_frame } * mocap.point_count],
+                  frames * mocap.point_count);
+  }
+  return chunks;
+}
+
+void
+Renderer::upload_bone_palettes()
+{
+  auto rows =
+    static_cast<uint32_t>((bone_palette_.size() + kBonePaletteWidth - 1) / kBonePaletteWidth);
+  if (rows > bone_palette_texture_->height()) {
+    bone_palette_texture_ = Texture::create(kBonePaletteWidth,
+                                            std::max(rows, 2 * bone_palette_texture_->height()),
+                                            Texture::MipMapFilter::nearest,
+                                            Texture::Format::rgba32f);
+    bone_palette_texture_->set_debug_name("bone_palette_texture_");
+  }
+  // Only whole rows are uploaded
+  bone_palette_.resize(size_t{ rows } * kBonePaletteWidth);
+  bone_palette_texture_->upload_rows(bone_palette_.data(), rows);
+}
+
+void
+Renderer::draw_joint_disks(const std::vector<glm::vec4>& instance_rows)
+{
+  if (instance_rows.empty()) {
+    return;
+  }
+  joint_pipeline_->bind();
+  disk_->bind();
+  joint_instances_->upload(instance_rows.data(), static_cast<uint32_t>(instance_rows.size() / 3));
+  joint_instances_->bind(1);
+  disk_->draw_instanced(joint_instances_->count());
+}
+
 void*
 Renderer::context_handle()
 {
@@ -411,8 +846,9 @@ Renderer::create_pipeline()
       .blend = false,
     };
     mesh_pipeline_ = Pipeline::create(Pipeline::Type::RasterOpenGL, info);
-    mesh_vertex_uniform_buffer_ = Buffer::create(sizeof(mesh_uniform_t));
-    mesh_vertex_uniform_buffer_->set_debug_name("mesh_uniform_buffer_");
+    info.vertex_shader_binary = mesh_packed_vert_glsl;
+    info.vertex_shader_size = sizeof(mesh_packed_vert_glsl) / sizeof(mesh_packed_vert_glsl[0]);
+    mesh_packed_pipeline_ = Pipeline::create(Pipeline::Type::RasterOpenGL, info);
   }
   // Joints
   {
@@ -429,8 +865,25 @@ Renderer::create_pipeline()
       .depth_test = Pipeline::DepthTest::Never,
       .blend = true,
     };
-    joint_disk_uniform_buffer_ = Buffer::create(sizeof(joint_uniform_t));
-    joint_disk_uniform_buffer_->set_debug_name("joint_vertex_uniform_buffer_");
     joint_pipeline_ = Pipeline::create(Pipeline::Type::RasterOpenGL, info);
+    info.vertex_shader_binary = bone_line_vert_glsl;
+    info.vertex_shader_size = sizeof(bone_line_vert_glsl) / sizeof(bone_line_vert_glsl[0]);
+    info.fragment_shader_binary = bone_line_frag_glsl;
+    info.fragment_shader_size = sizeof(bone_line_frag_glsl) / sizeof(bone_line_frag_glsl[0]);
+    bone_line_pipeline_ = Pipeline::create(Pipeline::Type::RasterOpenGL, info);
+    info.vertex_shader_binary = mocap_point_vert_glsl;
+    info.vertex_shader_size = sizeof(mocap_point_vert_glsl) / sizeof(mocap_point_vert_glsl[0]);
+    info.fragment_shader_binary = wireframe_frag_glsl;
+    info.fragment_shader_size = sizeof(wireframe_frag_glsl) / sizeof(wireframe_frag_glsl[0]);
+    mocap_point_pipeline_ = Pipeline::create(Pipeline::Type::RasterOpenGL, info);
   }
+  // Uniforms of every draw, grown when a frame needs more
+  uniform_ring_buffer_ = RingBuffer::create(kUniformFrameSize);
+  uniform_ring_buffer_->set_debug_name("uniform_ring_buffer_");
+  // Bone palettes of every mesh, grown when a frame needs more rows
+  bone_palette_texture_ = Texture::create(kBonePaletteWidth,
+                                          kBonePaletteRows,
+                                          Texture::MipMapFilter::nearest,
+                                          Texture::Format::rgba32f);
+  bone_palette_texture_->set_debug_name("bone_palette_texture_");
 }
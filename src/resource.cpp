@@ -1,22 +1,28 @@
 #include "resource.h"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include <queue>
+#include <span>
 #include <stack>
+#include <string_view>
 #include <unordered_map>
 
 #include <ANMFile.h>
-#include <Data.h>
-#include <Frame.h>
-#include <Header.h>
 #include <L3DFile.h>
-#include <assimp/cimport.h>
+#include <assimp/Importer.hpp>
+#include <assimp/config.h>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
-#include <bvh.h>
-#include <bvhloader.h>
-#include <ezc3d.h>
 #include <glm/ext/matrix_common.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/euler_angles.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
@@ -26,7 +32,18 @@
 
 #include "renderer.h"
 
+#include "private_impl/compression/compressed_animation.h"
+#include "private_impl/geometry/mesh_optimizer.h"
+#include "private_impl/geometry/mesh_simplifier.h"
 #include "private_impl/graphics/indexed_mesh.h"
+#include "private_impl/graphics/instance_buffer.h"
+#include "private_impl/io/asset_cache.h"
+#include "private_impl/io/bvh_reader.h"
+#include "private_impl/io/c3d_reader.h"
+#include "private_impl/io/mapped_file.h"
+#include "private_impl/pose/pose_kernel.h"
+#include "private_impl/threading/mpsc_queue.h"
+#include "private_impl/threading/thread_pool.h"
 
 using namespace AnimationViewer;
 
@@ -46,71 +63,900 @@ enum class FileType
   Unknown
 };
 
+/// Enough bytes for the longest magic number
+constexpr size_t kMagicSize = 20;
+
+bool
+has_magic(std::span<const uint8_t> head, std::string_view magic)
+{
+  return head.size() >= magic.size() && std::memcmp(head.data(), magic.data(), magic.size()) == 0;
+}
+
+/// Check the first bytes of a file against the magic numbers of the supported formats
+///
+/// Formats without a distinctive magic number also need the extension of @name to match.
+FileType
+detect_file_type(const std::filesystem::path& name, std::span<const uint8_t> head)
+{
+  if (has_magic(head, "L3D")) {
+    return FileType::L3D;
+  }
+  if (has_magic(head, "Kaydara FBX Binary  ")) {
+    return FileType::FBX;
+  }
+  if (has_magic(head, "HIERARCHY")) {
+    return FileType::BVH;
+  }
+  auto ext = name.extension().string();
+  std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  });
+  if (ext == ".anm") {
+    return FileType::ANM;
+  }
+  // Some C3D files have a bunch of 0s at the start of the file, we're not supporting those
+  if (ext == ".c3d" && head.size() >= 2 && head[1] == 0x50) {
+    return FileType::C3D;
+  }
+  return FileType::Unknown;
+}
+
 FileType
 detect_file_type(const std::filesystem::path& path)
 {
-  auto ext = path.extension();
-  // Check for L3D
-  if (ext == ".l3d" || ext == ".L3D" || ext == ".l3D" || ext == ".L3d") {
-    FILE* file = fopen(path.string().c_str(), "rb");
-    char magic_number[3];
-    fread(magic_number, sizeof(magic_number), 1, file);
-    if (magic_number[0] == 'L' && magic_number[1] == '3' && magic_number[2] == 'D') {
-      return FileType::L3D;
+  uint8_t head[kMagicSize];
+  size_t size = 0;
+  if (FILE* file = fopen(path.string().c_str(), "rb")) {
+    size = fread(head, 1, sizeof(head), file);
+    fclose(file);
+  }
+  return detect_file_type(path, std::span<const uint8_t>(head, size));
+}
+
+/// Importers which go through the asset cache, part of the key so their entries never mix
+enum class CachedImporter : uint32_t
+{
+  Assimp = 1,
+  OpenFbx = 2,
+};
+
+/// Post-processing steps the profiles choose from, in the order of Assimp's step registry.
+/// SplitLargeMeshes is registered as two passes, by triangles before normals are generated and by
+/// vertices once they are joined, so it is listed at both places.
+constexpr std::array<std::pair<unsigned int, const char*>, 17> kAssimpSteps{ {
+  { aiProcess_ValidateDataStructure, "Validate data structure" },
+  { aiProcess_RemoveRedundantMaterials, "Remove redundant materials" },
+  { aiProcess_FindInstances, "Find instances" },
+  { aiProcess_OptimizeMeshes, "Optimize meshes" },
+  { aiProcess_FindDegenerates, "Find degenerates" },
+  { aiProcess_GenUVCoords, "Generate UV coordinates" },
+  { aiProcess_Triangulate, "Triangulate" },
+  { aiProcess_SortByPType, "Sort by primitive type" },
+  { aiProcess_FindInvalidData, "Find invalid data" },
+  { aiProcess_SplitLargeMeshes, "Split large meshes by triangles" },
+  { aiProcess_GenNormals, "Generate normals" },
+  { aiProcess_GenSmoothNormals, "Generate smooth normals" },
+  { aiProcess_CalcTangentSpace, "Calculate tangent space" },
+  { aiProcess_JoinIdenticalVertices, "Join identical vertices" },
+  { aiProcess_SplitLargeMeshes, "Split large meshes by vertices" },
+  { aiProcess_LimitBoneWeights, "Limit bone weights" },
+  { aiProcess_ImproveCacheLocality, "Improve cache locality" },
+} };
+
+unsigned int
+assimp_steps(ResourceManager::AssimpProfile profile)
+{
+  switch (profile) {
+    case ResourceManager::AssimpProfile::AnimationOnly:
+      return 0;
+    case ResourceManager::AssimpProfile::FastPreview:
+      // Meshes are converted as indexed triangle lists and need normals, nothing else is used
+      return aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_GenNormals |
+             aiProcess_JoinIdenticalVertices;
+    case ResourceManager::AssimpProfile::MaxQuality:
+      return aiProcessPreset_TargetRealtime_MaxQuality;
+  }
+  return 0;
+}
+
+/// Records the wall time of consecutive phases of an import
+class PhaseTimer
+{
+public:
+  explicit PhaseTimer(std::vector<std::pair<std::string, float>>& phases)
+    : phases_(phases)
+    , start_(std::chrono::steady_clock::now())
+  {}
+
+  /// End the current phase and start the next one
+  void finish(std::string name)
+  {
+    auto end = std::chrono::steady_clock::now();
+    phases_.emplace_back(std::move(name), std::chrono::duration<float>(end - start_).count());
+    start_ = end;
+  }
+
+private:
+  std::vector<std::pair<std::string, float>>& phases_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+/// FBX euler angles in degrees, the order names the axis applied first
+glm::mat3
+euler_orientation(ofbx::RotationOrder order, const ofbx::Vec3& rotation)
+{
+  auto x = glm::radians(static_cast<float>(rotation.x));
+  auto y = glm::radians(static_cast<float>(rotation.y));
+  auto z = glm::radians(static_cast<float>(rotation.z));
+  switch (order) {
+    case ofbx::RotationOrder::EULER_XZY:
+      return glm::mat3(glm::eulerAngleYZX(y, z, x));
+    case ofbx::RotationOrder::EULER_YZX:
+      return glm::mat3(glm::eulerAngleXZY(x, z, y));
+    case ofbx::RotationOrder::EULER_YXZ:
+      return glm::mat3(glm::eulerAngleZXY(z, x, y));
+    case ofbx::RotationOrder::EULER_ZXY:
+      return glm::mat3(glm::eulerAngleYXZ(y, x, z));
+    case ofbx::RotationOrder::EULER_ZYX:
+      return glm::mat3(glm::eulerAngleXYZ(x, y, z));
+    case ofbx::RotationOrder::EULER_XYZ:
+    // Not supported by OpenFBX either, which evaluates it as XYZ
+    case ofbx::RotationOrder::SPHERIC_XYZ:
+    default:
+      return glm::mat3(glm::eulerAngleZYX(z, y, x));
+  }
+}
+
+/// Samples the three curves of a curve node at increasing times
+///
+/// Same linear interpolation as AnimationCurveNode::getNodeLocalTransform, which searches every
+/// curve from its first key on each call and made sampling long takes quadratic.
+class FbxCurveSampler
+{
+public:
+  /// @fallback is used when the property isn't animated at all
+  FbxCurveSampler(const ofbx::AnimationCurveNode* node, const ofbx::Vec3& fallback)
+    : defaults_{ fallback.x, fallback.y, fallback.z }
+    , curves_{}
+    , cursors_{}
+  {
+    if (node == nullptr) {
+      return;
+    }
+    bool keyed = true;
+    for (int i = 0; i < 3; ++i) {
+      curves_[i] = node->getCurve(i);
+      keyed = keyed && (curves_[i] == nullptr || curves_[i]->getKeyCount() > 0);
+    }
+    // Axes without a curve keep the node's own value, which is what it evaluates to at any time.
+    // A curve without keys would make OpenFBX read out of bounds, fall back for those as well.
+    if (keyed) {
+      auto defaults = node->getNodeLocalTransform(0.0);
+      defaults_ = { defaults.x, defaults.y, defaults.z };
+    }
+    for (auto& curve : curves_) {
+      if (curve != nullptr && curve->getKeyCount() == 0) {
+        curve = nullptr;
+      }
     }
   }
-  // Check for ANM
-  if (ext == ".anm" || ext == ".Anm" || ext == ".ANm" || ext == ".aNm" || ext == ".aNM" ||
-      ext == ".anM" || ext == ".AnM" || ext == ".ANM") {
-    return FileType::ANM;
+
+  /// @time must not decrease between calls
+  ofbx::Vec3 sample(ofbx::i64 time)
+  {
+    double values[3];
+    for (int i = 0; i < 3; ++i) {
+      values[i] = curves_[i] == nullptr ? defaults_[i] : sample(i, time);
+    }
+    return { values[0], values[1], values[2] };
   }
-  // Check for C3D
-  if (ext == ".c3d" || ext == ".C3D" || ext == ".c3D" || ext == ".c3d") {
-    FILE* file = fopen(path.string().c_str(), "rb");
-    char magic_number[2];
-    fread(magic_number, sizeof(magic_number), 1, file);
-    // Some C3D files have a bunch of 0s at the start of the file, we're not supporting those
-    if (magic_number[1] == 0x50) {
-      return FileType::C3D;
-    }
-  }
-  // Check for FBX
-  if (ext == ".fbx" || ext == ".Fbx" || ext == ".FBx" || ext == ".fBx" || ext == ".fBX" ||
-      ext == ".fbX" || ext == ".FbX" || ext == ".FBX") {
-    FILE* file = fopen(path.string().c_str(), "rb");
-    char magic_number[21];
-    fread(magic_number, 1, sizeof(magic_number), file);
-    magic_number[20] = '\0';
-    if (strcmp(magic_number, "Kaydara FBX Binary  ") == 0) {
-      return FileType::FBX;
-    }
-  }
-  // Check for BVH
-  if (ext == ".bvh" || ext == ".Bvh" || ext == ".BVh" || ext == ".bVh" || ext == ".bVH" ||
-      ext == ".bvH" || ext == ".BvH" || ext == ".BVH") {
-    FILE* file = fopen(path.string().c_str(), "rb");
-    char magic_number[10];
-    fread(magic_number, 1, sizeof(magic_number), file);
-    magic_number[9] = '\0';
-    if (strcmp(magic_number, "HIERARCHY") == 0) {
-      return FileType::BVH;
+
+private:
+  double sample(int axis, ofbx::i64 time)
+  {
+    const auto* times = curves_[axis]->getKeyTime();
+    const auto* values = curves_[axis]->getKeyValue();
+    int count = curves_[axis]->getKeyCount();
+    if (time <= times[0]) {
+      return values[0];
+    }
+    if (time >= times[count - 1]) {
+      return values[count - 1];
+    }
+    auto& cursor = cursors_[axis];
+    while (times[cursor + 1] < time) {
+      ++cursor;
+    }
+    auto t = static_cast<double>(time - times[cursor]) /
+             static_cast<double>(times[cursor + 1] - times[cursor]);
+    return values[cursor] * (1.0 - t) + values[cursor + 1] * t;
+  }
+
+  std::array<double, 3> defaults_;
+  std::array<const ofbx::AnimationCurve*, 3> curves_;
+  std::array<int, 3> cursors_;
+};
+
+/// Runs the geometry jobs of ofbx::load on the thread pool passed as @user
+void
+fbx_job_processor(ofbx::JobFunction function,
+                  void* user,
+                  void* data,
+                  ofbx::u32 size,
+                  ofbx::u32 count)
+{
+  auto jobs = static_cast<uint8_t*>(data);
+  static_cast<AnimationViewer::Threading::ThreadPool*>(user)->parallel_for(
+    count, [&](uint32_t i) { function(jobs + size_t{ size } * i); });
+}
+
+void
+compute_bounds(Resource::Mesh& mesh)
+{
+  if (mesh.vertices.empty()) {
+    mesh.bounds_min = mesh.bounds_max = glm::vec3(0.0f);
+    return;
+  }
+  mesh.bounds_min = mesh.bounds_max = mesh.vertices[0].position;
+  for (const auto& vertex : mesh.vertices) {
+    mesh.bounds_min = glm::min(mesh.bounds_min, vertex.position);
+    mesh.bounds_max = glm::max(mesh.bounds_max, vertex.position);
+  }
+}
+
+/// Vertices a submesh can address with 16 bit indices
+constexpr size_t kMaxSubmeshVertices = size_t{ std::numeric_limits<uint16_t>::max() } + 1;
+
+/// Split a mesh with too many vertices for 16 bit indices into submeshes which each fit
+///
+/// Triangles keep their order and fill the current submesh until it runs out of vertices or a
+/// level of detail starts, so every level is drawn by whole submeshes. Vertices used on both sides
+/// of a split are duplicated, so every submesh owns a contiguous range.
+void
+split_into_submeshes(Resource::Mesh& mesh)
+{
+  if (mesh.vertices.size() <= kMaxSubmeshVertices) {
+    return;
+  }
+  constexpr uint32_t kUnassigned = std::numeric_limits<uint32_t>::max();
+  auto index_count = mesh.indices.size() - mesh.indices.size() % 3;
+  std::vector<vertex_t> vertices;
+  vertices.reserve(mesh.vertices.size());
+  std::vector<uint32_t> indices(index_count);
+  std::vector<Resource::Mesh::Submesh> submeshes;
+  submeshes.push_back({ 0, 0, 0 });
+  // Index in the current submesh of every source vertex, and the source of every vertex in it
+  std::vector<uint32_t> local(mesh.vertices.size(), kUnassigned);
+  std::vector<uint32_t> sources;
+  size_t next_lod = 1;
+  for (size_t i = 0; i < index_count; i += 3) {
+    size_t added = 0;
+    for (size_t j = i; j < i + 3; ++j) {
+      added += local[mesh.indices[j]] == kUnassigned;
+    }
+    bool lod_start = next_lod < mesh.lods.size() && i >= mesh.lods[next_lod].index_offset;
+    if (lod_start) {
+      ++next_lod;
+    }
+    if (lod_start || sources.size() + added > kMaxSubmeshVertices) {
+      for (auto source : sources) {
+        local[source] = kUnassigned;
+      }
+      sources.clear();
+      submeshes.push_back(
+        { static_cast<uint32_t>(i), 0, static_cast<uint32_t>(vertices.size()) });
+    }
+    for (size_t j = i; j < i + 3; ++j) {
+      auto source = mesh.indices[j];
+      if (local[source] == kUnassigned) {
+        local[source] = static_cast<uint32_t>(sources.size());
+        sources.push_back(source);
+        vertices.push_back(mesh.vertices[source]);
+      }
+      indices[j] = local[source];
+    }
+    submeshes.back().index_count += 3;
+  }
+  mesh.vertices = std::move(vertices);
+  mesh.indices = std::move(indices);
+  mesh.submeshes = std::move(submeshes);
+}
+
+/// Animation sample blocks holding @count values of type T
+template<typename T>
+size_t
+blocks_for(size_t count)
+{
+  constexpr auto kBlockSize = sizeof(Resource::Animation::SampleBlock);
+  return (count * sizeof(T) + kBlockSize - 1) / kBlockSize;
+}
+
+/// Default animation compression tolerances, a millimetre for animations in metres and about
+/// 0.06 degrees
+constexpr float kPositionTolerance = 1e-3f;
+constexpr float kRotationTolerance = 1e-3f;
+constexpr float kScaleTolerance = 1e-3f;
+/// Frames a pose cache keeps by default, enough to scrub back and forth over a few seconds
+constexpr uint32_t kPoseCacheFrames = 256;
+
+/// Levels of detail generated for meshes without authored ones, including the full detail
+constexpr size_t kMaxGeneratedLods = 4;
+/// Levels with fewer triangles are not simplified any further
+constexpr size_t kMinLodTriangles = 64;
+/// Largest error of one simplification step, relative to the bounding radius
+constexpr float kMaxLodStepError = 0.1f;
+/// Error charged for collapsing between vertices on unrelated bones, relative to the bounding
+/// radius
+constexpr float kLodSkinError = 0.05f;
+/// Levels of detail of an L3D submesh, stored in 3 bits
+constexpr uint32_t kMaxL3DLods = 8;
+/// Error assumed for the first coarser L3D level, relative to the bounding radius
+constexpr float kL3DLodError = 0.01f;
+
+/// Indices of one level of detail, or all of them for a mesh with a single level
+std::span<uint32_t>
+lod_indices(Resource::Mesh& mesh, size_t lod)
+{
+  if (mesh.lods.empty()) {
+    return mesh.indices;
+  }
+  return std::span(mesh.indices).subspan(mesh.lods[lod].index_offset, mesh.lods[lod].index_count);
+}
+
+/// Append simplified levels of detail to a mesh without authored ones
+///
+/// Every level aims for half the triangles of the one before and is simplified from it, so their
+/// errors add up. Stops when a step can't get far enough within its error limit.
+void
+simplify_into_lods(Resource::Mesh& mesh)
+{
+  auto radius = 0.5f * glm::length(mesh.bounds_max - mesh.bounds_min);
+  if (!mesh.lods.empty() || radius <= 0.0f) {
+    return;
+  }
+  mesh.indices.resize(mesh.indices.size() - mesh.indices.size() % 3);
+  std::vector<Resource::Mesh::Lod> lods;
+  lods.push_back({ 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f });
+  std::vector<uint32_t> source = mesh.indices;
+  float error = 0.0f;
+  while (lods.size() < kMaxGeneratedLods && source.size() / 3 >= kMinLodTriangles) {
+    float step_error;
+    auto simplified = Geometry::simplify(mesh.vertices,
+                                         source,
+                                         source.size() / 6 * 3,
+                                         kMaxLodStepError * radius,
+                                         kLodSkinError * radius,
+                                         step_error);
+    if (simplified.size() * 4 > source.size() * 3) {
+      break;
+    }
+    error += step_error / radius;
+    lods.push_back({ static_cast<uint32_t>(mesh.indices.size()),
+                     static_cast<uint32_t>(simplified.size()),
+                     error });
+    mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+    source = std::move(simplified);
+  }
+  if (lods.size() > 1) {
+    mesh.lods = std::move(lods);
+  }
+}
+
+/// Clear the joint offsets of @animation if they are all identities, which saves a product per
+/// joint whenever a pose is evaluated
+void
+drop_identity_offsets(Resource::Animation& animation)
+{
+  if (std::all_of(animation.joint_offsets.begin(),
+                  animation.joint_offsets.end(),
+                  [](const glm::mat4& offset) { return offset == glm::mat4(1.0f); })) {
+    animation.joint_offsets.clear();
+  }
+}
+
+/// Skeleton and joint mapping of a pose cache for @animation on @mesh
+///
+/// Animations without joint parents and with a joint per bone are in bone order. Others are
+/// matched to the bones by joint name, bones without a joint stay in their rest pose.
+void
+set_up_pose_cache(const Resource::Mesh& mesh,
+                  const Resource::Animation& animation,
+                  Resource::PoseCache& cache)
+{
+  auto bone_count = static_cast<uint32_t>(mesh.bones.size());
+  cache.frame_count = animation.frame_count;
+  cache.joint_count = bone_count;
+  cache.skeleton = mesh.skeleton;
+  cache.joints.assign(bone_count, Resource::PoseCache::kNone);
+  cache.local_joints = animation.joint_parents.empty() && animation.joint_count == bone_count;
+  if (cache.local_joints) {
+    for (uint32_t i = 0; i < bone_count; ++i) {
+      cache.joints[i] = i;
+    }
+    return;
+  }
+  if (animation.joint_parents.size() != animation.joint_count) {
+    return;
+  }
+  cache.joint_hierarchy.sort(animation.joint_parents);
+  std::unordered_map<std::string, uint32_t> bone_map;
+  for (uint32_t i = 0; i < bone_count; ++i) {
+    bone_map.emplace(mesh.bones[i].name, i);
+  }
+  for (uint32_t j = 0; j < animation.joint_names.size(); ++j) {
+    auto found = bone_map.find(animation.joint_names[j]);
+    if (found != bone_map.end()) {
+      cache.joints[found->second] = j;
     }
   }
-  return FileType::Unknown;
 }
 } // namespace
 
+void
+Resource::Animation::allocate(uint32_t frames, uint32_t joints, Layout sample_layout)
+{
+  frame_count = frames;
+  joint_count = joints;
+  layout = sample_layout;
+  frame_times.assign(frames, 0);
+  samples.assign(block_count(size_t{ frames } * joints), SampleBlock{});
+  std::fill(rotations().begin(), rotations().end(), glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+  std::fill(scales().begin(), scales().end(), glm::vec3(1.0f));
+}
+
+void
+Resource::Animation::set_layout(Layout sample_layout)
+{
+  if (sample_layout == layout || samples.empty()) {
+    layout = sample_layout;
+    return;
+  }
+  std::vector<SampleBlock> reordered(samples.size());
+  auto transpose = [this, sample_layout](auto source, auto destination) {
+    for (uint32_t frame = 0; frame < frame_count; ++frame) {
+      for (uint32_t joint = 0; joint < joint_count; ++joint) {
+        auto to = sample_layout == Layout::FrameMajor ? size_t{ frame } * joint_count + joint
+                                                      : size_t{ joint } * frame_count + frame;
+        destination[to] = source[sample_index(frame, joint)];
+      }
+    }
+  };
+  // Offsets of the channels only depend on the sample count
+  transpose(translations().data(), reinterpret_cast<glm::vec3*>(reordered.data()));
+  transpose(rotations().data(), reinterpret_cast<glm::quat*>(reordered.data() + rotations_block()));
+  transpose(scales().data(), reinterpret_cast<glm::vec3*>(reordered.data() + scales_block()));
+  samples = std::move(reordered);
+  layout = sample_layout;
+}
+
+void
+Resource::Animation::compress(const Tolerances& tolerances)
+{
+  if (samples.empty()) {
+    return;
+  }
+  compressed = Compression::CompressedAnimation::create(*this, tolerances);
+  samples = {};
+}
+
+std::span<glm::vec3>
+Resource::Animation::translations()
+{
+  return { reinterpret_cast<glm::vec3*>(samples.data()), sample_count() };
+}
+
+std::span<const glm::vec3>
+Resource::Animation::translations() const
+{
+  return { reinterpret_cast<const glm::vec3*>(samples.data()), sample_count() };
+}
+
+std::span<glm::quat>
+Resource::Animation::rotations()
+{
+  return { reinterpret_cast<glm::quat*>(samples.data() + rotations_block()), sample_count() };
+}
+
+std::span<const glm::quat>
+Resource::Animation::rotations() const
+{
+  return { reinterpret_cast<const glm::quat*>(samples.data() + rotations_block()),
+           sample_count() };
+}
+
+std::span<glm::vec3>
+Resource::Animation::scales()
+{
+  return { reinterpret_cast<glm::vec3*>(samples.data() + scales_block()), sample_count() };
+}
+
+std::span<const glm::vec3>
+Resource::Animation::scales() const
+{
+  return { reinterpret_cast<const glm::vec3*>(samples.data() + scales_block()),
+           sample_count() };
+}
+
+void
+Resource::Animation::sample(uint32_t frame,
+                            uint32_t joint,
+                            glm::vec3& translation,
+                            glm::quat& rotation,
+                            glm::vec3& scale) const
+{
+  if (compressed) {
+    compressed->sample(static_cast<float>(frame), joint, translation, rotation, scale);
+    return;
+  }
+  auto sample = sample_index(frame, joint);
+  translation = translations()[sample];
+  rotation = rotations()[sample];
+  scale = scales()[sample];
+}
+
+void
+Resource::Animation::sample_pose(float frame,
+                                 std::span<glm::vec3> translations,
+                                 std::span<glm::quat> rotations,
+                                 std::span<glm::vec3> scales) const
+{
+  assert(translations.size() == joint_count && rotations.size() == joint_count &&
+         scales.size() == joint_count);
+  if (compressed) {
+    compressed->sample(frame, translations, rotations, scales);
+    return;
+  }
+  assert(frame_count > 0);
+  auto first = std::min(static_cast<uint32_t>(frame), frame_count - 1);
+  auto next = std::min(first + 1, frame_count - 1);
+  auto factor = std::clamp(frame - static_cast<float>(first), 0.0f, 1.0f);
+  auto channels = [this](size_t offset, size_t count) {
+    return Pose::TransformSpans{ this->translations().subspan(offset, count),
+                                 this->rotations().subspan(offset, count),
+                                 this->scales().subspan(offset, count) };
+  };
+  if (layout == Layout::FrameMajor) {
+    Pose::interpolate(channels(sample_index(first, 0), joint_count),
+                      channels(sample_index(next, 0), joint_count),
+                      factor,
+                      translations,
+                      rotations,
+                      scales);
+    return;
+  }
+  // The joints of a frame are strided, interpolate them one at a time
+  for (uint32_t joint = 0; joint < joint_count; ++joint) {
+    Pose::interpolate(channels(sample_index(first, joint), 1),
+                      channels(sample_index(next, joint), 1),
+                      factor,
+                      translations.subspan(joint, 1),
+                      rotations.subspan(joint, 1),
+                      scales.subspan(joint, 1));
+  }
+}
+
+glm::mat4
+Resource::Animation::transform(uint32_t frame, uint32_t joint) const
+{
+  glm::vec3 translation;
+  glm::quat rotation;
+  glm::vec3 scale;
+  sample(frame, joint, translation, rotation, scale);
+  glm::mat4 result = glm::mat4_cast(rotation);
+  result[0] *= scale.x;
+  result[1] *= scale.y;
+  result[2] *= scale.z;
+  result[3] = glm::vec4(translation, 1.0f);
+  return result;
+}
+
+void
+Resource::Animation::set_sample(uint32_t frame,
+                                uint32_t joint,
+                                const glm::vec3& translation,
+                                const glm::quat& rotation,
+                                const glm::vec3& scale)
+{
+  auto sample = sample_index(frame, joint);
+  translations()[sample] = translation;
+  rotations()[sample] = rotation;
+  scales()[sample] = scale;
+}
+
+void
+Resource::Animation::set_transform(uint32_t frame, uint32_t joint, const glm::mat4& transform)
+{
+  glm::mat3 rotation(transform);
+  glm::vec3 scale(glm::length(rotation[0]), glm::length(rotation[1]), glm::length(rotation[2]));
+  // A mirroring transform keeps a proper rotation by flipping one axis of the scale
+  if (glm::determinant(rotation) < 0.0f) {
+    scale.x = -scale.x;
+  }
+  glm::length_t zero_axes = 0;
+  glm::length_t axis = 0;
+  for (glm::length_t i = 0; i < 3; ++i) {
+    if (scale[i] != 0.0f) {
+      rotation[i] /= scale[i];
+      axis = i;
+    } else {
+      ++zero_axes;
+    }
+  }
+  // A zero scale collapses its axis, which is rebuilt from the others to keep the basis orthonormal
+  if (zero_axes == 3) {
+    rotation = glm::mat3(1.0f);
+  } else if (zero_axes == 2) {
+    auto helper = std::abs(rotation[axis].x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+    auto next = glm::normalize(glm::cross(rotation[axis], helper));
+    rotation[(axis + 1) % 3] = next;
+    rotation[(axis + 2) % 3] = glm::cross(rotation[axis], next);
+  } else if (zero_axes == 1) {
+    for (glm::length_t i = 0; i < 3; ++i) {
+      if (scale[i] == 0.0f) {
+        rotation[i] = glm::cross(rotation[(i + 1) % 3], rotation[(i + 2) % 3]);
+      }
+    }
+  }
+  set_sample(frame,
+             joint,
+             glm::vec3(transform[3]),
+             glm::normalize(glm::quat_cast(rotation)),
+             scale);
+}
+
+size_t
+Resource::Animation::block_count(size_t sample_count)
+{
+  return 2 * blocks_for<glm::vec3>(sample_count) + blocks_for<glm::quat>(sample_count);
+}
+
+size_t
+Resource::Animation::rotations_block() const
+{
+  return blocks_for<glm::vec3>(sample_count());
+}
+
+size_t
+Resource::Animation::scales_block() const
+{
+  return rotations_block() + blocks_for<glm::quat>(sample_count());
+}
+
+size_t
+Resource::Animation::sample_count() const
+{
+  return samples.empty() ? 0 : size_t{ frame_count } * joint_count;
+}
+
+void
+Resource::Skeleton::build(std::span<const bone_t> bones)
+{
+  auto bone_count = static_cast<uint32_t>(bones.size());
+  std::vector<uint32_t> bone_parents(bone_count);
+  for (uint32_t i = 0; i < bone_count; ++i) {
+    bone_parents[i] = bones[i].parent;
+  }
+  sort(bone_parents);
+
+  rest_local.resize(bone_count);
+  for (uint32_t i = 0; i < bone_count; ++i) {
+    rest_local[i] = glm::translate(bones[i].position) * glm::mat4(bones[i].orientation);
+  }
+  rest_global.resize(bone_count);
+  local_to_global(rest_local, rest_global);
+  inverse_bind.resize(bone_count);
+  for (uint32_t i = 0; i < bone_count; ++i) {
+    inverse_bind[i] = glm::inverse(rest_global[i]);
+  }
+}
+
+void
+Resource::Skeleton::sort(std::span<const uint32_t> bone_parents)
+{
+  auto bone_count = static_cast<uint32_t>(bone_parents.size());
+  parents.assign(bone_count, kNoParent);
+  // Children of every bone as one flat array
+  std::vector<uint32_t> child_offsets(bone_count + 1, 0);
+  for (uint32_t i = 0; i < bone_count; ++i) {
+    if (bone_parents[i] < bone_count && bone_parents[i] != i) {
+      parents[i] = bone_parents[i];
+      ++child_offsets[parents[i] + 1];
+    }
+  }
+  for (uint32_t i = 0; i < bone_count; ++i) {
+    child_offsets[i + 1] += child_offsets[i];
+  }
+  std::vector<uint32_t> children(child_offsets.back());
+  {
+    auto fill = child_offsets;
+    for (uint32_t i = 0; i < bone_count; ++i) {
+      if (parents[i] != kNoParent) {
+        children[fill[parents[i]]++] = i;
+      }
+    }
+  }
+
+  // Breadth first from the roots
+  std::vector<bool> placed(bone_count, false);
+  order.clear();
+  order.reserve(bone_count);
+  auto place_descendants = [&](size_t first) {
+    for (auto i = first; i < order.size(); ++i) {
+      for (auto c = child_offsets[order[i]]; c < child_offsets[order[i] + 1]; ++c) {
+        if (!placed[children[c]]) {
+          placed[children[c]] = true;
+          order.push_back(children[c]);
+        }
+      }
+    }
+  };
+  for (uint32_t i = 0; i < bone_count; ++i) {
+    if (parents[i] == kNoParent) {
+      placed[i] = true;
+      order.push_back(i);
+    }
+  }
+  place_descendants(0);
+  // Bones on a parent cycle are never reached from a root, every cycle is cut at one bone
+  for (uint32_t i = 0; i < bone_count && order.size() < bone_count; ++i) {
+    if (!placed[i]) {
+      parents[i] = kNoParent;
+      placed[i] = true;
+      order.push_back(i);
+      place_descendants(order.size() - 1);
+    }
+  }
+}
+
+void
+Resource::Skeleton::local_to_global(std::span<const glm::mat4> locals,
+                                    std::span<glm::mat4> globals) const
+{
+  static_assert(kNoParent == Pose::kNoParent);
+  assert(locals.size() >= parents.size() && globals.size() >= parents.size());
+  Pose::local_to_global(order, parents, locals, globals);
+}
+
+std::span<const glm::mat4>
+Resource::PoseCache::pose(const Animation& animation, uint32_t frame)
+{
+  auto found = cached_.find(frame);
+  if (found != cached_.end()) {
+    recent_.splice(recent_.begin(), recent_, found->second);
+    return std::span<const glm::mat4>(slots_).subspan(size_t{ found->second->second } * joint_count,
+                                                       joint_count);
+  }
+
+  uint32_t slot = 0;
+  if (capacity > 0) {
+    if (recent_.size() < capacity) {
+      slot = static_cast<uint32_t>(recent_.size());
+    } else {
+      slot = recent_.back().second;
+      cached_.erase(recent_.back().first);
+      recent_.pop_back();
+    }
+    recent_.emplace_front(frame, slot);
+    cached_.emplace(frame, recent_.begin());
+  }
+  // Slots are only allocated once they are needed, so a short clip never allocates all of them
+  slots_.resize(std::max(slots_.size(), size_t{ slot + 1 } * joint_count));
+  auto result = std::span(slots_).subspan(size_t{ slot } * joint_count, joint_count);
+  evaluate(animation, frame, result);
+  return result;
+}
+
+void
+Resource::PoseCache::evaluate(const Animation& animation,
+                              uint32_t frame,
+                              std::span<glm::mat4> pose)
+{
+  // Sample and compose every joint in one batch, then concatenate them in bone order
+  translations_.resize(animation.joint_count);
+  rotations_.resize(animation.joint_count);
+  scales_.resize(animation.joint_count);
+  locals_.resize(animation.joint_count);
+  animation.sample_pose(static_cast<float>(frame), translations_, rotations_, scales_);
+  Pose::compose({ translations_, rotations_, scales_ }, locals_);
+  if (local_joints) {
+    // Joints are in bone order
+    skeleton.local_to_global(locals_, pose);
+    return;
+  }
+  // Otherwise the joints are concatenated in their own hierarchy before they are matched to bones
+  if (!animation.joint_offsets.empty()) {
+    for (uint32_t joint = 0; joint < animation.joint_count; ++joint) {
+      locals_[joint] = animation.joint_offsets[joint] * locals_[joint];
+    }
+  }
+  joint_hierarchy.local_to_global(locals_, locals_);
+  for (uint32_t bone = 0; bone < joint_count; ++bone) {
+    pose[bone] = joints[bone] == kNone ? skeleton.rest_global[bone] : locals_[joints[bone]];
+  }
+}
+
 namespace AnimationViewer::Loader {
+/// Node hierarchy of an Assimp scene, built once and shared by the conversion of all its meshes
+/// and animations, which may run concurrently and only read it
+struct AssimpHierarchy
+{
+  explicit AssimpHierarchy(const aiNode* root)
+  {
+    std::vector<const aiNode*> order;
+    std::unordered_map<const aiNode*, uint32_t> node_indices;
+    node_indices[nullptr] = std::numeric_limits<uint32_t>::max();
+    std::queue<const aiNode*> armature;
+    armature.push(root);
+    while (!armature.empty()) {
+      auto node = armature.front();
+      armature.pop();
+      for (uint32_t i = 0; i < node->mNumChildren; ++i) {
+        armature.push(node->mChildren[i]);
+      }
+
+      auto index = static_cast<uint32_t>(bones.size());
+      order.push_back(node);
+      node_indices.emplace(node, index);
+      bone_indices.emplace(node->mName.C_Str(), index);
+      auto& res = bones.emplace_back();
+      res.name = node->mName.C_Str();
+      res.parent = node_indices[node->mParent];
+      res.firstChild = std::numeric_limits<uint32_t>::max();
+      res.rightSibling = std::numeric_limits<uint32_t>::max();
+      aiQuaterniont<ai_real> rotation;
+      aiVector3t<ai_real> position;
+      node->mTransformation.DecomposeNoScaling(rotation, position);
+      res.position = glm::make_vec3(&position.x);
+      res.orientation =
+        glm::mat4(glm::normalize(glm::quat(rotation.w, rotation.x, rotation.y, rotation.z)));
+      transformations.push_back(glm::transpose(glm::make_mat4(node->mTransformation[0])));
+    }
+    skeleton.build(bones);
+
+    for (uint32_t i = 0; i < order.size(); ++i) {
+      auto node = order[i];
+      if (node->mNumChildren) {
+        bones[i].firstChild = node_indices[node->mChildren[0]];
+      }
+      for (uint32_t j = 1; j < node->mNumChildren; ++j) {
+        bones[node_indices[node->mChildren[j - 1]]].rightSibling =
+          node_indices[node->mChildren[j]];
+      }
+    }
+  }
+
+  /// Index of the bone for the node called @name, 0 if there is none
+  uint32_t bone_index(const char* name) const
+  {
+    auto found = bone_indices.find(name);
+    return found == bone_indices.end() ? 0 : found->second;
+  }
+
+  /// Every node as a bone, breadth first from the root
+  std::vector<bone_t> bones;
+  Resource::Skeleton skeleton;
+  /// Transformation of every node relative to its parent, unlike the bones including the scale
+  std::vector<glm::mat4> transformations;
+  std::unordered_map<std::string, uint32_t> bone_indices;
+};
+
 struct Mesh final : entt::loader<Mesh, Resource::Mesh>
 {
+  /// Adopt a mesh converted on an import worker
+  std::shared_ptr<Resource::Mesh> load(std::shared_ptr<Resource::Mesh> mesh) const
+  {
+    return mesh;
+  }
+
   std::shared_ptr<Resource::Mesh> load(const std::string& name,
                                        const openblack::l3d::L3DFile& l3d) const
   {
     auto mesh = std::make_shared<Resource::Mesh>();
     mesh->name = name;
 
-    mesh->bones.reserve(l3d.GetBones().size());
-    for (const auto& bone : l3d.GetBones()) {
+    const auto bones = l3d.GetBones();
+    mesh->bones.reserve(bones.size());
+    for (const auto& bone : bones) {
       glm::mat3 orient = glm::make_mat3(bone.orientation);
 
       mesh->bones.push_back({
@@ -123,46 +969,68 @@ struct Mesh final : entt::loader<Mesh, Resource::Mesh>
       });
     }
 
-    // Add all vertices
-    uint32_t vertex_index = 0, vertex_group_index = 0;
-
-    mesh->vertices.reserve(l3d.GetVertices().size());
-    for (size_t i = 0; i < l3d.GetVertices().size(); i++) {
-      const auto& vertex = l3d.GetVertices()[i];
-      if (l3d.GetLookUpTableData().size() > vertex_group_index &&
-          vertex_index >= l3d.GetLookUpTableData()[vertex_group_index].vertexCount) {
-        vertex_group_index++;
-        vertex_index = 0;
+    // Vertex groups bind consecutive runs of vertices to a bone, the rest stay on bone 0
+    const auto vertices = l3d.GetVertices();
+    mesh->vertices.resize(vertices.size());
+    const auto convert_vertices = [&vertices, &mesh](size_t begin, size_t end, uint16_t bone_index) {
+      for (size_t i = begin; i < end; ++i) {
+        const auto& vertex = vertices[i];
+        mesh->vertices[i] = {
+          { vertex.position.x, vertex.position.y, vertex.position.z },
+          { vertex.normal.x, vertex.normal.y, vertex.normal.z },
+          glm::vec3(static_cast<float>(bone_index), 0, 0),
+        };
       }
-
-      uint32_t bone_index = 0;
-      if (l3d.GetLookUpTableData().size() > vertex_group_index) {
-        bone_index = l3d.GetLookUpTableData()[vertex_group_index].boneIndex;
+    };
+    size_t vertex_index = 0;
+    for (const auto& group : l3d.GetLookUpTableData()) {
+      auto group_end = std::min(vertex_index + group.vertexCount, vertices.size());
+      convert_vertices(vertex_index, group_end, group.boneIndex);
+      vertex_index = group_end;
+    }
+    convert_vertices(vertex_index, vertices.size(), 0);
+
+    // Indices are relative to their primitive's vertices. Submeshes own consecutive runs of
+    // primitives and the authored levels of detail are submeshes, which are grouped by level here,
+    // finest first, so every level is one range of indices
+    const auto indices = l3d.GetIndices();
+    const auto primitives = l3d.GetPrimitiveHeaders();
+    std::vector<uint32_t> primitive_lods(primitives.size(), 0);
+    {
+      size_t primitive = 0;
+      for (const auto& submesh : l3d.GetSubmeshHeaders()) {
+        for (uint32_t i = 0; i < submesh.numPrimitives && primitive < primitives.size(); ++i) {
+          primitive_lods[primitive++] = submesh.flags.lod;
+        }
       }
-
-      mesh->vertices.push_back({
-        { vertex.position.x, vertex.position.y, vertex.position.z },
-        { vertex.normal.x, vertex.normal.y, vertex.normal.z },
-        glm::vec3(static_cast<float>(bone_index), 0, 0),
-      });
-
-      vertex_index++;
     }
-
-    // Correctly input Indices
-    uint32_t indices_index = 0, vertices_offset = 0, indices_group = 0;
-
-    mesh->indices.reserve(l3d.GetIndices().size());
-    for (size_t i = 0; i < l3d.GetIndices().size(); i++) {
-      if (indices_index >= l3d.GetPrimitiveHeaders()[indices_group].numTriangles * 3) {
-        vertices_offset += l3d.GetPrimitiveHeaders()[indices_group].numVertices;
-        indices_index = 0;
-        indices_group++;
+    mesh->indices.reserve(indices.size());
+    for (uint32_t lod = 0; lod < kMaxL3DLods; ++lod) {
+      auto lod_offset = static_cast<uint32_t>(mesh->indices.size());
+      size_t index_offset = 0;
+      uint32_t vertex_offset = 0;
+      for (size_t p = 0; p < primitives.size(); ++p) {
+        auto index_end = std::min(index_offset + primitives[p].numTriangles * 3, indices.size());
+        if (primitive_lods[p] == lod) {
+          for (size_t i = index_offset; i < index_end; ++i) {
+            mesh->indices.push_back(indices[i] + vertex_offset);
+          }
+        }
+        index_offset = index_end;
+        vertex_offset += primitives[p].numVertices;
+      }
+      auto lod_count = static_cast<uint32_t>(mesh->indices.size()) - lod_offset;
+      if (lod_count > 0) {
+        // The files don't say how far apart the levels are, assume the error doubles per level
+        auto error = mesh->lods.empty()
+                       ? 0.0f
+                       : kL3DLodError * static_cast<float>(1u << (mesh->lods.size() - 1));
+        mesh->lods.push_back({ lod_offset, lod_count, error });
       }
-
-      mesh->indices.push_back(l3d.GetIndices()[i] + vertices_offset);
-
-      indices_index++;
+    }
+    // A single level is left for the import to simplify like any other mesh
+    if (mesh->lods.size() == 1) {
+      mesh->lods.clear();
     }
 
     return mesh;
@@ -209,8 +1077,12 @@ struct Mesh final : entt::loader<Mesh, Resource::Mesh>
     }
 
     // Object->id, mesh_resource->bones index
-    std::unordered_map<uint64_t, uint32_t> seen_links;
+    std::unordered_map<ofbx::u64, uint32_t> seen_links;
     std::stack<const ofbx::Object*> branch;
+    // Two heaviest bones of every vertex and their weights, like the Assimp path keeps
+    constexpr uint32_t kNoBone = std::numeric_limits<uint32_t>::max();
+    std::vector<std::array<std::pair<uint32_t, double>, 2>> influences(
+      mesh_resource->vertices.size(), { { { kNoBone, 0.0 }, { kNoBone, 0.0 } } });
 
     auto skin = geometry->getSkin();
     if (skin && skin->getClusterCount() > 0) {
@@ -236,35 +1108,23 @@ struct Mesh final : entt::loader<Mesh, Resource::Mesh>
         // seen_node is null.
 
         bool is_root = parent_node == nullptr;
-        uint32_t parent_id = 0;
+        ofbx::u64 parent_id = 0;
         if (!is_root) {
           parent_id = parent_node->id;
         }
         // Insert node in tree list
         auto orientation = glm::mat3(1.0);
         if (!is_root) {
-          orientation = mesh_resource->bones[seen_links[parent_node->id]].orientation;
+          orientation = mesh_resource->bones[seen_links.at(parent_id)].orientation;
         }
         while (!branch.empty()) {
           uint32_t current_index = mesh_resource->bones.size();
           auto& bone = mesh_resource->bones.emplace_back();
           bone.firstChild = std::numeric_limits<uint32_t>::max();
           bone.rightSibling = std::numeric_limits<uint32_t>::max();
-          auto rotation = branch.top()->getLocalRotation();
-          switch (branch.top()->getRotationOrder()) {
-            case ofbx::RotationOrder::EULER_XYZ:
-              bone.orientation = glm::mat3(glm::eulerAngleZYX(
-                glm::radians(rotation.z), glm::radians(rotation.y), glm::radians(rotation.x)));
-              break;
-            case ofbx::RotationOrder::EULER_XZY:
-            case ofbx::RotationOrder::EULER_YZX:
-            case ofbx::RotationOrder::EULER_YXZ:
-            case ofbx::RotationOrder::EULER_ZXY:
-            case ofbx::RotationOrder::EULER_ZYX:
-            case ofbx::RotationOrder::SPHERIC_XYZ:
-            default:
-              assert(false);
-          }
+          bone.name = branch.top()->name;
+          bone.orientation = euler_orientation(branch.top()->getRotationOrder(),
+                                               branch.top()->getLocalRotation());
           glm::vec3 scale(1.0f);
           {
             auto transform = cluster->getTransformLinkMatrix();
@@ -286,108 +1146,75 @@ struct Mesh final : entt::loader<Mesh, Resource::Mesh>
             bone.parent = std::numeric_limits<uint32_t>::max();
             is_root = false;
           } else {
-            bone.parent = seen_links[parent_id];
+            bone.parent = seen_links.at(parent_id);
             // Insert self into parent's child linked list
             if (mesh_resource->bones[bone.parent].firstChild ==
                 std::numeric_limits<uint32_t>::max()) {
               mesh_resource->bones[bone.parent].firstChild = current_index;
             } else {
+              // Append to the last sibling of the first child
               uint32_t walker;
-              for (walker = bone.parent;
+              for (walker = mesh_resource->bones[bone.parent].firstChild;
                    mesh_resource->bones[walker].rightSibling < std::numeric_limits<uint32_t>::max();
                    walker = mesh_resource->bones[walker].rightSibling) {
               }
-              mesh_resource->bones[bone.parent].rightSibling = current_index;
+              mesh_resource->bones[walker].rightSibling = current_index;
             }
           }
           // Add to seen_links, pop from stack
           seen_links.emplace(branch.top()->id, current_index);
           parent_id = branch.top()->id;
-          branch.pop();
-        }
-
-        for (int j = 0; j < cluster->getIndicesCount(); ++j) {
-          assert(cluster->getIndices()[j] < geometry->getVertexCount());
-          // TODO: We don't support blending yet but this is done in the assimp impl
-          assert(cluster->getWeights()[i] <= 1);
-
-          auto& vertex = mesh_resource->vertices[cluster->getIndices()[j]];
-          vertex.bone_id = glm::vec3(seen_links[cluster->getLink()->id], 0, 0);
-        }
-      }
-      // Convert from absolute to relative to joint
-      for (auto& vertex : mesh_resource->vertices) {
-        glm::mat4 matrix(1.0f);
-        for (uint32_t bone_id = vertex.bone_id.x; bone_id < std::numeric_limits<uint32_t>::max();
-             bone_id = mesh_resource->bones[bone_id].parent) {
-          auto& bone = mesh_resource->bones[bone_id];
-          glm::mat4 rot = glm::mat4(bone.orientation);
-          glm::mat4 trans = glm::translate(bone.position);
-          matrix = trans * rot * matrix;
-        }
-        glm::vec3 translation = -matrix[3];
-        glm::mat3 rotation = glm::transpose(matrix);
-        vertex.position = rotation * (vertex.position + translation);
-      }
-    }
-    return mesh_resource;
-  }
-
-  std::shared_ptr<Resource::Mesh> load(const std::string& name,
-                                       const aiMesh* mesh,
-                                       const aiNode* root) const
-  {
-    auto mesh_resource = std::make_shared<Resource::Mesh>();
-    mesh_resource->name = name;
-
-    std::unordered_map<const aiNode*, uint32_t> node_joint_map;
-    node_joint_map[nullptr] = std::numeric_limits<uint32_t>::max();
-    std::queue<const aiNode*> armature;
-    armature.push(root);
-    while (!armature.empty()) {
-      auto node = armature.front();
-      armature.pop();
-      for (uint32_t i = 0; i < node->mNumChildren; ++i) {
-        armature.push(node->mChildren[i]);
-      }
-
-      node_joint_map.emplace(node, mesh_resource->bones.size());
-      auto& res = mesh_resource->bones.emplace_back();
-      res.name = node->mName.C_Str();
-      res.parent = node_joint_map[node->mParent];
-      res.firstChild = std::numeric_limits<uint32_t>::max();
-      res.rightSibling = std::numeric_limits<uint32_t>::max();
-      aiQuaterniont<ai_real> rotation;
-      aiVector3t<ai_real> position;
-      node->mTransformation.DecomposeNoScaling(rotation, position);
-      res.position = glm::make_vec3(&position.x);
-      res.orientation =
-        glm::mat4(glm::normalize(glm::quat(rotation.w, rotation.x, rotation.y, rotation.z)));
-    }
-
-    armature.push(root);
-    while (!armature.empty()) {
-      auto node = armature.front();
-      auto joint_id = node_joint_map[node];
-      armature.pop();
-      for (uint32_t i = 0; i < node->mNumChildren; ++i) {
-        armature.push(node->mChildren[i]);
-      }
-      if (node->mNumChildren) {
-        mesh_resource->bones[joint_id].firstChild = node_joint_map[node->mChildren[0]];
+          branch.pop();
+        }
+
+        auto link = cluster->getLink();
+        auto found = link ? seen_links.find(link->id) : seen_links.end();
+        if (found == seen_links.end()) {
+          continue;
+        }
+        for (int j = 0; j < cluster->getIndicesCount(); ++j) {
+          assert(cluster->getIndices()[j] < geometry->getVertexCount());
+          auto& influence = influences[cluster->getIndices()[j]];
+          auto weight = cluster->getWeights()[j];
+          if (weight > influence[0].second) {
+            influence[1] = influence[0];
+            influence[0] = { found->second, weight };
+          } else if (weight > influence[1].second) {
+            influence[1] = { found->second, weight };
+          }
+        }
       }
-      joint_id = mesh_resource->bones[joint_id].firstChild;
-      for (uint32_t i = 1; i < node->mNumChildren; ++i) {
-        mesh_resource->bones[joint_id].rightSibling = node_joint_map[node->mChildren[i]];
+      // Convert from absolute to relative to the blend of both joints
+      mesh_resource->skeleton.build(mesh_resource->bones);
+      const auto& inverse_bind = mesh_resource->skeleton.inverse_bind;
+      for (size_t i = 0; i < mesh_resource->vertices.size(); ++i) {
+        auto& vertex = mesh_resource->vertices[i];
+        const auto& influence = influences[i];
+        uint32_t a_id = influence[0].first == kNoBone ? 0 : influence[0].first;
+        uint32_t b_id = 0;
+        float b = 0.0f;
+        // If there's a second joint to blend
+#if ANIMATIONVIEWER_ENABLE_BLENDING
+        if (influence[1].first != kNoBone) {
+          b_id = influence[1].first;
+          b = static_cast<float>(influence[1].second / (influence[0].second + influence[1].second));
+        }
+#endif
+        auto mat = glm::mix(inverse_bind[a_id], inverse_bind[b_id], b);
+        vertex.position = glm::vec3(mat * glm::vec4(vertex.position, 1.0f));
+        vertex.bone_id = glm::vec3(a_id, b_id, b);
       }
     }
+    return mesh_resource;
+  }
 
-    std::unordered_map<std::string, uint32_t> name_joint_map;
-    for (auto& [key, value] : node_joint_map) {
-      if (key != NULL) {
-        name_joint_map.emplace(key->mName.C_Str(), value);
-      }
-    }
+  std::shared_ptr<Resource::Mesh> load(const std::string& name,
+                                       const aiMesh* mesh,
+                                       const AssimpHierarchy& hierarchy) const
+  {
+    auto mesh_resource = std::make_shared<Resource::Mesh>();
+    mesh_resource->name = name;
+    mesh_resource->bones = hierarchy.bones;
 
     std::vector<std::array<std::pair<const aiBone*, float>, 2>> vertex_bone_map(mesh->mNumVertices);
     for (uint32_t i = 0; i < mesh->mNumBones; ++i) {
@@ -417,7 +1244,7 @@ struct Mesh final : entt::loader<Mesh, Resource::Mesh>
       mesh_resource->vertices[i].normal = glm::make_vec3(&mesh->mNormals[i].x);
       if (vertex_bone_map[i][0].first) {
         float a = vertex_bone_map[i][0].second;
-        uint32_t a_id = name_joint_map[vertex_bone_map[i][0].first->mName.C_Str()];
+        uint32_t a_id = hierarchy.bone_index(vertex_bone_map[i][0].first->mName.C_Str());
         glm::mat4 mat_a = glm::make_mat4(vertex_bone_map[i][0].first->mOffsetMatrix[0]);
         float b = 0.0f;
         uint32_t b_id = 0;
@@ -426,7 +1253,7 @@ struct Mesh final : entt::loader<Mesh, Resource::Mesh>
 #if ANIMATIONVIEWER_ENABLE_BLENDING
         if (vertex_bone_map[i][1].first) {
           b = vertex_bone_map[i][1].second;
-          b_id = name_joint_map[vertex_bone_map[i][1].first->mName.C_Str()];
+          b_id = hierarchy.bone_index(vertex_bone_map[i][1].first->mName.C_Str());
           mat_b = glm::make_mat4(vertex_bone_map[i][1].first->mOffsetMatrix[0]);
         }
 #endif
@@ -458,6 +1285,12 @@ struct Mesh final : entt::loader<Mesh, Resource::Mesh>
 
 struct Animation final : entt::loader<Animation, Resource::Animation>
 {
+  /// Adopt an animation converted on an import worker
+  std::shared_ptr<Resource::Animation> load(std::shared_ptr<Resource::Animation> animation) const
+  {
+    return animation;
+  }
+
   std::shared_ptr<Resource::Animation> load(const std::string& name,
                                             const openblack::anm::ANMFile& anm) const
   {
@@ -468,42 +1301,199 @@ struct Animation final : entt::loader<Animation, Resource::Animation>
     animation->frame_rate =
       animation->frame_count / static_cast<float>(animation->animation_duration);
 
-    const std::vector<openblack::anm::ANMFrame>& frames = anm.GetKeyframes();
-    animation->keyframes.reserve(animation->frame_count * sizeof(Resource::AnimationFrame));
-    for (uint32_t i = 0; i < animation->frame_count; i++) {
-      Resource::AnimationFrame frame;
+    // Single pass straight from the file mapping into the channels
+    const auto& frames = anm.GetKeyframes();
+    auto joint_count = frames.empty() ? 0 : static_cast<uint32_t>(frames[0].bones.size());
+    animation->allocate(static_cast<uint32_t>(frames.size()), joint_count);
+    for (uint32_t i = 0; i < frames.size(); ++i) {
+      animation->frame_times[i] = frames[i].time;
+      for (uint32_t j = 0; j < std::min<size_t>(frames[i].bones.size(), joint_count); ++j) {
+        animation->set_transform(i, j, glm::mat4(glm::make_mat4x3(frames[i].bones[j].matrix)));
+      }
+    }
+
+    return animation;
+  }
+
+  std::shared_ptr<Resource::Animation> load(const std::string& name,
+                                            Io::BvhReader& reader,
+                                            std::atomic<float>& progress) const
+  {
+    const auto& joints = reader.joints();
+    // Frame Time is in seconds, animations count in microseconds
+    auto frame_time = reader.frame_time() * 1e6f;
+
+    auto animation = std::make_shared<Resource::Animation>();
+    animation->name = name;
+    animation->frame_count = reader.frame_count();
+    animation->animation_duration = static_cast<uint32_t>(animation->frame_count * frame_time);
+    animation->frame_rate = 1.0f / frame_time;
+    animation->joint_names.reserve(joints.size());
+    animation->joint_parents.reserve(joints.size());
+    for (const auto& joint : joints) {
+      animation->joint_names.push_back(joint.name);
+      animation->joint_parents.push_back(joint.parent);
+    }
 
-      for (auto bone : frames[i].bones) {
-        glm::mat4x3 bone4x3mat = glm::make_mat4x3(bone.matrix);
-        frame.bones.emplace_back(bone4x3mat);
+    // Frames are converted as they are tokenized, only one frame of channel values is kept
+    std::vector<float> channels(reader.channel_count());
+    animation->allocate(reader.frame_count(), static_cast<uint32_t>(joints.size()));
+    for (uint32_t i = 0; i < animation->frame_count; ++i) {
+      if (!reader.read_frame(channels.data())) {
+        return nullptr;
+      }
+      animation->frame_times[i] = static_cast<uint32_t>(i * frame_time);
+      const float* value = channels.data();
+      for (size_t j = 0; j < joints.size(); ++j) {
+        const auto& joint = joints[j];
+        // Position channels replace the offset, rotations apply in the order they are listed
+        glm::vec3 translation = joint.offset;
+        glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+        for (auto channel : joint.channels) {
+          switch (channel) {
+            case Io::BvhReader::Channel::XPosition:
+              translation.x = *value;
+              break;
+            case Io::BvhReader::Channel::YPosition:
+              translation.y = *value;
+              break;
+            case Io::BvhReader::Channel::ZPosition:
+              translation.z = *value;
+              break;
+            case Io::BvhReader::Channel::XRotation:
+              rotation = rotation * glm::angleAxis(glm::radians(*value), glm::vec3(1, 0, 0));
+              break;
+            case Io::BvhReader::Channel::YRotation:
+              rotation = rotation * glm::angleAxis(glm::radians(*value), glm::vec3(0, 1, 0));
+              break;
+            case Io::BvhReader::Channel::ZRotation:
+              rotation = rotation * glm::angleAxis(glm::radians(*value), glm::vec3(0, 0, 1));
+              break;
+          }
+          ++value;
+        }
+        animation->set_sample(
+          i, static_cast<uint32_t>(j), translation, rotation, glm::vec3(1.0f, 1.0f, 1.0f));
       }
-      frame.time = frames[i].time;
-      animation->keyframes.push_back(frame);
+      progress = reader.progress();
     }
 
     return animation;
   }
 
-  std::shared_ptr<Resource::Animation> load(const std::string& name, const k::Bvh& bvh) const
+  std::shared_ptr<Resource::Animation> load(const std::string& name,
+                                            const ofbx::IScene& scene,
+                                            const ofbx::AnimationStack& stack) const
   {
+    // Only the base layer, blending further layers on top isn't supported
+    auto layer = stack.getLayer(0);
+    if (layer == nullptr) {
+      return nullptr;
+    }
+
+    // Every object with a curve node is a joint, however many of its properties are animated
+    std::vector<const ofbx::Object*> bones;
+    ofbx::i64 first_key = std::numeric_limits<ofbx::i64>::max();
+    ofbx::i64 last_key = std::numeric_limits<ofbx::i64>::min();
+    for (int i = 0; auto node = layer->getCurveNode(i); ++i) {
+      if (auto bone = node->getBone();
+          bone && std::find(bones.begin(), bones.end(), bone) == bones.end()) {
+        bones.push_back(bone);
+      }
+      for (int j = 0; j < 3; ++j) {
+        auto curve = node->getCurve(j);
+        if (curve && curve->getKeyCount() > 0) {
+          first_key = std::min(first_key, curve->getKeyTime()[0]);
+          last_key = std::max(last_key, curve->getKeyTime()[curve->getKeyCount() - 1]);
+        }
+      }
+    }
+    if (bones.empty()) {
+      return nullptr;
+    }
+
+    std::unordered_map<const ofbx::Object*, uint32_t> bone_indices;
+    for (uint32_t i = 0; i < bones.size(); ++i) {
+      bone_indices.emplace(bones[i], i);
+    }
+
+    auto to_mat4 = [](const ofbx::Matrix& matrix) {
+      return glm::mat4(glm::make_mat4(matrix.m));
+    };
+    struct Joint
+    {
+      /// Nearest animated ancestor, uint32_t max if there is none
+      uint32_t parent;
+      /// Product of the static transforms between the joint and that ancestor
+      glm::mat4 static_parent;
+      FbxCurveSampler translation;
+      FbxCurveSampler rotation;
+      FbxCurveSampler scaling;
+    };
+    std::vector<Joint> joints;
+    joints.reserve(bones.size());
+    for (auto bone : bones) {
+      auto& joint = joints.emplace_back(Joint{
+        std::numeric_limits<uint32_t>::max(),
+        glm::mat4(1.0f),
+        { layer->getCurveNode(*bone, "Lcl Translation"), bone->getLocalTranslation() },
+        { layer->getCurveNode(*bone, "Lcl Rotation"), bone->getLocalRotation() },
+        { layer->getCurveNode(*bone, "Lcl Scaling"), bone->getLocalScaling() },
+      });
+      for (auto parent = bone->getParent(); parent != nullptr; parent = parent->getParent()) {
+        if (auto found = bone_indices.find(parent); found != bone_indices.end()) {
+          joint.parent = found->second;
+          break;
+        }
+        joint.static_parent = to_mat4(parent->getLocalTransform()) * joint.static_parent;
+      }
+    }
+
+    // The take knows the intended range, the scene settings come next and the keys last
+    double start = ofbx::fbxTimeToSeconds(first_key);
+    double stop = ofbx::fbxTimeToSeconds(last_key);
+    auto take = scene.getTakeInfo(stack.name);
+    if (take && take->local_time_to > take->local_time_from) {
+      start = take->local_time_from;
+      stop = take->local_time_to;
+    } else if (auto settings = scene.getGlobalSettings();
+               settings->TimeSpanStop > settings->TimeSpanStart) {
+      start = settings->TimeSpanStart;
+      stop = settings->TimeSpanStop;
+    } else if (first_key > last_key) {
+      start = stop = 0.0;
+    }
+    // Unset and default time modes don't say anything about the rate
+    double fps = scene.getSceneFrameRate() > 1.0f ? scene.getSceneFrameRate() : 30.0;
+
     auto animation = std::make_shared<Resource::Animation>();
-    // TODO fill in these values and remove assert
-    assert(false);
-    // animation->name =
-    animation->frame_count = bvh.getNumFrames();
-    // animation->animation_duration =
-    // animation->frame_rate =
-
-    animation->keyframes.reserve(animation->frame_count);
-    for (uint32_t i = 0; i < animation->frame_count; i++) {
-      //  Resource::AnimationFrame frame;
-      //
-      //  for (auto bone : frames[i].bones) {
-      //    glm::mat4x3 bone4x3mat = glm::make_mat4x3(bone.matrix);
-      //    frame.bones.emplace_back(bone4x3mat);
-      //  }
-      //  frame.time = frames[i].time;
-      //  animation->keyframes.push_back(frame);
+    animation->name = name;
+    animation->frame_count = static_cast<uint32_t>(std::floor((stop - start) * fps + 0.5)) + 1;
+    animation->animation_duration = static_cast<uint32_t>(animation->frame_count / fps * 1e6);
+    animation->frame_rate = static_cast<float>(fps * 1e-6);
+    animation->joint_names.reserve(bones.size());
+    for (auto bone : bones) {
+      animation->joint_names.emplace_back(bone->name);
+    }
+    for (const auto& joint : joints) {
+      animation->joint_parents.push_back(joint.parent);
+      animation->joint_offsets.push_back(joint.static_parent);
+    }
+    drop_identity_offsets(*animation);
+
+    animation->allocate(animation->frame_count, static_cast<uint32_t>(joints.size()));
+    for (uint32_t i = 0; i < animation->frame_count; ++i) {
+      auto seconds = i / fps;
+      auto time = ofbx::secondsToFbxTime(start + seconds);
+      animation->frame_times[i] = static_cast<uint32_t>(seconds * 1e6);
+      for (uint32_t j = 0; j < joints.size(); ++j) {
+        auto& joint = joints[j];
+        // Rotation order, pre and post rotation and pivots are all handled by evalLocal, whose
+        // pivots only add to the translation, so the result decomposes without loss
+        auto local = to_mat4(bones[j]->evalLocal(
+          joint.translation.sample(time), joint.rotation.sample(time), joint.scaling.sample(time)));
+        animation->set_transform(i, j, local);
+      }
     }
 
     return animation;
@@ -511,7 +1501,7 @@ struct Animation final : entt::loader<Animation, Resource::Animation>
 
   std::shared_ptr<Resource::Animation> load(const std::string& name,
                                             const aiAnimation* anim,
-                                            const aiNode* root) const
+                                            const AssimpHierarchy& hierarchy) const
   {
     auto animation = std::make_shared<Resource::Animation>();
     animation->name = name;
@@ -534,70 +1524,59 @@ struct Animation final : entt::loader<Animation, Resource::Animation>
     animation->animation_duration = anim->mDuration * 1e-6f;
     animation->frame_rate = anim->mTicksPerSecond * 1e-6f;
 
-    animation->keyframes.resize(animation->frame_count);
-    for (uint32_t i = 0; i < animation->frame_count; ++i) {
-      animation->keyframes[i].time = i * anim->mTicksPerSecond;
-      animation->keyframes[i].bones.resize(anim->mNumChannels);
-    }
-
-    std::unordered_map<std::string, const aiNode*> node_map;
-    std::stack<const aiNode*> nodes;
-    nodes.push(root);
-    while (!nodes.empty()) {
-      auto node = nodes.top();
-      nodes.pop();
-      for (uint32_t i = 0; i < node->mNumChildren; ++i) {
-        nodes.push(node->mChildren[i]);
+    // Node of every channel, so frames don't look up names. Nodes without a channel keep their
+    // static transformation
+    constexpr uint32_t kNoNode = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> channel_nodes(anim->mNumChannels, kNoNode);
+    for (uint32_t j = 0; j < anim->mNumChannels; ++j) {
+      auto found = hierarchy.bone_indices.find(anim->mChannels[j]->mNodeName.C_Str());
+      if (found != hierarchy.bone_indices.end()) {
+        channel_nodes[j] = found->second;
       }
-      node_map[node->mName.C_Str()] = node;
     }
 
-    std::vector<std::string> animation_node_names(anim->mNumChannels);
-    std::unordered_map<std::string, uint32_t> animation_node_map;
+    // Every channel is relative to its nearest ancestor with a channel, through the static
+    // transformations of the nodes in between
+    std::vector<uint32_t> node_channels(hierarchy.bones.size(), kNoNode);
     for (uint32_t j = 0; j < anim->mNumChannels; ++j) {
-      auto channel = anim->mChannels[j];
-      animation_node_names[j] = channel->mNodeName.C_Str();
-      animation_node_map[channel->mNodeName.C_Str()] = j;
+      if (channel_nodes[j] != kNoNode) {
+        node_channels[channel_nodes[j]] = j;
+      }
     }
+    animation->joint_parents.assign(anim->mNumChannels, Resource::Skeleton::kNoParent);
+    animation->joint_offsets.assign(anim->mNumChannels, glm::mat4(1.0f));
     for (uint32_t j = 0; j < anim->mNumChannels; ++j) {
-      auto channel = anim->mChannels[j];
-      for (uint32_t i = 0; i < animation->frame_count; i++) {
-        glm::vec3 translation =
-          glm::make_vec3(&channel->mPositionKeys[channel->mNumPositionKeys > 1 ? i : 0].mValue.x);
-        glm::quat rotation =
-          glm::quat(channel->mRotationKeys[channel->mNumRotationKeys > 1 ? i : 0].mValue.w,
-                    channel->mRotationKeys[channel->mNumRotationKeys > 1 ? i : 0].mValue.x,
-                    channel->mRotationKeys[channel->mNumRotationKeys > 1 ? i : 0].mValue.y,
-                    channel->mRotationKeys[channel->mNumRotationKeys > 1 ? i : 0].mValue.z);
-        glm::vec3 scale =
-          glm::make_vec3(&channel->mScalingKeys[channel->mNumScalingKeys > 1 ? i : 0].mValue.x);
-        animation->keyframes[i].bones[j] =
-          glm::scale(scale) * glm::translate(translation) * glm::mat4(rotation);
-      }
-    }
-
-    // Pre-multiply with parents
-    auto keyframes = animation->keyframes;
-    for (uint32_t j = 0; j < anim->mNumChannels; ++j) {
-      auto channel = anim->mChannels[j];
-      for (uint32_t i = 0; i < animation->frame_count; i++) {
-        auto model = keyframes[i].bones[j];
-        for (auto node = node_map[channel->mNodeName.C_Str()]->mParent; node != nullptr;
-             node = node->mParent) {
-          // If the parent is not animated, use the nodes
-          auto found = animation_node_map.find(node->mName.C_Str());
-          if (found == animation_node_map.end()) {
-            glm::mat4 transformation = glm::transpose(glm::make_mat4(node->mTransformation[0]));
-            model = transformation * model;
-          } else {
-            glm::mat4 transformation = animation->keyframes[i].bones[found->second];
-            model = transformation * model;
-          }
+      if (channel_nodes[j] == kNoNode) {
+        continue;
+      }
+      const auto& parents = hierarchy.skeleton.parents;
+      for (auto node = parents[channel_nodes[j]]; node != Resource::Skeleton::kNoParent;
+           node = parents[node]) {
+        if (node_channels[node] != kNoNode) {
+          animation->joint_parents[j] = node_channels[node];
+          break;
         }
-        keyframes[i].bones[j] = model;
+        animation->joint_offsets[j] = hierarchy.transformations[node] * animation->joint_offsets[j];
+      }
+    }
+    drop_identity_offsets(*animation);
+
+    animation->allocate(animation->frame_count, anim->mNumChannels);
+    for (uint32_t i = 0; i < animation->frame_count; ++i) {
+      animation->frame_times[i] = static_cast<uint32_t>(i * anim->mTicksPerSecond);
+      for (uint32_t j = 0; j < anim->mNumChannels; ++j) {
+        auto channel = anim->mChannels[j];
+        const auto& position = channel->mPositionKeys[std::min(i, channel->mNumPositionKeys - 1)];
+        const auto& rotation = channel->mRotationKeys[std::min(i, channel->mNumRotationKeys - 1)];
+        const auto& scaling = channel->mScalingKeys[std::min(i, channel->mNumScalingKeys - 1)];
+        animation->set_sample(
+          i,
+          j,
+          glm::make_vec3(&position.mValue.x),
+          glm::quat(rotation.mValue.w, rotation.mValue.x, rotation.mValue.y, rotation.mValue.z),
+          glm::make_vec3(&scaling.mValue.x));
       }
     }
-    animation->keyframes = keyframes;
 
     return animation;
   }
@@ -605,45 +1584,107 @@ struct Animation final : entt::loader<Animation, Resource::Animation>
 
 struct MotionCapture final : entt::loader<MotionCapture, Resource::MotionCapture>
 {
+  /// Adopt a motion capture converted on an import worker
+  std::shared_ptr<Resource::MotionCapture> load(
+    std::shared_ptr<Resource::MotionCapture> mocap) const
+  {
+    return mocap;
+  }
+
   std::shared_ptr<Resource::MotionCapture> load(const std::string& name,
-                                                const ezc3d::c3d& c3d) const
+                                                const Io::C3dReader& reader,
+                                                std::atomic<float>& progress) const
   {
     auto mocap = std::make_shared<Resource::MotionCapture>();
     mocap->name = name;
-    mocap->frame_rate = c3d.header().frameRate();
-    mocap->point_count = c3d.header().nb3dPoints();
-    const auto& data = c3d.data();
-    mocap->frame_points.resize(mocap->point_count * data.nbFrames());
-
-    for (uint32_t i = 0; i < data.nbFrames(); ++i) {
-      const auto& frame = data.frame(i);
-      const auto& points = frame.points();
-      assert(points.nbPoints() == mocap->point_count);
-      for (uint32_t j = 0; j < mocap->point_count; ++j) {
-        mocap->frame_points[i * mocap->point_count + j].x = points.point(j).x();
-        mocap->frame_points[i * mocap->point_count + j].y = points.point(j).z();
-        mocap->frame_points[i * mocap->point_count + j].z = points.point(j).y();
-      }
+    mocap->frame_rate = reader.frame_rate();
+    mocap->point_count = reader.point_count();
+    // Frames are decoded straight into place, this is the only allocation proportional to them
+    mocap->frame_points.resize(size_t{ reader.point_count() } * reader.frame_count());
+    if (!reader.read_points(mocap->frame_points.data(),
+                            [&progress](float fraction) { progress = fraction; })) {
+      return nullptr;
     }
-
     return mocap;
   }
 };
 } // namespace AnimationViewer::Loader
 
+struct ResourceManager::ImportSource
+{
+  /// File to import, or the name given to a buffer which stands in for its path
+  std::filesystem::path path;
+  /// Set when importing from memory instead of from the file at path
+  std::optional<std::span<const uint8_t>> contents;
+};
+
+struct ResourceManager::ImportResult
+{
+  Ticket ticket;
+  std::shared_ptr<ImportStatus> status;
+  FbxImporter fbx_importer;
+  AssimpProfile assimp_profile;
+  bool optimize_meshes;
+  bool split_large_meshes;
+  bool generate_lods;
+  Resource::Animation::Layout animation_layout;
+  bool compress_animations;
+  Resource::Animation::Tolerances animation_tolerances;
+  bool success;
+  Io::AssetCache::MeshList meshes;
+  Io::AssetCache::AnimationList animations;
+  std::vector<std::pair<ENTT_ID_TYPE, std::shared_ptr<Resource::MotionCapture>>> motion_captures;
+  std::vector<std::pair<std::string, float>> phases;
+  std::string error;
+  std::vector<ImportStatus::MeshOptimization> optimized_meshes;
+  std::vector<ImportStatus::AnimationCompression> compressed_animations;
+};
+
+ResourceManager::ImportStatus::ImportStatus(std::string file_name)
+  : name(std::move(file_name))
+  , state(State::Queued)
+  , progress(0.0f)
+  , cache_hit(false)
+  , importer("")
+  , duration(0.0f)
+{}
+
 std::unique_ptr<ResourceManager>
 ResourceManager::create()
 {
   entt::cache<Resource::Mesh> mesh_cache{};
   entt::cache<Resource::Animation> animation_cache{};
-  return std::unique_ptr<ResourceManager>(
-    new ResourceManager(std::move(mesh_cache), std::move(animation_cache)));
+  // Importing still works without a cache, just not faster the second time
+  auto asset_cache = Io::AssetCache::create();
+  auto import_pool = Threading::ThreadPool::create();
+  if (!import_pool) {
+    return nullptr;
+  }
+  return std::unique_ptr<ResourceManager>(new ResourceManager(std::move(mesh_cache),
+                                                              std::move(animation_cache),
+                                                              std::move(asset_cache),
+                                                              std::move(import_pool)));
 }
 
 ResourceManager::ResourceManager(entt::cache<Resource::Mesh>&& mesh_cache,
-                                 entt::cache<Resource::Animation>&& animation_cache)
+                                 entt::cache<Resource::Animation>&& animation_cache,
+                                 std::unique_ptr<Io::AssetCache>&& asset_cache,
+                                 std::unique_ptr<Threading::ThreadPool>&& import_pool)
   : mesh_cache_(std::move(mesh_cache))
   , animation_cache_(std::move(animation_cache))
+  , finished_imports_(std::make_unique<Threading::MpscQueue<ImportResult>>())
+  , next_ticket_(0)
+  , fbx_importer_(FbxImporter::OpenFbx)
+  , assimp_profile_(AssimpProfile::MaxQuality)
+  , optimize_meshes_(true)
+  , split_large_meshes_(true)
+  , generate_lods_(true)
+  , animation_layout_(Resource::Animation::Layout::FrameMajor)
+  , compress_animations_(true)
+  , animation_tolerances_{ kPositionTolerance, kRotationTolerance, kScaleTolerance }
+  , pose_cache_frames_(kPoseCacheFrames)
+  , asset_cache_(std::move(asset_cache))
+  , import_pool_(std::move(import_pool))
 {}
 
 ResourceManager::~ResourceManager() = default;
@@ -653,7 +1694,12 @@ ResourceManager::upload_dirty_buffers(Graphics::Renderer& renderer)
 {
   mesh_cache_.each([&renderer](Resource::Mesh& res) {
     if (!res.gpu_resource) {
-      res.gpu_resource = renderer.upload_mesh(res.vertices, res.indices);
+      res.gpu_resource = renderer.upload_mesh(res);
+    }
+  });
+  motion_capture_cache_.each([&renderer](Resource::MotionCapture& res) {
+    if (res.gpu_resources.empty() && !res.frame_points.empty()) {
+      res.gpu_resources = renderer.upload_motion_capture(res);
     }
   });
 }
@@ -676,129 +1722,610 @@ ResourceManager::motion_capture_cache() const
   return motion_capture_cache_;
 }
 
-std::vector<std::pair<entt::hashed_string, ResourceManager::Type>>
+std::shared_ptr<Resource::PoseCache>
+ResourceManager::acquire_pose_cache(ENTT_ID_TYPE mesh_id, ENTT_ID_TYPE animation_id)
+{
+  if (auto cache = pose_caches_[{ mesh_id, animation_id }].lock()) {
+    return cache;
+  }
+  // Entries of released caches are only dropped here, there are never many of them
+  std::erase_if(pose_caches_, [](const auto& cache) { return cache.second.expired(); });
+
+  auto cache = std::make_shared<Resource::PoseCache>();
+  cache->mesh_id = mesh_id;
+  cache->animation_id = animation_id;
+  cache->capacity = pose_cache_frames_;
+  set_up_pose_cache(*mesh_cache_.handle(mesh_id), *animation_cache_.handle(animation_id), *cache);
+  pose_caches_[{ mesh_id, animation_id }] = cache;
+  return cache;
+}
+
+void
+ResourceManager::set_pose_cache_frames(uint32_t frames)
+{
+  pose_cache_frames_ = frames;
+}
+
+uint32_t
+ResourceManager::pose_cache_frames() const
+{
+  return pose_cache_frames_;
+}
+
+ResourceManager::Ticket
 ResourceManager::load_file(const std::filesystem::path& path)
 {
-  switch (detect_file_type(path)) {
-    case FileType::L3D: {
-      auto mesh = load_l3d_file(path);
-      if (mesh.has_value()) {
-        return { std::make_pair(*mesh, Type::Mesh) };
-      }
-    } break;
-    case FileType::ANM: {
-      auto animation = load_anm_file(path);
-      if (animation.has_value()) {
-        return { std::make_pair(*animation, Type::Animation) };
-      }
-    } break;
-    case FileType::C3D: {
-      auto mocap = load_c3d_file(path);
-      if (mocap.has_value()) {
-        return { std::make_pair(*mocap, Type::MotionCapture) };
-      }
-    } break;
+  return queue_import({ path, std::nullopt });
+}
+
+ResourceManager::Ticket
+ResourceManager::load_buffer(std::span<const uint8_t> contents, const std::string& name)
+{
+  return queue_import({ name, contents });
+}
+
+ResourceManager::Ticket
+ResourceManager::queue_import(ImportSource&& source)
+{
+  auto ticket = next_ticket_++;
+  auto status = std::make_shared<ImportStatus>(source.path.filename().string());
+  imports_.push_back(status);
+
+  import_pool_->submit([this,
+                        source = std::move(source),
+                        ticket,
+                        status,
+                        fbx_importer = fbx_importer_,
+                        assimp_profile = assimp_profile_,
+                        optimize_meshes = optimize_meshes_,
+                        split_large_meshes = split_large_meshes_,
+                        generate_lods = generate_lods_,
+                        animation_layout = animation_layout_,
+                        compress_animations = compress_animations_,
+                        animation_tolerances = animation_tolerances_]() {
+    status->state = ImportStatus::State::Running;
+    ImportResult result{
+      .ticket = ticket,
+      .status = status,
+      .fbx_importer = fbx_importer,
+      .assimp_profile = assimp_profile,
+      .optimize_meshes = optimize_meshes,
+      .split_large_meshes = split_large_meshes,
+      .generate_lods = generate_lods,
+      .animation_layout = animation_layout,
+      .compress_animations = compress_animations,
+      .animation_tolerances = animation_tolerances,
+      .success = false,
+      .meshes = {},
+      .animations = {},
+      .motion_captures = {},
+      .phases = {},
+      .error = {},
+      .optimized_meshes = {},
+      .compressed_animations = {},
+    };
+    auto start = std::chrono::steady_clock::now();
+    result.success = import_file(source, result);
+    if (result.success) {
+      post_process_meshes(result);
+      post_process_animations(result);
+    }
+    status->duration =
+      std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    status->progress = 1.0f;
+    finished_imports_->push(std::move(result));
+  });
+
+  return ticket;
+}
+
+std::vector<ResourceManager::FinishedImport>
+ResourceManager::finish_imports()
+{
+  std::vector<FinishedImport> finished;
+  while (auto result = finished_imports_->pop()) {
+    auto& entry = finished.emplace_back();
+    entry.ticket = result->ticket;
+    for (auto& [id, mesh] : result->meshes) {
+      mesh_cache_.load<Loader::Mesh>(id, std::move(mesh));
+      entry.resources.emplace_back(id, Type::Mesh);
+    }
+    for (auto& [id, animation] : result->animations) {
+      animation_cache_.load<Loader::Animation>(id, std::move(animation));
+      entry.resources.emplace_back(id, Type::Animation);
+    }
+    for (auto& [id, mocap] : result->motion_captures) {
+      motion_capture_cache_.load<Loader::MotionCapture>(id, std::move(mocap));
+      entry.resources.emplace_back(id, Type::MotionCapture);
+    }
+    result->status->phases = std::move(result->phases);
+    result->status->error = std::move(result->error);
+    result->status->optimized_meshes = std::move(result->optimized_meshes);
+    result->status->compressed_animations = std::move(result->compressed_animations);
+    result->status->state =
+      result->success ? ImportStatus::State::Finished : ImportStatus::State::Failed;
+  }
+  return finished;
+}
+
+const std::vector<std::shared_ptr<ResourceManager::ImportStatus>>&
+ResourceManager::imports() const
+{
+  return imports_;
+}
+
+void
+ResourceManager::clear_finished_imports()
+{
+  imports_.erase(std::remove_if(imports_.begin(),
+                                imports_.end(),
+                                [](const auto& status) {
+                                  auto state = status->state.load();
+                                  return state == ImportStatus::State::Finished ||
+                                         state == ImportStatus::State::Failed;
+                                }),
+                 imports_.end());
+}
+
+void
+ResourceManager::set_fbx_importer(FbxImporter importer)
+{
+  fbx_importer_ = importer;
+}
+
+ResourceManager::FbxImporter
+ResourceManager::fbx_importer() const
+{
+  return fbx_importer_;
+}
+
+void
+ResourceManager::set_assimp_profile(AssimpProfile profile)
+{
+  assimp_profile_ = profile;
+}
+
+ResourceManager::AssimpProfile
+ResourceManager::assimp_profile() const
+{
+  return assimp_profile_;
+}
+
+void
+ResourceManager::set_optimize_meshes(bool optimize)
+{
+  optimize_meshes_ = optimize;
+}
+
+bool
+ResourceManager::optimize_meshes() const
+{
+  return optimize_meshes_;
+}
+
+void
+ResourceManager::set_split_large_meshes(bool split)
+{
+  split_large_meshes_ = split;
+}
+
+bool
+ResourceManager::split_large_meshes() const
+{
+  return split_large_meshes_;
+}
+
+void
+ResourceManager::set_generate_lods(bool generate)
+{
+  generate_lods_ = generate;
+}
+
+bool
+ResourceManager::generate_lods() const
+{
+  return generate_lods_;
+}
+
+void
+ResourceManager::set_animation_layout(Resource::Animation::Layout layout)
+{
+  animation_layout_ = layout;
+}
+
+Resource::Animation::Layout
+ResourceManager::animation_layout() const
+{
+  return animation_layout_;
+}
+
+void
+ResourceManager::set_compress_animations(bool compress)
+{
+  compress_animations_ = compress;
+}
+
+bool
+ResourceManager::compress_animations() const
+{
+  return compress_animations_;
+}
+
+void
+ResourceManager::set_animation_tolerances(const Resource::Animation::Tolerances& tolerances)
+{
+  animation_tolerances_ = tolerances;
+}
+
+const Resource::Animation::Tolerances&
+ResourceManager::animation_tolerances() const
+{
+  return animation_tolerances_;
+}
+
+void
+ResourceManager::post_process_meshes(ImportResult& result) const
+{
+  for (auto& mesh : result.meshes) {
+    compute_bounds(*mesh.second);
+    mesh.second->skeleton.build(mesh.second->bones);
+  }
+  // All of it runs after the asset cache, which keeps the meshes as imported whatever the settings
+  PhaseTimer timer(result.phases);
+  if ((result.optimize_meshes || result.generate_lods) && !result.meshes.empty()) {
+    result.optimized_meshes.resize(result.meshes.size());
+    import_pool_->parallel_for(static_cast<uint32_t>(result.meshes.size()), [&](uint32_t i) {
+      auto& mesh = *result.meshes[i].second;
+      auto& report = result.optimized_meshes[i];
+      report.mesh = mesh.name;
+      report.vertices_before = static_cast<uint32_t>(mesh.vertices.size());
+      report.acmr_before =
+        Geometry::average_cache_miss_ratio(lod_indices(mesh, 0), mesh.vertices.size());
+      // Simplification finds neighbouring triangles through shared vertices, so it welds too
+      Geometry::weld_vertices(mesh.vertices, mesh.indices);
+      if (result.generate_lods) {
+        simplify_into_lods(mesh);
+      }
+      if (result.optimize_meshes) {
+        for (size_t lod = 0; lod < std::max<size_t>(mesh.lods.size(), 1); ++lod) {
+          Geometry::optimize_vertex_cache(lod_indices(mesh, lod), mesh.vertices.size());
+        }
+        Geometry::optimize_vertex_fetch(mesh.vertices, mesh.indices);
+      }
+      report.vertices_after = static_cast<uint32_t>(mesh.vertices.size());
+      report.acmr_after =
+        Geometry::average_cache_miss_ratio(lod_indices(mesh, 0), mesh.vertices.size());
+      for (size_t lod = 0; lod < std::max<size_t>(mesh.lods.size(), 1); ++lod) {
+        report.lod_triangles.push_back(static_cast<uint32_t>(lod_indices(mesh, lod).size() / 3));
+      }
+    });
+    timer.finish(result.generate_lods ? "Optimize meshes and generate LODs" : "Optimize meshes");
+  }
+  // Splitting keeps the triangle order and the levels of detail, so the submeshes stay optimized
+  if (result.split_large_meshes) {
+    for (auto& mesh : result.meshes) {
+      split_into_submeshes(*mesh.second);
+    }
+    timer.finish("Split submeshes");
+  }
+}
+
+void
+ResourceManager::post_process_animations(ImportResult& result) const
+{
+  // Loaders and the asset cache produce frame major samples
+  for (auto& animation : result.animations) {
+    animation.second->set_layout(result.animation_layout);
+  }
+  if (!result.compress_animations || result.animations.empty()) {
+    return;
+  }
+  PhaseTimer timer(result.phases);
+  result.compressed_animations.resize(result.animations.size());
+  import_pool_->parallel_for(static_cast<uint32_t>(result.animations.size()), [&](uint32_t i) {
+    auto& animation = *result.animations[i].second;
+    animation.compress(result.animation_tolerances);
+    auto& report = result.compressed_animations[i];
+    report.animation = animation.name;
+    if (animation.compressed) {
+      const auto& statistics = animation.compressed->statistics();
+      report.raw_bytes = statistics.raw_bytes;
+      report.compressed_bytes = statistics.compressed_bytes;
+      report.max_position_error = statistics.max_position_error;
+      report.max_rotation_error = statistics.max_rotation_error;
+      report.max_scale_error = statistics.max_scale_error;
+    }
+  });
+  timer.finish("Compress animations");
+}
+
+bool
+ResourceManager::import_file(const ImportSource& source, ImportResult& result) const
+{
+  FileType file_type;
+  if (source.contents) {
+    auto head = source.contents->first(std::min(kMagicSize, source.contents->size()));
+    file_type = detect_file_type(source.path, head);
+  } else {
+    file_type = detect_file_type(source.path);
+  }
+  // Native formats map straight into resources, caching them would only add the hashing
+  switch (file_type) {
+    case FileType::L3D:
+      result.status->importer = "L3D";
+      return load_l3d_file(source, result);
+    case FileType::ANM:
+      result.status->importer = "ANM";
+      return load_anm_file(source, result);
+    case FileType::C3D:
+      result.status->importer = "C3D";
+      return load_c3d_file(source, result);
     case FileType::BVH:
-      return load_assimp_file(path, true);
+      result.status->importer = "BVH";
+      return load_bvh_file(source, result);
     case FileType::FBX:
     case FileType::Unknown:
     default:
-      return load_assimp_file(path, false);
+      break;
+  }
+
+  auto importer = file_type == FileType::FBX && result.fbx_importer == FbxImporter::OpenFbx
+                    ? CachedImporter::OpenFbx
+                    : CachedImporter::Assimp;
+  result.status->importer = importer == CachedImporter::OpenFbx ? "OpenFBX" : "Assimp";
+
+  // The Assimp profile changes what is converted, entries of different profiles must not mix
+  auto cache_importer = static_cast<uint32_t>(importer);
+  if (importer == CachedImporter::Assimp) {
+    cache_importer |= (static_cast<uint32_t>(result.assimp_profile) + 1) << 8u;
+  }
+  // Buffers have no file to key the cache on
+  std::optional<Io::AssetCache::Key> cache_key;
+  if (asset_cache_ && !source.contents) {
+    cache_key = asset_cache_->make_key(source.path, cache_importer);
   }
-  return {};
+  if (cache_key && asset_cache_->load(*cache_key, result.meshes, result.animations)) {
+    result.status->cache_hit = true;
+    return true;
+  }
+
+  bool loaded = importer == CachedImporter::OpenFbx
+                  ? load_fbx_file(source, result)
+                  : load_assimp_file(source, result.assimp_profile, result);
+  if (!loaded) {
+    return false;
+  }
+  // A failed store only means the next import of this file converts again
+  if (cache_key) {
+    asset_cache_->store(*cache_key, result.meshes, result.animations);
+  }
+  return true;
 }
 
-std::optional<entt::hashed_string>
-ResourceManager::load_l3d_file(const std::filesystem::path& path)
+bool
+ResourceManager::load_l3d_file(const ImportSource& source, ImportResult& result) const
 {
+  const auto& path = source.path;
   openblack::l3d::L3DFile l3d;
-  l3d.Open(path.string());
-  auto id = entt::hashed_string{ path.string().c_str() };
-  mesh_cache_.load<Loader::Mesh>(id, path.filename().string(), l3d);
-  return std::make_optional(id);
+  // The library reports malformed files with exceptions, which this code is built without
+  bool opened = source.contents
+                  ? l3d.TryOpen(source.contents->data(), source.contents->size(), result.error)
+                  : l3d.TryOpen(path.string(), result.error);
+  if (!opened) {
+    return false;
+  }
+  result.status->progress = 0.5f;
+  ENTT_ID_TYPE id = entt::hashed_string{ path.string().c_str() };
+  result.meshes.emplace_back(id, Loader::Mesh{}.load(path.filename().string(), l3d));
+  return true;
 }
 
-std::vector<std::pair<entt::hashed_string, ResourceManager::Type>>
-ResourceManager::load_fbx_file(const std::filesystem::path& path)
+bool
+ResourceManager::load_fbx_file(const ImportSource& source, ImportResult& result) const
 {
-  std::vector<uint8_t> contents;
-  FILE* fp = fopen(path.string().c_str(), "rb");
-  fseek(fp, 0, SEEK_END);
-  contents.resize(ftell(fp));
-  fseek(fp, 0, SEEK_SET);
-  fread(contents.data(), 1, contents.size(), fp);
-
-  auto fbx = ofbx::load(contents.data(),
-                        contents.size(),
-                        ofbx::LoadFlags::TRIANGULATE | ofbx::LoadFlags::IGNORE_BLEND_SHAPES);
-
-  std::vector<std::pair<entt::hashed_string, ResourceManager::Type>> result;
-
+  const auto& path = source.path;
+  PhaseTimer timer(result.phases);
+  ofbx::IScene* fbx = nullptr;
+  {
+    // OpenFBX copies the contents, the mapping is only needed while it parses
+    std::unique_ptr<Io::MappedFile> file;
+    auto contents = source.contents.value_or(std::span<const uint8_t>());
+    if (!source.contents) {
+      file = Io::MappedFile::create(path);
+      if (!file) {
+        return false;
+      }
+      contents = { file->data(), file->size() };
+    }
+    if (contents.size() > static_cast<size_t>(std::numeric_limits<int>::max())) {
+      return false;
+    }
+    fbx = ofbx::load(contents.data(),
+                     static_cast<int>(contents.size()),
+                     ofbx::LoadFlags::TRIANGULATE | ofbx::LoadFlags::IGNORE_BLEND_SHAPES,
+                     fbx_job_processor,
+                     import_pool_.get());
+  }
+  if (fbx == nullptr) {
+    return false;
+  }
+  timer.finish("Parse");
+  result.status->progress = 0.5f;
+
+  auto mesh_count = static_cast<uint32_t>(fbx->getMeshCount());
+  auto stack_count = static_cast<uint32_t>(fbx->getAnimationStackCount());
+  auto total = mesh_count + stack_count;
+  std::atomic<uint32_t> converted = 0;
+  // Numbered up front so unnamed meshes get the same ids whichever converts first
+  result.meshes.resize(mesh_count);
   uint32_t unnamed_count = 0;
-  for (int i = 0; i < fbx->getMeshCount(); ++i) {
-    const ofbx::Mesh* mesh = fbx->getMesh(i);
-    std::string name = mesh->name;
+  for (uint32_t i = 0; i < mesh_count; ++i) {
+    std::string name = fbx->getMesh(static_cast<int>(i))->name;
     if (name.empty()) {
       unnamed_count++;
       name = path.string() + " unnamed " + std::to_string(unnamed_count);
     }
-    auto id = entt::hashed_string{ name.c_str() };
-    mesh_cache_.load<Loader::Mesh>(id, mesh);
-    result.emplace_back(id, Type::Mesh);
+    result.meshes[i].first = entt::hashed_string{ name.c_str() };
   }
+  import_pool_->parallel_for(mesh_count, [&](uint32_t i) {
+    result.meshes[i].second = Loader::Mesh{}.load(fbx->getMesh(static_cast<int>(i)));
+    result.status->progress = 0.5f + 0.5f * ++converted / total;
+  });
+  timer.finish("Convert meshes");
+  result.animations.resize(stack_count);
+  import_pool_->parallel_for(stack_count, [&](uint32_t i) {
+    const ofbx::AnimationStack* stack = fbx->getAnimationStack(static_cast<int>(i));
+    std::string name = path.filename().string() + ":" + stack->name;
+    ENTT_ID_TYPE id = entt::hashed_string{ name.c_str() };
+    result.animations[i] = { id, Loader::Animation{}.load(name, *fbx, *stack) };
+    result.status->progress = 0.5f + 0.5f * ++converted / total;
+  });
+  // Stacks without any animated object are skipped
+  std::erase_if(result.animations, [](const auto& animation) { return !animation.second; });
+  timer.finish("Convert animations");
+  fbx->destroy();
 
-  return result;
+  return true;
 }
 
-std::optional<entt::hashed_string>
-ResourceManager::load_anm_file(const std::filesystem::path& path)
+bool
+ResourceManager::load_anm_file(const ImportSource& source, ImportResult& result) const
 {
+  const auto& path = source.path;
   openblack::anm::ANMFile anm;
-  anm.Open(path.string());
-  auto id = entt::hashed_string{ path.string().c_str() };
-  animation_cache_.load<Loader::Animation>(id, path.filename().string(), anm);
-  return std::make_optional(id);
+  bool opened = source.contents
+                  ? anm.TryOpen(source.contents->data(), source.contents->size(), result.error)
+                  : anm.TryOpen(path.string(), result.error);
+  if (!opened) {
+    return false;
+  }
+  result.status->progress = 0.5f;
+  ENTT_ID_TYPE id = entt::hashed_string{ path.string().c_str() };
+  result.animations.emplace_back(id, Loader::Animation{}.load(path.filename().string(), anm));
+  return true;
 }
 
-std::optional<entt::hashed_string>
-ResourceManager::load_bvh_file(const std::filesystem::path& path)
+bool
+ResourceManager::load_bvh_file(const ImportSource& source, ImportResult& result) const
 {
-  k::Bvh bvh;
-  {
-    k::BvhLoader bvhLoader;
-    bvhLoader.load(&bvh, path.filename().string());
+  const auto& path = source.path;
+  auto reader = source.contents ? Io::BvhReader::create(*source.contents)
+                                : Io::BvhReader::create(path);
+  if (!reader) {
+    return false;
+  }
+  auto animation =
+    Loader::Animation{}.load(path.filename().string(), *reader, result.status->progress);
+  if (!animation) {
+    return false;
   }
-  auto id = entt::hashed_string{ path.string().c_str() };
-  animation_cache_.load<Loader::Animation>(id, path.filename().string(), bvh);
-  return std::make_optional(id);
+  ENTT_ID_TYPE id = entt::hashed_string{ path.string().c_str() };
+  result.animations.emplace_back(id, std::move(animation));
+  return true;
 }
 
-std::optional<entt::hashed_string>
-ResourceManager::load_c3d_file(const std::filesystem::path& path)
+bool
+ResourceManager::load_c3d_file(const ImportSource& source, ImportResult& result) const
 {
-  ezc3d::c3d c3d(path.string());
-  auto id = entt::hashed_string{ path.string().c_str() };
-  motion_capture_cache_.load<Loader::MotionCapture>(id, path.filename().string(), c3d);
-  return std::make_optional(id);
+  const auto& path = source.path;
+  auto reader = source.contents ? Io::C3dReader::create(*source.contents)
+                                : Io::C3dReader::create(path);
+  if (!reader) {
+    return false;
+  }
+  auto mocap =
+    Loader::MotionCapture{}.load(path.filename().string(), *reader, result.status->progress);
+  if (!mocap) {
+    return false;
+  }
+  ENTT_ID_TYPE id = entt::hashed_string{ path.string().c_str() };
+  result.motion_captures.emplace_back(id, std::move(mocap));
+  return true;
 }
 
-std::vector<std::pair<entt::hashed_string, ResourceManager::Type>>
-ResourceManager::load_assimp_file(const std::filesystem::path& path, bool skip_meshes)
+bool
+ResourceManager::load_assimp_file(const ImportSource& source,
+                                  AssimpProfile profile,
+                                  ImportResult& result) const
 {
-  auto scene = aiImportFile(path.string().c_str(), aiProcessPreset_TargetRealtime_MaxQuality);
-  std::vector<std::pair<entt::hashed_string, ResourceManager::Type>> result;
-  for (uint32_t i = 0; i < scene->mNumAnimations; ++i) {
-    std::string name = path.filename().string() + ":" + scene->mAnimations[i]->mName.C_Str();
-    auto id = entt::hashed_string{ name.c_str() };
-    animation_cache_.load<Loader::Animation>(id, name, scene->mAnimations[i], scene->mRootNode);
+  const auto& path = source.path;
+  PhaseTimer timer(result.phases);
+  // Owns the scene, and its properties can change between post-processing steps
+  Assimp::Importer importer;
+  const aiScene* scene;
+  if (source.contents) {
+    if (source.contents->size() > std::numeric_limits<unsigned int>::max()) {
+      return false;
+    }
+    // Formats without a magic number are only recognised by the extension
+    auto hint = path.extension().string();
+    scene = importer.ReadFileFromMemory(source.contents->data(),
+                                        source.contents->size(),
+                                        0,
+                                        hint.empty() ? "" : hint.c_str() + 1);
+  } else {
+    // Files can reference others next to them, like materials or buffers, so Assimp opens them
+    scene = importer.ReadFile(path.string(), 0);
   }
+  if (scene == nullptr) {
+    result.error = importer.GetErrorString();
+    return false;
+  }
+  timer.finish("Read");
+  result.status->progress = 0.25f;
+
+  // One step per call so each can be timed, in the order Assimp would run them in
+  auto steps = assimp_steps(profile);
+  bool split_by_triangles = true;
+  for (size_t i = 0; i < kAssimpSteps.size(); ++i) {
+    if ((steps & kAssimpSteps[i].first) == 0) {
+      continue;
+    }
+    if (kAssimpSteps[i].first == aiProcess_SplitLargeMeshes) {
+      // The flag runs both passes, lifting the limit of one leaves only the other to split
+      constexpr int kNoLimit = std::numeric_limits<int>::max();
+      importer.SetPropertyInteger(AI_CONFIG_PP_SLM_TRIANGLE_LIMIT,
+                                  split_by_triangles ? AI_SLM_DEFAULT_MAX_TRIANGLES : kNoLimit);
+      importer.SetPropertyInteger(AI_CONFIG_PP_SLM_VERTEX_LIMIT,
+                                  split_by_triangles ? kNoLimit : AI_SLM_DEFAULT_MAX_VERTICES);
+      split_by_triangles = false;
+    }
+    // Assimp releases the scene itself when a step fails
+    scene = importer.ApplyPostProcessing(kAssimpSteps[i].first);
+    if (scene == nullptr) {
+      result.error = importer.GetErrorString();
+      return false;
+    }
+    timer.finish(kAssimpSteps[i].second);
+    result.status->progress = 0.25f + 0.25f * (i + 1) / kAssimpSteps.size();
+  }
+  result.status->progress = 0.5f;
+
+  Loader::AssimpHierarchy hierarchy(scene->mRootNode);
+  timer.finish("Build hierarchy");
+
+  // Every mesh and animation converts independently on the pool, into its own slot
+  // Animations only need the node hierarchy, which no post-processing step changes
+  bool skip_meshes = profile == AssimpProfile::AnimationOnly;
+  uint32_t total = scene->mNumAnimations + (skip_meshes ? 0 : scene->mNumMeshes);
+  std::atomic<uint32_t> converted = 0;
+  result.animations.resize(scene->mNumAnimations);
+  import_pool_->parallel_for(scene->mNumAnimations, [&](uint32_t i) {
+    std::string name = path.filename().string() + ":" + scene->mAnimations[i]->mName.C_Str();
+    ENTT_ID_TYPE id = entt::hashed_string{ name.c_str() };
+    result.animations[i] = { id, Loader::Animation{}.load(name, scene->mAnimations[i], hierarchy) };
+    result.status->progress = 0.5f + 0.5f * ++converted / total;
+  });
+  timer.finish("Convert animations");
   if (!skip_meshes) {
-    for (uint32_t i = 0; i < scene->mNumMeshes; ++i) {
+    result.meshes.resize(scene->mNumMeshes);
+    import_pool_->parallel_for(scene->mNumMeshes, [&](uint32_t i) {
       std::string name = path.filename().string() + ":" + scene->mMeshes[i]->mName.C_Str();
-      auto id = entt::hashed_string{ name.c_str() };
-      mesh_cache_.load<Loader::Mesh>(id, name, scene->mMeshes[i], scene->mRootNode);
-    }
+      ENTT_ID_TYPE id = entt::hashed_string{ name.c_str() };
+      result.meshes[i] = { id, Loader::Mesh{}.load(name, scene->mMeshes[i], hierarchy) };
+      result.status->progress = 0.5f + 0.5f * ++converted / total;
+    });
+    timer.finish("Convert meshes");
   }
-  aiReleaseImport(scene);
-  return {};
+  return true;
 }
@@ -46,23 +46,34 @@ Scene::update(ResourceManager& resource_manager, std::chrono::microseconds& dt)
 {
   registry_.view<Components::Animation>().each(
     [&resource_manager, &dt](auto entity, Components::Animation& animation) {
-      if (!animation.animating) {
-        return;
-      }
-
       const auto& current_animation = resource_manager.animation_cache().handle(animation.id);
-      animation.current_frame = animation.current_time * current_animation->frame_rate;
-      if (animation.current_frame > current_animation->frame_count - 1) {
-        if (animation.loop) {
-          animation.current_frame = 0;
-          animation.current_time = 0;
-        } else {
-          animation.current_frame = current_animation->frame_count - 1;
+      if (animation.animating) {
+        animation.current_frame = animation.current_time * current_animation->frame_rate;
+        if (animation.current_frame > current_animation->frame_count - 1) {
+          if (animation.loop) {
+            animation.current_frame = 0;
+            animation.current_time = 0;
+          } else {
+            animation.current_frame = current_animation->frame_count - 1;
+          }
+          animation.animating = animation.loop;
         }
-        animation.animating = animation.loop;
+
+        animation.current_time += dt.count();
       }
 
-      animation.current_time += dt.count();
+      // Only the frames which are shown are evaluated, paused or not
+      if (animation.evaluated_frame == animation.current_frame ||
+          current_animation->frame_count == 0) {
+        return;
+      }
+      auto& poses = *animation.poses;
+      auto current_pose = poses.pose(*current_animation, animation.current_frame);
+      animation.current_pose.assign(current_pose.begin(), current_pose.end());
+      auto next_frame = (animation.current_frame + 1) % current_animation->frame_count;
+      auto next_pose = poses.pose(*current_animation, next_frame);
+      animation.next_pose.assign(next_pose.begin(), next_pose.end());
+      animation.evaluated_frame = animation.current_frame;
     });
 
   registry_.view<Components::MotionCaptureAnimation>().each(
@@ -196,30 +207,7 @@ Scene::add_mesh(ENTT_ID_TYPE id,
 {
   const auto& mesh = resource_manager.mesh_cache().handle(id);
 
-  std::vector<glm::mat4> armature;
-  armature.reserve(mesh->bones.size());
-  for (size_t i = 0; i < mesh->bones.size(); i++) {
-    const bone_t& bone = mesh->bones[i];
-    glm::mat4 rot = glm::mat4(bone.orientation);
-    glm::mat4 trans =
-      glm::translate(glm::mat4(1.0f), { bone.position.x, bone.position.y, bone.position.z });
-    glm::mat4 trans_rot = trans * rot;
-
-    int parent_id = bone.parent;
-    while (parent_id != -1) {
-      const bone_t& parent_bone = mesh->bones[parent_id];
-
-      glm::mat4 parent_trans = glm::translate(parent_bone.position);
-      glm::mat4 parent_rot = glm::mat4(parent_bone.orientation);
-      glm::mat4 parent_trans_rot = parent_trans * parent_rot;
-      trans_rot = parent_trans_rot * trans_rot;
-
-      parent_id = parent_bone.parent;
-    }
-
-    // mesh entity data add
-    armature.push_back(trans_rot);
-  }
+  const auto& armature = mesh->skeleton.rest_global;
 
   // construct a naked entity with no components (like a GameObject in Unity) and return its
   // identifier
@@ -263,70 +251,13 @@ Scene::add_mesh(ENTT_ID_TYPE id,
 bool
 Scene::attach_animation(const entt::entity& entity,
                         ENTT_ID_TYPE id,
-                        const ResourceManager& resource_manager)
+                        ResourceManager& resource_manager)
 {
-  const auto animation_resource = resource_manager.animation_cache().handle(id);
-
-  auto& armature = registry_.get<Components::Armature>(entity);
-  if (armature.joints.size() != animation_resource->keyframes[0].bones.size()) {
-    auto& animation = registry_.emplace<Components::Animation>(entity, id);
-    animation.loop = true;
-    animation.animating = true;
-    auto& mesh = registry_.get<Components::Mesh>(entity);
-    const auto& mesh_resource = resource_manager.mesh_cache().handle(mesh.id);
-
-    std::unordered_map<std::string, uint32_t> bone_map;
-    for (uint32_t i = 0; i < mesh_resource->bones.size(); ++i) {
-      bone_map.emplace(mesh_resource->bones[i].name, i);
-    }
-
-    animation.transformed_matrices.resize(animation_resource->keyframes.size());
-    for (uint32_t i = 0; i < animation_resource->keyframes.size(); ++i) {
-      animation.transformed_matrices[i].resize(armature.joints.size());
-      for (uint32_t j = 0; j < armature.joints.size(); ++j) {
-        animation.transformed_matrices[i][j] = armature.joints[j];
-      }
-      for (uint32_t j = 0; j < animation_resource->joint_names.size(); ++j) {
-        auto name = animation_resource->joint_names[j];
-        auto found = bone_map.find(name);
-        if (found != bone_map.end()) {
-          printf("%s\n", name.c_str());
-          animation.transformed_matrices[i][found->second] =
-            animation_resource->keyframes[i].bones[j];
-        }
-      }
-    }
-
-  } else {
-
-    auto& animation = registry_.emplace<Components::Animation>(entity, id);
-    animation.loop = true;
-    animation.animating = true;
-    auto& mesh = registry_.get<Components::Mesh>(entity);
-    const auto& mesh_resource = resource_manager.mesh_cache().handle(mesh.id);
-
-    animation.transformed_matrices.reserve(animation_resource->keyframes.size());
-    for (uint32_t i = 0; i < animation_resource->keyframes.size(); i++) {
-      animation.transformed_matrices.push_back(std::vector<glm::mat4>());
-      animation.transformed_matrices[i].reserve(animation_resource->keyframes[i].bones.size());
-      for (uint32_t j = 0; j < animation_resource->keyframes[i].bones.size(); j++) {
-        int parent_id = mesh_resource->bones[j].parent;
-
-        auto transformed_mat = animation_resource->keyframes[i].bones[j];
-
-        while (parent_id != -1) {
-          const bone_t& parent_bone = mesh_resource->bones[parent_id];
-          const glm::mat4 parent_joint = animation_resource->keyframes[i].bones[parent_id];
-
-          transformed_mat = parent_joint * transformed_mat;
-
-          parent_id = parent_bone.parent;
-        }
-
-        animation.transformed_matrices[i].push_back(transformed_mat);
-      }
-    }
-  }
+  auto& mesh = registry_.get<Components::Mesh>(entity);
+  auto& animation = registry_.emplace<Components::Animation>(entity, id);
+  animation.loop = true;
+  animation.animating = true;
+  animation.poses = resource_manager.acquire_pose_cache(mesh.id, id);
 
   // Can't have both animation and mocap animation
   if (registry_.has<Components::MotionCaptureAnimation>(entity)) {
@@ -1,5 +1,7 @@
 #include "ui.h"
 
+#include <algorithm>
+#include <array>
 #include <map>
 
 #include <SDL_events.h>
@@ -16,6 +18,8 @@
 #include "scene.h"
 #include "window.h"
 
+#include "private_impl/graphics/indexed_mesh.h"
+
 using AnimationViewer::Ui;
 
 std::unique_ptr<Ui>
@@ -62,6 +66,7 @@ Ui::Ui(SDL_Window* const window, ImGuiContext* const context)
   , show_assets_(true)
   , show_scene_(true)
   , show_components_(true)
+  , show_imports_(true)
   , scene_window_hovered_(false)
   , show_nodes_(true)
   , node_size_(0.05f)
@@ -99,6 +104,7 @@ Ui::run(const Window& window,
     ImGui::MenuItem("Assets", nullptr, &show_assets_);
     ImGui::MenuItem("Scene", nullptr, &show_scene_);
     ImGui::MenuItem("Components", nullptr, &show_components_);
+    ImGui::MenuItem("Imports", nullptr, &show_imports_);
     ImGui::MenuItem("Show Nodes", nullptr, &show_nodes_);
     if (show_nodes_) {
       ImGui::SliderFloat("Node Size", &node_size_, 0.0f, 100.0f, "%f", 10.0f);
@@ -113,6 +119,68 @@ Ui::run(const Window& window,
     }
     ImGui::EndMenu();
   }
+  if (ImGui::BeginMenu("Import")) {
+    auto fbx_importer = resource_manager.fbx_importer();
+    if (ImGui::MenuItem(
+          "FBX with OpenFBX", nullptr, fbx_importer == ResourceManager::FbxImporter::OpenFbx)) {
+      resource_manager.set_fbx_importer(ResourceManager::FbxImporter::OpenFbx);
+    }
+    if (ImGui::MenuItem(
+          "FBX with Assimp", nullptr, fbx_importer == ResourceManager::FbxImporter::Assimp)) {
+      resource_manager.set_fbx_importer(ResourceManager::FbxImporter::Assimp);
+    }
+    ImGui::Separator();
+    static constexpr std::array<std::pair<ResourceManager::AssimpProfile, const char*>, 3>
+      assimp_profiles{ {
+        { ResourceManager::AssimpProfile::AnimationOnly, "Assimp: Animation Only" },
+        { ResourceManager::AssimpProfile::FastPreview, "Assimp: Fast Preview" },
+        { ResourceManager::AssimpProfile::MaxQuality, "Assimp: Max Quality" },
+      } };
+    for (const auto& [profile, label] : assimp_profiles) {
+      if (ImGui::MenuItem(label, nullptr, resource_manager.assimp_profile() == profile)) {
+        resource_manager.set_assimp_profile(profile);
+      }
+    }
+    ImGui::Separator();
+    if (ImGui::MenuItem("Optimize Meshes", nullptr, resource_manager.optimize_meshes())) {
+      resource_manager.set_optimize_meshes(!resource_manager.optimize_meshes());
+    }
+    if (ImGui::MenuItem(
+          "Split Meshes for 16 bit Indices", nullptr, resource_manager.split_large_meshes())) {
+      resource_manager.set_split_large_meshes(!resource_manager.split_large_meshes());
+    }
+    if (ImGui::MenuItem("Generate LODs", nullptr, resource_manager.generate_lods())) {
+      resource_manager.set_generate_lods(!resource_manager.generate_lods());
+    }
+    ImGui::Separator();
+    static constexpr std::array<std::pair<Resource::Animation::Layout, const char*>, 2>
+      animation_layouts{ {
+        { Resource::Animation::Layout::FrameMajor, "Animation Samples by Frame" },
+        { Resource::Animation::Layout::JointMajor, "Animation Samples by Joint" },
+      } };
+    for (const auto& [layout, label] : animation_layouts) {
+      if (ImGui::MenuItem(label, nullptr, resource_manager.animation_layout() == layout)) {
+        resource_manager.set_animation_layout(layout);
+      }
+    }
+    if (ImGui::MenuItem("Compress Animations", nullptr, resource_manager.compress_animations())) {
+      resource_manager.set_compress_animations(!resource_manager.compress_animations());
+    }
+    if (resource_manager.compress_animations()) {
+      auto tolerances = resource_manager.animation_tolerances();
+      bool changed =
+        ImGui::InputFloat("Position Tolerance", &tolerances.position, 0.0f, 0.0f, "%g");
+      changed |= ImGui::InputFloat("Rotation Tolerance", &tolerances.rotation, 0.0f, 0.0f, "%g");
+      changed |= ImGui::InputFloat("Scale Tolerance", &tolerances.scale, 0.0f, 0.0f, "%g");
+      if (changed) {
+        tolerances.position = std::max(tolerances.position, 0.0f);
+        tolerances.rotation = std::max(tolerances.rotation, 0.0f);
+        tolerances.scale = std::max(tolerances.scale, 0.0f);
+        resource_manager.set_animation_tolerances(tolerances);
+      }
+    }
+    ImGui::EndMenu();
+  }
   char frame_timing[32];
   snprintf(frame_timing,
            sizeof(frame_timing),
@@ -147,6 +215,25 @@ Ui::run(const Window& window,
         ImGui::PlotHistogram(title.c_str(), values.data(), (int)values.size());
       }
     }
+    // Uploaded vertex data against what the float layout of every vertex would take
+    size_t vertex_count = 0;
+    size_t vertex_bytes = 0;
+    resource_manager.mesh_cache().each([&resource_manager, &vertex_count, &vertex_bytes](
+                                         const auto id) {
+      const auto& mesh = resource_manager.mesh_cache().handle(id);
+      if (mesh->gpu_resource) {
+        vertex_count += mesh->vertices.size();
+        vertex_bytes += mesh->vertices.size() * mesh->gpu_resource->vertex_stride();
+      }
+    });
+    if (vertex_count > 0) {
+      auto float_bytes = vertex_count * sizeof(vertex_t);
+      ImGui::Text("Vertices: %zu, %.2f MiB", vertex_count, vertex_bytes / (1024.0f * 1024.0f));
+      ImGui::Text("%.1f bytes per vertex, %zu as floats, %.0f%% saved",
+                  static_cast<float>(vertex_bytes) / vertex_count,
+                  sizeof(vertex_t),
+                  100.0f * (1.0f - static_cast<float>(vertex_bytes) / float_bytes));
+    }
     ImGui::End();
   }
 
@@ -217,6 +304,92 @@ Ui::run(const Window& window,
     }
   }
 
+  if (show_imports_ && !resource_manager.imports().empty()) {
+    if (ImGui::Begin("Imports", &show_imports_)) {
+      for (const auto& import_status : resource_manager.imports()) {
+        const char* state = "";
+        switch (import_status->state.load()) {
+          case ResourceManager::ImportStatus::State::Queued:
+            state = "Queued";
+            break;
+          case ResourceManager::ImportStatus::State::Running:
+            state = nullptr; // Show percentage
+            break;
+          case ResourceManager::ImportStatus::State::Finished:
+            state = import_status->cache_hit.load() ? "Cached" : "Done";
+            break;
+          case ResourceManager::ImportStatus::State::Failed:
+            state = "Failed";
+            break;
+        }
+        ImGui::ProgressBar(import_status->progress.load(), ImVec2(-300.0f, 0.0f), state);
+        ImGui::SameLine();
+        ImGui::Text("%s", import_status->name.c_str());
+        // Importing the same file with each FBX backend compares them side by side
+        ImGui::SameLine();
+        if (state != nullptr && import_status->duration.load() > 0.0f) {
+          ImGui::TextDisabled("%s %.1f ms",
+                              import_status->importer.load(),
+                              import_status->duration.load() * 1000.0f);
+        } else {
+          ImGui::TextDisabled("%s", import_status->importer.load());
+        }
+        // Phases and errors are only filled in once the import is done
+        if (ImGui::IsItemHovered() &&
+            (!import_status->phases.empty() || !import_status->error.empty())) {
+          ImGui::BeginTooltip();
+          if (!import_status->error.empty()) {
+            ImGui::TextUnformatted(import_status->error.c_str());
+          }
+          for (const auto& [phase, duration] : import_status->phases) {
+            ImGui::Text("%8.2f ms  %s", duration * 1000.0f, phase.c_str());
+          }
+          if (!import_status->optimized_meshes.empty()) {
+            ImGui::Separator();
+          }
+          for (const auto& optimized : import_status->optimized_meshes) {
+            ImGui::Text("ACMR %.2f -> %.2f, %u -> %u vertices  %s",
+                        optimized.acmr_before,
+                        optimized.acmr_after,
+                        optimized.vertices_before,
+                        optimized.vertices_after,
+                        optimized.mesh.c_str());
+            if (optimized.lod_triangles.size() > 1) {
+              std::string lods;
+              for (auto triangles : optimized.lod_triangles) {
+                lods += (lods.empty() ? "" : " / ") + std::to_string(triangles);
+              }
+              ImGui::Text("  LOD triangles %s", lods.c_str());
+            }
+          }
+          if (!import_status->compressed_animations.empty()) {
+            ImGui::Separator();
+          }
+          for (const auto& compressed : import_status->compressed_animations) {
+            if (compressed.compressed_bytes == 0) {
+              continue;
+            }
+            ImGui::Text("%.1fx, %zu -> %zu bytes  %s",
+                        static_cast<float>(compressed.raw_bytes) /
+                          static_cast<float>(compressed.compressed_bytes),
+                        compressed.raw_bytes,
+                        compressed.compressed_bytes,
+                        compressed.animation.c_str());
+            ImGui::Text("  Max error T %g R %g S %g",
+                        compressed.max_position_error,
+                        compressed.max_rotation_error,
+                        compressed.max_scale_error);
+          }
+          ImGui::EndTooltip();
+        }
+      }
+      if (ImGui::Button("Clear Finished")) {
+        resource_manager.clear_finished_imports();
+      }
+    }
+    ImGui::End();
+  }
+
   static std::optional<entt::entity> selected_entity;
 
   scene_window_hovered_ = false;
@@ -445,47 +618,34 @@ Ui::run(const Window& window,
                   ImGui::Checkbox("Animating", &animation.animating);
                   ImGui::Checkbox("Loop", &animation.loop);
                   char matrix_name[256];
-                  uint32_t i = 0;
-                  for (const auto& joint : resource->keyframes[animation.current_frame].bones) {
-                    if (!resource->joint_names[i].empty()) {
+                  for (uint32_t i = 0; i < resource->joint_count; ++i) {
+                    if (i < resource->joint_names.size() && !resource->joint_names[i].empty()) {
                       ImGui::Text("%s", resource->joint_names[i].c_str());
                     } else {
                       ImGui::Text("Joint %d", i);
                     }
-                    snprintf(matrix_name, sizeof(matrix_name), "##joint anim%d - 0", i);
-                    ImGui::InputFloat4(matrix_name,
-                                       const_cast<float*>(glm::value_ptr(joint[0])),
-                                       "%.3f",
-                                       ImGuiInputTextFlags_ReadOnly);
-                    snprintf(matrix_name, sizeof(matrix_name), "##joint anim%d - 1", i);
-                    ImGui::InputFloat4(matrix_name,
-                                       const_cast<float*>(glm::value_ptr(joint[1])),
+                    glm::vec3 position;
+                    glm::quat orientation;
+                    glm::vec3 scale;
+                    resource->sample(animation.current_frame, i, position, orientation, scale);
+                    snprintf(matrix_name, sizeof(matrix_name), "T##joint anim%d", i);
+                    ImGui::InputFloat3(matrix_name,
+                                       glm::value_ptr(position),
                                        "%.3f",
                                        ImGuiInputTextFlags_ReadOnly);
-                    snprintf(matrix_name, sizeof(matrix_name), "##joint anim%d - 2", i);
+                    snprintf(matrix_name, sizeof(matrix_name), "R##joint anim%d", i);
                     ImGui::InputFloat4(matrix_name,
-                                       const_cast<float*>(glm::value_ptr(joint[2])),
+                                       glm::value_ptr(orientation),
                                        "%.3f",
                                        ImGuiInputTextFlags_ReadOnly);
-                    snprintf(matrix_name, sizeof(matrix_name), "##joint anim%d - 3", i);
-                    ImGui::InputFloat4(matrix_name,
-                                       const_cast<float*>(glm::value_ptr(joint[3])),
+                    snprintf(matrix_name, sizeof(matrix_name), "S##joint anim%d", i);
+                    ImGui::InputFloat3(matrix_name,
+                                       glm::value_ptr(scale),
                                        "%.3f",
                                        ImGuiInputTextFlags_ReadOnly);
 
-                    {
-                      glm::vec3 scale;
-                      glm::quat orientation;
-                      glm::vec3 position;
-                      glm::vec3 skew;
-                      glm::vec4 perspective;
-                      glm::decompose(joint, scale, orientation, position, skew, perspective);
-
-                      snprintf(matrix_name, sizeof(matrix_name), "##joint anim guizmo%d", i);
-                      ImGui::gizmo3D(matrix_name, position, orientation);
-                    }
-
-                    ++i;
+                    snprintf(matrix_name, sizeof(matrix_name), "##joint anim guizmo%d", i);
+                    ImGui::gizmo3D(matrix_name, position, orientation);
                   }
                 }
                 ImGui::TreePop();
@@ -569,7 +729,7 @@ Ui::run(const Window& window,
 bool
 Ui::entity_accept_animation(Scene& scene,
                             const entt::entity& entity,
-                            const AnimationViewer::ResourceManager& resource_manager)
+                            AnimationViewer::ResourceManager& resource_manager)
 {
   if (!scene.registry().has<Components::Armature>(entity)) {
     return false;
@@ -619,7 +779,7 @@ Ui::entity_accept_mocap(Scene& scene,
 void
 AnimationViewer::Ui::entity_dnd_target(AnimationViewer::Scene& scene,
                                        const entt::entity& entity,
-                                       const AnimationViewer::ResourceManager& resource_manager)
+                                       AnimationViewer::ResourceManager& resource_manager)
 {
   if (ImGui::BeginDragDropTarget()) {
     auto payload = ImGui::GetDragDropPayload();
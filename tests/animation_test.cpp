@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include "resource.h"
+
+#include "private_impl/compression/compressed_animation.h"
+
+using namespace AnimationViewer;
+
+namespace {
+constexpr float kTolerance = 1e-5f;
+
+bool failed = false;
+
+void
+check(bool condition, const char* message)
+{
+  if (!condition) {
+    std::fprintf(stderr, "%s\n", message);
+    failed = true;
+  }
+}
+
+bool
+matches(const glm::mat4& a, const glm::mat4& b)
+{
+  for (glm::length_t column = 0; column < 4; ++column) {
+    for (glm::length_t row = 0; row < 4; ++row) {
+      if (std::abs(a[column][row] - b[column][row]) >
+          kTolerance * std::max(1.0f, std::abs(b[column][row]))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+glm::mat4
+compose(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+  return glm::translate(translation) * glm::mat4_cast(rotation) * glm::scale(scale);
+}
+
+/// Both layouts address every sample once and switching between them keeps the values
+void
+test_layouts()
+{
+  constexpr uint32_t kFrames = 5;
+  constexpr uint32_t kJoints = 7;
+  Resource::Animation animation;
+  animation.allocate(kFrames, kJoints);
+  for (uint32_t frame = 0; frame < kFrames; ++frame) {
+    for (uint32_t joint = 0; joint < kJoints; ++joint) {
+      auto value = static_cast<float>(frame * kJoints + joint);
+      animation.set_sample(frame,
+                           joint,
+                           glm::vec3(value, 1.0f, 2.0f),
+                           glm::normalize(glm::quat(1.0f, value, 0.0f, 0.0f)),
+                           glm::vec3(1.0f, value, 1.0f));
+    }
+  }
+  auto original = animation.samples;
+
+  using Layout = Resource::Animation::Layout;
+  for (auto layout : { Layout::FrameMajor, Layout::JointMajor }) {
+    animation.set_layout(layout);
+    std::vector<bool> addressed(size_t{ kFrames } * kJoints, false);
+    bool mapped = true;
+    bool kept = true;
+    for (uint32_t frame = 0; frame < kFrames; ++frame) {
+      for (uint32_t joint = 0; joint < kJoints; ++joint) {
+        auto index = animation.sample_index(frame, joint);
+        auto expected = layout == Layout::FrameMajor ? frame * kJoints + joint
+                                                     : joint * kFrames + frame;
+        mapped = mapped && index == expected && !addressed[index];
+        addressed[index] = true;
+        auto value = static_cast<float>(frame * kJoints + joint);
+        kept = kept && animation.translations()[index].x == value &&
+               animation.scales()[index].y == value;
+      }
+    }
+    check(mapped, "sample_index does not map every frame and joint to its own sample");
+    check(kept, "set_layout changed the samples");
+  }
+  animation.set_layout(Layout::FrameMajor);
+  check(animation.samples.size() == original.size() &&
+          std::memcmp(animation.samples.data(),
+                      original.data(),
+                      original.size() * sizeof(original[0])) == 0,
+        "a round trip through JointMajor is not bit exact");
+}
+
+/// Translation * rotation * scale matrices, mirrored and with collapsed axes, come back as stored
+void
+test_set_transform()
+{
+  auto rotation = glm::normalize(glm::quat(0.8f, 0.2f, -0.4f, 0.3f));
+  const glm::vec3 scales[] = { { 1.0f, 1.0f, 1.0f }, { 2.0f, 0.5f, 3.0f }, { -2.0f, 0.5f, 3.0f },
+                               { 0.0f, 2.0f, 3.0f }, { 2.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+  Resource::Animation animation;
+  animation.allocate(1, 1);
+  for (const auto& scale : scales) {
+    auto transform = compose(glm::vec3(1.0f, -2.0f, 3.0f), rotation, scale);
+    animation.set_transform(0, 0, transform);
+    glm::vec3 stored_translation, stored_scale;
+    glm::quat stored_rotation;
+    animation.sample(0, 0, stored_translation, stored_rotation, stored_scale);
+    check(std::abs(glm::dot(stored_rotation, stored_rotation) - 1.0f) < kTolerance,
+          "set_transform stored a rotation which is not a unit quaternion");
+    check(matches(compose(stored_translation, stored_rotation, stored_scale), transform),
+          "set_transform does not reproduce a translation * rotation * scale matrix");
+  }
+}
+
+/// Joints matched by name are concatenated in their own hierarchy, through the offsets, even
+/// under a non uniform scale, and bones without a joint keep their rest pose
+void
+test_pose_cache()
+{
+  // Listed children first, so the hierarchy has to be sorted
+  Resource::Animation animation;
+  animation.joint_names = { "tip", "arm", "root" };
+  animation.joint_parents = { 1, 2, Resource::Skeleton::kNoParent };
+  auto offset = glm::translate(glm::vec3(0.0f, 1.0f, 0.0f)) *
+                glm::mat4_cast(glm::angleAxis(0.5f, glm::vec3(0.0f, 0.0f, 1.0f)));
+  animation.joint_offsets = { glm::mat4(1.0f), offset, glm::mat4(1.0f) };
+  animation.allocate(2, 3);
+  auto frame = 1u;
+  auto tip_rotation = glm::angleAxis(0.3f, glm::vec3(1.0f, 0.0f, 0.0f));
+  auto arm_rotation = glm::angleAxis(0.7f, glm::vec3(0.0f, 0.0f, 1.0f));
+  animation.set_sample(frame, 0, glm::vec3(0.0f, 2.0f, 0.0f), tip_rotation, glm::vec3(1.0f));
+  animation.set_sample(frame, 1, glm::vec3(1.0f, 0.0f, 0.0f), arm_rotation, glm::vec3(1.0f));
+  animation.set_sample(
+    frame, 2, glm::vec3(0.0f, 0.0f, 5.0f), glm::quat(1, 0, 0, 0), glm::vec3(2.0f, 1.0f, 1.0f));
+
+  std::vector<bone_t> bones(4);
+  const char* names[] = { "root", "unanimated", "arm", "tip" };
+  const uint32_t parents[] = { Resource::Skeleton::kNoParent, 0, 1, 2 };
+  for (uint32_t i = 0; i < bones.size(); ++i) {
+    bones[i].name = names[i];
+    bones[i].parent = parents[i];
+    bones[i].position = glm::vec3(0.0f, 1.0f, 0.0f);
+    bones[i].orientation = glm::mat3(1.0f);
+  }
+  Resource::PoseCache cache;
+  cache.frame_count = animation.frame_count;
+  cache.joint_count = static_cast<uint32_t>(bones.size());
+  cache.skeleton.build(bones);
+  cache.local_joints = false;
+  cache.joint_hierarchy.sort(animation.joint_parents);
+  cache.joints = { 2, Resource::PoseCache::kNone, 1, 0 };
+  cache.capacity = 0;
+  auto pose = cache.pose(animation, frame);
+
+  auto root = compose(glm::vec3(0.0f, 0.0f, 5.0f), glm::quat(1, 0, 0, 0), glm::vec3(2, 1, 1));
+  auto arm = root * offset * compose(glm::vec3(1.0f, 0.0f, 0.0f), arm_rotation, glm::vec3(1.0f));
+  auto tip = arm * compose(glm::vec3(0.0f, 2.0f, 0.0f), tip_rotation, glm::vec3(1.0f));
+  check(matches(pose[0], root), "the root joint is not at its sample");
+  check(matches(pose[1], cache.skeleton.rest_global[1]), "a bone without joint left its rest");
+  check(matches(pose[2], arm), "a joint is not concatenated with its parent through its offset");
+  check(matches(pose[3], tip), "a sheared parent was not kept for the joint below it");
+}
+} // namespace
+
+int
+main()
+{
+  test_layouts();
+  test_set_transform();
+  test_pose_cache();
+  return failed ? 1 : 0;
+}
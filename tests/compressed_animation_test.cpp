@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "resource.h"
+
+#include "private_impl/compression/compressed_animation.h"
+
+using namespace AnimationViewer;
+
+namespace {
+constexpr Resource::Animation::Tolerances kTolerances{ 1e-3f, 1e-3f, 1e-3f };
+/// Statistics are measured by the compressor with the same functions as here, on the same values
+constexpr float kStatisticsTolerance = 1e-6f;
+
+bool failed = false;
+
+void
+check(bool condition, uint32_t frame_count, const char* message)
+{
+  if (!condition) {
+    std::fprintf(stderr, "%u frames: %s\n", frame_count, message);
+    failed = true;
+  }
+}
+
+/// Angle between two rotations, measured like the compressor does
+float
+rotation_error(const glm::quat& a, glm::quat b)
+{
+  if (glm::dot(a, b) < 0.0f) {
+    b = -b;
+  }
+  auto difference = a - b;
+  auto sum = a + b;
+  return 4.0f * std::atan2(std::sqrt(glm::dot(difference, difference)),
+                           std::sqrt(glm::dot(sum, sum)));
+}
+
+/// One joint with constant tracks, one with smooth ones and one with noisy ones and a jump
+void
+fill(Resource::Animation& animation, std::mt19937& engine)
+{
+  std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+  auto translations = animation.translations();
+  auto rotations = animation.rotations();
+  auto scales = animation.scales();
+  glm::vec3 walk(0.0f);
+  for (uint32_t frame = 0; frame < animation.frame_count; ++frame) {
+    auto time = static_cast<float>(frame) / 30.0f;
+
+    auto still = animation.sample_index(frame, 0);
+    translations[still] = glm::vec3(1.0f, 2.0f, 3.0f);
+    rotations[still] = glm::normalize(glm::quat(0.9f, 0.1f, 0.3f, -0.2f));
+    scales[still] = glm::vec3(1.0f);
+
+    auto smooth = animation.sample_index(frame, 1);
+    translations[smooth] = glm::vec3(std::sin(time), 0.5f * std::cos(2.0f * time), time);
+    rotations[smooth] = glm::angleAxis(
+      3.0f * time, glm::normalize(glm::vec3(std::sin(0.3f * time), 1.0f, std::cos(0.3f * time))));
+    scales[smooth] = glm::vec3(1.0f + 0.5f * std::sin(time), 1.0f, 1.0f);
+
+    auto noisy = animation.sample_index(frame, 2);
+    walk += glm::vec3(noise(engine), noise(engine), noise(engine));
+    translations[noisy] = walk + glm::vec3(frame < 256 ? 0.0f : 10.0f, 0.0f, 0.0f);
+    rotations[noisy] = glm::normalize(
+      glm::quat(1.0f, noise(engine), noise(engine), frame < 256 ? noise(engine) : 1.0f));
+    scales[noisy] = glm::vec3(1.0f + noise(engine));
+  }
+}
+} // namespace
+
+int
+main()
+{
+  std::mt19937 engine(16);
+  for (uint32_t frame_count : { 1u, 255u, 256u, 257u, 1000u }) {
+    Resource::Animation animation;
+    animation.allocate(frame_count, 3);
+    fill(animation, engine);
+    Resource::Animation source;
+    source.allocate(frame_count, 3);
+    std::copy(animation.samples.begin(), animation.samples.end(), source.samples.begin());
+    animation.compress(kTolerances);
+    check(animation.compressed != nullptr && animation.samples.empty(),
+          frame_count,
+          "compress did not replace the samples");
+    if (!animation.compressed) {
+      continue;
+    }
+
+    // Every frame of every track stays within tolerance, and the statistics saw the same errors
+    float max_position_error = 0.0f;
+    float max_rotation_error = 0.0f;
+    float max_scale_error = 0.0f;
+    for (uint32_t frame = 0; frame < frame_count; ++frame) {
+      for (uint32_t joint = 0; joint < 3; ++joint) {
+        glm::vec3 expected_translation, translation, expected_scale, scale;
+        glm::quat expected_rotation, rotation;
+        source.sample(frame, joint, expected_translation, expected_rotation, expected_scale);
+        animation.sample(frame, joint, translation, rotation, scale);
+        max_position_error =
+          std::max(max_position_error, glm::length(translation - expected_translation));
+        max_rotation_error =
+          std::max(max_rotation_error, rotation_error(rotation, expected_rotation));
+        max_scale_error = std::max(max_scale_error, glm::length(scale - expected_scale));
+      }
+    }
+    const auto& statistics = animation.compressed->statistics();
+    std::printf("%u frames: %u constant and %u animated tracks, %u keys, %zu of %zu bytes, "
+                "errors %g %g %g, reported %g %g %g\n",
+                frame_count,
+                statistics.constant_tracks,
+                statistics.animated_tracks,
+                statistics.keys,
+                statistics.compressed_bytes,
+                statistics.raw_bytes,
+                max_position_error,
+                max_rotation_error,
+                max_scale_error,
+                statistics.max_position_error,
+                statistics.max_rotation_error,
+                statistics.max_scale_error);
+    check(max_position_error <= kTolerances.position, frame_count, "translation out of tolerance");
+    check(max_rotation_error <= kTolerances.rotation, frame_count, "rotation out of tolerance");
+    check(max_scale_error <= kTolerances.scale, frame_count, "scale out of tolerance");
+    check(std::abs(statistics.max_position_error - max_position_error) <= kStatisticsTolerance,
+          frame_count,
+          "statistics report another translation error");
+    check(std::abs(statistics.max_rotation_error - max_rotation_error) <= kStatisticsTolerance,
+          frame_count,
+          "statistics report another rotation error");
+    check(std::abs(statistics.max_scale_error - max_scale_error) <= kStatisticsTolerance,
+          frame_count,
+          "statistics report another scale error");
+    auto animated_tracks = frame_count > 1 ? 6u : 0u;
+    check(statistics.constant_tracks == 9 - animated_tracks &&
+            statistics.animated_tracks == animated_tracks,
+          frame_count,
+          "tracks were not classified as constant and animated");
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,306 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "pipeline.h"
+
+#include "private_impl/graphics/buffer.h"
+#include "private_impl/graphics/framebuffer.h"
+#include "private_impl/graphics/indexed_mesh.h"
+#include "private_impl/graphics/instance_buffer.h"
+#include "private_impl/graphics/texture.h"
+
+#include "private_impl/graphics/shaders/bridging_header.h"
+
+#include "private_impl/graphics/shaders/mesh_frag_glsl.h"
+#include "private_impl/graphics/shaders/mesh_vert_glsl.h"
+
+using namespace AnimationViewer::Graphics;
+
+namespace {
+/// Exit code CTest reports as skipped, for machines without a GLES 3.2 capable EGL device
+constexpr int kSkipped = 77;
+constexpr uint32_t kGridSize = 8;
+constexpr uint32_t kInstanceCount = kGridSize * kGridSize;
+constexpr uint32_t kSegments = 4;
+constexpr uint32_t kTargetSize = 256;
+/// Narrow, so palettes wrap across rows of the texture like they do in the renderer
+constexpr uint32_t kBonePaletteWidth = 16;
+
+bool failed = false;
+
+void
+check(bool condition, const char* message)
+{
+  if (!condition) {
+    std::fprintf(stderr, "%s\n", message);
+    failed = true;
+  }
+}
+
+/// Same layout as the renderer's MeshInstance
+struct MeshInstance
+{
+  glm::vec4 model_rows[3];
+  uint32_t bone_offset;
+  uint32_t bone_count;
+};
+
+struct Vertex
+{
+  glm::vec3 position;
+  glm::vec3 normal;
+  /// Blend bone x into bone y by z
+  glm::vec3 bone_ids;
+};
+
+/// Headless context, on llvmpipe when the machine has neither a GPU nor a display server
+bool
+create_context()
+{
+  // Mesa's surfaceless platform works without a display, the default one needs X or Wayland
+  auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+    eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  auto display = EGL_NO_DISPLAY;
+  if (get_platform_display != nullptr) {
+    display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+  }
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+    return false;
+  }
+  const EGLint config_attributes[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT, EGL_NONE,
+  };
+  EGLConfig config;
+  EGLint config_count = 0;
+  if (!eglChooseConfig(display, config_attributes, &config, 1, &config_count) ||
+      config_count == 0 || !eglBindAPI(EGL_OPENGL_ES_API)) {
+    return false;
+  }
+  const EGLint surface_attributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+  auto surface = eglCreatePbufferSurface(display, config, surface_attributes);
+  // Same version the renderer asks for on desktop
+  const EGLint context_attributes[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 2, EGL_NONE,
+  };
+  auto context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+  if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT ||
+      !eglMakeCurrent(display, surface, surface, context)) {
+    return false;
+  }
+  return gladLoadGLES2Loader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)) != 0;
+}
+
+/// Upright strip from y = 0 to 1, bound to bone 0 at the bottom and blended into bone 1 at the top
+std::unique_ptr<IndexedMesh>
+create_strip()
+{
+  std::vector<Vertex> vertices;
+  std::vector<uint16_t> indices;
+  for (uint32_t i = 0; i <= kSegments; ++i) {
+    auto y = static_cast<float>(i) / kSegments;
+    for (float x : { -0.25f, 0.25f }) {
+      vertices.push_back({ { x, y, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, y } });
+    }
+  }
+  for (uint16_t i = 0; i < kSegments; ++i) {
+    auto bottom = static_cast<uint16_t>(2 * i);
+    auto top = static_cast<uint16_t>(bottom + 2);
+    for (auto index : { bottom, static_cast<uint16_t>(bottom + 1), top }) {
+      indices.push_back(index);
+    }
+    for (auto index : { static_cast<uint16_t>(bottom + 1),
+                        static_cast<uint16_t>(top + 1),
+                        top }) {
+      indices.push_back(index);
+    }
+  }
+  return IndexedMesh::create(
+    {
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 3 },
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 3 },
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 3 },
+    },
+    vertices.data(),
+    static_cast<uint32_t>(vertices.size() * sizeof(vertices[0])),
+    indices.data(),
+    static_cast<uint32_t>(indices.size()),
+    IndexedMesh::PrimitiveTopology::TriangleList);
+}
+
+/// Rows of the affine part of a rotation about z by @angle followed by a translation
+void
+append_bone(float angle, const glm::vec2& translation, std::vector<glm::vec4>& palette)
+{
+  auto c = std::cos(angle);
+  auto s = std::sin(angle);
+  palette.emplace_back(c, -s, 0.0f, translation.x);
+  palette.emplace_back(s, c, 0.0f, translation.y);
+  palette.emplace_back(0.0f, 0.0f, 1.0f, 0.0f);
+}
+
+/// A cell of the grid for every instance, each bent by its own two bone palette. The last one has
+/// a single bone, which the shader has to clamp the second bone of every vertex to.
+void
+make_instances(std::vector<MeshInstance>& instances, std::vector<glm::vec4>& palette)
+{
+  constexpr float kCell = 2.0f / kGridSize;
+  for (uint32_t i = 0; i < kInstanceCount; ++i) {
+    auto x = -1.0f + kCell * (static_cast<float>(i % kGridSize) + 0.5f);
+    auto y = -1.0f + kCell * static_cast<float>(i / kGridSize);
+    MeshInstance instance{ { glm::vec4(0.8f * kCell, 0.0f, 0.0f, x),
+                             glm::vec4(0.0f, 0.8f * kCell, 0.0f, y),
+                             glm::vec4(0.0f, 0.0f, 1.0f, 0.0f) },
+                           static_cast<uint32_t>(palette.size()),
+                           i + 1 == kInstanceCount ? 1u : 2u };
+    append_bone(0.0f, glm::vec2(0.0f), palette);
+    if (instance.bone_count == 2) {
+      auto angle = 0.8f * (static_cast<float>(i) / kInstanceCount - 0.5f);
+      append_bone(angle, glm::vec2(0.1f * std::sin(static_cast<float>(i)), 0.0f), palette);
+    }
+    instances.push_back(instance);
+  }
+  palette.resize((palette.size() + kBonePaletteWidth - 1) / kBonePaletteWidth *
+                 kBonePaletteWidth);
+}
+
+/// Pixels of the square from @x, @y which were drawn to
+uint32_t
+covered_pixels(const std::vector<uint8_t>& pixels, uint32_t x, uint32_t y, uint32_t size)
+{
+  uint32_t covered = 0;
+  for (uint32_t row = y; row < y + size; ++row) {
+    for (uint32_t column = x; column < x + size; ++column) {
+      covered += pixels[(size_t{ row } * kTargetSize + column) * 4 + 3] != 0;
+    }
+  }
+  return covered;
+}
+
+std::vector<uint8_t>
+read_back()
+{
+  std::vector<uint8_t> pixels(size_t{ kTargetSize } * kTargetSize * 4);
+  glReadPixels(0, 0, kTargetSize, kTargetSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  return pixels;
+}
+} // namespace
+
+int
+main()
+{
+  if (!create_context()) {
+    std::fprintf(stderr, "No GLES 3.2 context, skipped\n");
+    return kSkipped;
+  }
+  std::printf("%s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+
+  Pipeline::CreateInfo info{
+    .vertex_shader_binary = mesh_vert_glsl,
+    .vertex_shader_size = sizeof(mesh_vert_glsl) / sizeof(mesh_vert_glsl[0]),
+    .vertex_shader_entry_point = "main",
+    .fragment_shader_binary = mesh_frag_glsl,
+    .fragment_shader_size = sizeof(mesh_frag_glsl) / sizeof(mesh_frag_glsl[0]),
+    .fragment_shader_entry_point = "main",
+    .winding_order = Pipeline::TriangleWindingOrder::CounterClockwise,
+    .cull_mode = Pipeline::CullMode::Back,
+    .depth_write = true,
+    .depth_test = Pipeline::DepthTest::Less,
+    .blend = false,
+  };
+  auto pipeline = Pipeline::create(Pipeline::Type::RasterOpenGL, info);
+  check(pipeline != nullptr, "the mesh shaders did not compile");
+  if (!pipeline) {
+    return 1;
+  }
+
+  auto strip = create_strip();
+  std::vector<MeshInstance> instances;
+  std::vector<glm::vec4> palette;
+  make_instances(instances, palette);
+  auto instance_buffer = InstanceBuffer::create(
+    {
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 4 },
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 4 },
+      IndexedMesh::MeshAttributes{ GL_FLOAT, 4 },
+      IndexedMesh::MeshAttributes{ GL_UNSIGNED_INT, 2, false, true },
+    },
+    InstanceBuffer::Usage::Static);
+  instance_buffer->upload(instances.data(), kInstanceCount);
+  auto palette_rows = static_cast<uint32_t>(palette.size() / kBonePaletteWidth);
+  auto bone_palette = Texture::create(
+    kBonePaletteWidth, palette_rows, Texture::MipMapFilter::nearest, Texture::Format::rgba32f);
+  bone_palette->upload_rows(palette.data(), palette_rows);
+
+  // Looking down -z without perspective, so the grid fills the target
+  camera_uniform_t camera_uniform{ glm::mat4(1.0f), glm::mat4(1.0f), glm::vec4(0, 0, 1, 0) };
+  auto camera_buffer = Buffer::create(sizeof(camera_uniform));
+  camera_buffer->upload(&camera_uniform, sizeof(camera_uniform));
+  mesh_uniform_t mesh_uniform{ glm::vec4(0.0f), glm::vec4(1.0f) };
+  auto mesh_buffer = Buffer::create(sizeof(mesh_uniform));
+  mesh_buffer->upload(&mesh_uniform, sizeof(mesh_uniform));
+
+  std::unique_ptr<Texture> target[] = { Texture::create(
+    kTargetSize, kTargetSize, Texture::MipMapFilter::nearest, Texture::Format::rgba8f) };
+  auto framebuffer = Framebuffer::create(target, 1);
+  glViewport(0, 0, kTargetSize, kTargetSize);
+
+  auto draw = [&](bool instanced, uint32_t index_offset, uint32_t index_count) {
+    framebuffer->clear({ glm::vec4(0.0f) }, {});
+    pipeline->bind();
+    mesh_buffer->bind(0);
+    camera_buffer->bind(1);
+    bone_palette->bind(0);
+    strip->bind();
+    if (instanced) {
+      instance_buffer->bind(MESH_INSTANCE_LOCATION);
+      strip->draw_instanced(index_offset, index_count, kInstanceCount);
+    } else {
+      // One draw per entity, like groups of a single instance
+      for (uint32_t i = 0; i < kInstanceCount; ++i) {
+        instance_buffer->bind(MESH_INSTANCE_LOCATION, i);
+        strip->draw_instanced(index_offset, index_count, 1);
+      }
+    }
+    return read_back();
+  };
+
+  // All of the mesh, and a range of it like a level of detail
+  auto index_count = strip->element_count_;
+  for (auto [index_offset, count] : { std::pair{ 0u, index_count }, std::pair{ 6u, 12u } }) {
+    auto per_entity = draw(false, index_offset, count);
+    auto instanced = draw(true, index_offset, count);
+    check(glGetError() == GL_NO_ERROR, "drawing raised a GL error");
+
+    auto covered = covered_pixels(per_entity, 0, 0, kTargetSize);
+    std::printf("%u of %u pixels covered by %u instances of %u indices\n",
+                covered,
+                kTargetSize * kTargetSize,
+                kInstanceCount,
+                count);
+    // Every instance covers about a third of its cell when it draws all of the strip
+    check(covered > kTargetSize * kTargetSize * count / index_count / 10,
+          "the instances did not cover the target");
+    check(per_entity == instanced, "instanced draws differ from one draw per entity");
+  }
+
+  // Both paths share the shader, so check one instance on its own: with its second bone clamped
+  // to the first, the strip in the last cell stays 0.5 by 1 in units of 0.8 cells
+  constexpr uint32_t kCellPixels = kTargetSize / kGridSize;
+  auto pixels = draw(true, 0, index_count);
+  auto covered = static_cast<float>(covered_pixels(
+    pixels, kTargetSize - kCellPixels, kTargetSize - kCellPixels, kCellPixels));
+  auto expected = 0.5f * 0.8f * 0.8f * kCellPixels * kCellPixels;
+  check(std::abs(covered - expected) < 0.1f * expected,
+        "the strip with a single bone was bent, bones past the palette were not clamped");
+  return failed ? 1 : 0;
+}
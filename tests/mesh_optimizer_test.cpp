@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <set>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "resource.h"
+
+#include "private_impl/geometry/mesh_optimizer.h"
+
+using namespace AnimationViewer;
+
+namespace {
+constexpr uint32_t kGridSize = 32;
+
+bool failed = false;
+
+void
+check(bool condition, const char* message)
+{
+  if (!condition) {
+    std::fprintf(stderr, "%s\n", message);
+    failed = true;
+  }
+}
+
+bool
+same_bytes(const vertex_t& a, const vertex_t& b)
+{
+  return std::memcmp(&a, &b, sizeof(vertex_t)) == 0;
+}
+
+/// Triangles of @indices rotated to start at their lowest index, which keeps the winding, sorted
+std::vector<std::array<uint32_t, 3>>
+triangle_multiset(std::span<const uint32_t> indices)
+{
+  std::vector<std::array<uint32_t, 3>> triangles;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    std::array<uint32_t, 3> triangle{ indices[i], indices[i + 1], indices[i + 2] };
+    auto lowest = std::min_element(triangle.begin(), triangle.end());
+    std::rotate(triangle.begin(), lowest, triangle.end());
+    triangles.push_back(triangle);
+  }
+  std::sort(triangles.begin(), triangles.end());
+  return triangles;
+}
+
+/// Shuffled triangles of a grid, every corner with a vertex of its own
+void
+make_grid(std::vector<vertex_t>& vertices, std::vector<uint32_t>& indices)
+{
+  auto corner = [](uint32_t x, uint32_t y) {
+    vertex_t vertex{};
+    vertex.position = glm::vec3(static_cast<float>(x), static_cast<float>(y), 0.0f);
+    vertex.normal = glm::vec3(0.0f, 0.0f, 1.0f);
+    vertex.bone_id = glm::vec3(0.0f, 0.0f, 0.0f);
+    return vertex;
+  };
+  std::vector<std::array<vertex_t, 3>> triangles;
+  for (uint32_t y = 0; y < kGridSize; ++y) {
+    for (uint32_t x = 0; x < kGridSize; ++x) {
+      triangles.push_back({ corner(x, y), corner(x + 1, y), corner(x, y + 1) });
+      triangles.push_back({ corner(x + 1, y), corner(x + 1, y + 1), corner(x, y + 1) });
+    }
+  }
+  std::mt19937 engine(13);
+  std::shuffle(triangles.begin(), triangles.end(), engine);
+  for (const auto& triangle : triangles) {
+    for (const auto& vertex : triangle) {
+      indices.push_back(static_cast<uint32_t>(vertices.size()));
+      vertices.push_back(vertex);
+    }
+  }
+}
+} // namespace
+
+int
+main()
+{
+  std::vector<vertex_t> vertices;
+  std::vector<uint32_t> indices;
+  make_grid(vertices, indices);
+  // Equal in value but not in bytes, and one ulp apart: neither may be merged
+  vertices[0].normal.x = -0.0f;
+  vertices[1].position.x = std::nextafter(vertices[1].position.x, 1e3f);
+  constexpr uint32_t kCornerCount = (kGridSize + 1) * (kGridSize + 1);
+
+  // weld_vertices merges byte identical vertices only and keeps what every index points at
+  auto corners = vertices;
+  Geometry::weld_vertices(vertices, indices);
+  check(vertices.size() == kCornerCount + 2, "weld_vertices kept duplicates or merged near ones");
+  std::set<std::string> unique;
+  for (const auto& vertex : vertices) {
+    unique.emplace(reinterpret_cast<const char*>(&vertex), sizeof(vertex));
+  }
+  check(unique.size() == vertices.size(), "weld_vertices left byte identical vertices");
+  bool corners_kept = true;
+  for (size_t i = 0; i < indices.size(); ++i) {
+    corners_kept = corners_kept && same_bytes(vertices[indices[i]], corners[i]);
+  }
+  check(corners_kept, "weld_vertices changed the vertex of a corner");
+
+  // optimize_vertex_cache only reorders triangles, and never for the worse
+  auto vertex_count = static_cast<uint32_t>(vertices.size());
+  auto triangles = triangle_multiset(indices);
+  auto acmr_before = Geometry::average_cache_miss_ratio(indices, vertex_count);
+  Geometry::optimize_vertex_cache(indices, vertex_count);
+  auto acmr_after = Geometry::average_cache_miss_ratio(indices, vertex_count);
+  check(triangle_multiset(indices) == triangles, "optimize_vertex_cache changed the triangles");
+  check(acmr_after <= acmr_before, "optimize_vertex_cache raised the average cache miss ratio");
+  std::printf("ACMR %.3f before and %.3f after optimize_vertex_cache\n", acmr_before, acmr_after);
+
+  // optimize_vertex_fetch numbers vertices in first use order and drops the unreferenced ones
+  vertices.push_back(vertex_t{});
+  corners.clear();
+  for (auto index : indices) {
+    corners.push_back(vertices[index]);
+  }
+  Geometry::optimize_vertex_fetch(vertices, indices);
+  check(vertices.size() == vertex_count, "optimize_vertex_fetch kept an unreferenced vertex");
+  uint32_t next = 0;
+  bool first_use_order = true;
+  corners_kept = true;
+  for (size_t i = 0; i < indices.size(); ++i) {
+    if (indices[i] == next) {
+      ++next;
+    } else {
+      first_use_order = first_use_order && indices[i] < next;
+    }
+    corners_kept = corners_kept && same_bytes(vertices[indices[i]], corners[i]);
+  }
+  check(first_use_order && next == vertices.size(),
+        "optimize_vertex_fetch did not number vertices in first use order");
+  check(corners_kept, "optimize_vertex_fetch changed the vertex of a corner");
+
+  return failed ? 1 : 0;
+}
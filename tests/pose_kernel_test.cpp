@@ -0,0 +1,17 @@
+#include <cstdio>
+
+#include "private_impl/pose/pose_kernel.h"
+
+using namespace AnimationViewer;
+
+int
+main()
+{
+  if (!Pose::matches_reference()) {
+    std::fprintf(stderr,
+                 "Vectorized pose kernels with a batch of %zu joints differ from the reference\n",
+                 Pose::batch_size());
+    return 1;
+  }
+  return 0;
+}